@@ -31,16 +31,28 @@ class AAHash;
 
 class SeedAAHash;
 
+class MultiLevelAAHash;
+
 class AAHash
 {
   static constexpr const char* HASH_FN_NAME = "aahash1";
 
 private:
   friend class SeedAAHash;
+  friend class MultiLevelAAHash;
 
   /** Initialize internal state of iterator */
   bool init();
 
+  /** Like init(), but only compute the base hash value */
+  bool init_base();
+
+  /** Like roll(), but only update the base hash value */
+  bool roll_base();
+
+  // Number of k-mers whose hash values roll_batch() extends at once
+  static const size_t BATCH_SIZE = 64;
+
   const char* seq;
   size_t seq_len;
   const uint8_t hash_num;
@@ -49,6 +61,7 @@ private:
 
   size_t pos;
   bool initialized = false;
+  uint64_t hash_value = 0;
   std::unique_ptr<uint64_t[]> hashes_array;
 
 public:
@@ -83,6 +96,7 @@ public:
     , level(aahash.level)
     , pos(aahash.pos)
     , initialized(aahash.initialized)
+    , hash_value(aahash.hash_value)
     , hashes_array(new uint64_t[hash_num])
   {
     std::memcpy(hashes_array.get(),
@@ -107,6 +121,28 @@ public:
    */
   bool roll();
 
+  /**
+   * Like calling roll() up to \p n times, but the hash values of the k-mers
+   * are written to \p hashes and their extensions are computed for the whole
+   * batch with the widest SIMD instructions supported by the CPU. The hash
+   * values of the i-th k-mer are stored starting at hashes[i * stride]. After
+   * the call, the object is in the same state as after the equivalent roll()
+   * calls, i.e. hashes() and get_pos() refer to the last hashed k-mer.
+   *
+   * @param n Maximum number of k-mers to hash.
+   * @param hashes Output array with room for \p n * \p stride hash values.
+   * @param stride Distance between the hash values of consecutive k-mers, at
+   * least get_hash_num().
+   * @param positions Optional output array for the positions of the k-mers.
+   *
+   * @return Number of hashed k-mers, less than \p n only when the end of the
+   * sequence was reached.
+   */
+  size_t roll_batch(size_t n,
+                    uint64_t* hashes,
+                    size_t stride,
+                    size_t* positions = nullptr);
+
   const uint64_t* hashes() const { return hashes_array.get(); }
   size_t get_pos() const { return pos; }
   unsigned get_hash_num() const { return hash_num; }
@@ -123,9 +159,22 @@ private:
   const unsigned hash_num_per_seed;
   std::unique_ptr<uint64_t[]> hashes_array;
   std::vector<SpacedSeed> seeds;
+  // Base hash value of each seed for the current k-mer
+  std::vector<uint64_t> seed_hashes;
+  // Positions i of each seed where the levels of i and i + 1 differ. Rolling
+  // only needs to correct the terms of the amino acids at these positions.
+  std::vector<std::vector<unsigned>> level_changes;
+  // Terms XORed into the hash value of each seed when rolling, indexed by
+  // character: the amino acid that leaves the k-mer, the one that enters it
+  // and those at each of level_changes
+  std::vector<std::vector<uint64_t>> roll_tables;
+  // Base hash values of a batch of k-mers, BATCH_SIZE per seed
+  std::vector<uint64_t> batch_hashes;
   bool verify_seed();
   /** Verify internal state of iterator */
   void init();
+  /** Like roll(), but only update the base hash values of the seeds */
+  bool roll_base();
 
 public:
   /**
@@ -193,6 +242,10 @@ public:
     , hash_num_per_seed(seed_aahash.hash_num_per_seed)
     , hashes_array(new uint64_t[hash_num_per_seed * seed_aahash.seeds.size()])
     , seeds(seed_aahash.seeds)
+    , seed_hashes(seed_aahash.seed_hashes)
+    , level_changes(seed_aahash.level_changes)
+    , roll_tables(seed_aahash.roll_tables)
+    , batch_hashes(seed_aahash.batch_hashes.size())
   {
     std::memcpy(hashes_array.get(),
                 seed_aahash.hashes_array.get(),
@@ -215,6 +268,29 @@ public:
    */
   bool roll();
 
+  /**
+   * Like calling roll() up to \p n times, but the hash values of the k-mers
+   * are written to \p hashes and their extensions are computed for the whole
+   * batch with the widest SIMD instructions supported by the CPU. The hash
+   * values of the i-th k-mer are stored starting at hashes[i * stride]. After
+   * the call, the object is in the same state as after the equivalent roll()
+   * calls, i.e. hashes() and get_pos() refer to the last hashed k-mer.
+   *
+   * @param n Maximum number of k-mers to hash.
+   * @param hashes Output array with room for \p n * \p stride hash values.
+   * @param stride Distance between the hash values of consecutive k-mers, at
+   * least get_hash_num_per_seed() times the number of seeds. The hash values
+   * of each seed follow those of the previous seed, as in hashes().
+   * @param positions Optional output array for the positions of the k-mers.
+   *
+   * @return Number of hashed k-mers, less than \p n only when the end of the
+   * sequence was reached.
+   */
+  size_t roll_batch(size_t n,
+                    uint64_t* hashes,
+                    size_t stride,
+                    size_t* positions = nullptr);
+
   const uint64_t* hashes() const { return hashes_array.get(); }
 
   size_t get_pos() const { return aahash.get_pos(); }
@@ -223,6 +299,116 @@ public:
   unsigned get_k() const { return aahash.get_k(); }
 };
 
+/**
+ * Hashes the k-mers of an amino acid sequence at levels 1, 2 and 3 in a
+ * single pass. The hash values of each level are the same as those of an
+ * AAHash with that level, but all levels are rolled together, so the sequence
+ * is read and scanned for invalid characters only once.
+ */
+class MultiLevelAAHash
+{
+public:
+  /** Number of levels hashed per k-mer. */
+  static const unsigned NUM_LEVELS = 3;
+
+private:
+  AAHash aahash;
+  // Rotation of the amino acid leaving the k-mer, reduced modulo the sizes of
+  // the 31 and 33 bit roll tables
+  const unsigned rot_31;
+  const unsigned rot_33;
+  // Base hash value of each level for the current k-mer
+  uint64_t level_hashes[NUM_LEVELS] = {};
+  std::unique_ptr<uint64_t[]> hashes_array;
+  /** Like AAHash::init_base(), for all levels */
+  bool init_base();
+  /** Like roll(), but only update the base hash values of the levels */
+  bool roll_base();
+
+public:
+  /**
+   * Constructor.
+   * @param seq String of amino acid sequence to be hashed.
+   * @param hash_num Number of hashes to produce per k-mer and level.
+   * @param k K-mer size.
+   * @param pos Position in seq to start hashing from.
+   */
+  MultiLevelAAHash(std::string_view seq,
+                   uint8_t hash_num,
+                   uint16_t k,
+                   size_t pos = 0)
+    : aahash(seq, hash_num, k, 1, pos)
+    , rot_31(k % 31)
+    , rot_33(k % 33)
+    , hashes_array(new uint64_t[NUM_LEVELS * hash_num])
+  {
+  }
+
+  MultiLevelAAHash(const MultiLevelAAHash& multi_aahash)
+    : aahash(multi_aahash.aahash)
+    , rot_31(multi_aahash.rot_31)
+    , rot_33(multi_aahash.rot_33)
+    , hashes_array(new uint64_t[NUM_LEVELS * aahash.hash_num])
+  {
+    std::memcpy(level_hashes, multi_aahash.level_hashes, sizeof(level_hashes));
+    std::memcpy(hashes_array.get(),
+                multi_aahash.hashes_array.get(),
+                NUM_LEVELS * aahash.hash_num * sizeof(uint64_t));
+  }
+
+  MultiLevelAAHash(MultiLevelAAHash&&) = default;
+
+  /**
+   * Calculate the hash values of current k-mer at all levels and advance to
+   * the next. Invalid characters are skipped as in AAHash::roll().
+   *
+   * @return true on success and false otherwise.
+   */
+  bool roll();
+
+  /**
+   * Like calling roll() up to \p n times, but the hash values of the k-mers
+   * are written to \p hashes and their extensions are computed for the whole
+   * batch with the widest SIMD instructions supported by the CPU. The hash
+   * values of the i-th k-mer are stored starting at hashes[i * stride], in the
+   * same order as in hashes(). After the call, the object is in the same state
+   * as after the equivalent roll() calls.
+   *
+   * @param n Maximum number of k-mers to hash.
+   * @param hashes Output array with room for \p n * \p stride hash values.
+   * @param stride Distance between the hash values of consecutive k-mers, at
+   * least NUM_LEVELS * get_hash_num().
+   * @param positions Optional output array for the positions of the k-mers.
+   *
+   * @return Number of hashed k-mers, less than \p n only when the end of the
+   * sequence was reached.
+   */
+  size_t roll_batch(size_t n,
+                    uint64_t* hashes,
+                    size_t stride,
+                    size_t* positions = nullptr);
+
+  /**
+   * Hash values of the current k-mer, get_hash_num() for level 1 followed by
+   * those for levels 2 and 3.
+   */
+  const uint64_t* hashes() const { return hashes_array.get(); }
+
+  /**
+   * Hash values of the current k-mer at a single level.
+   * @param level Level of the hash values, 1, 2 or 3.
+   */
+  const uint64_t* hashes(unsigned level) const
+  {
+    return hashes_array.get() + (level - 1) * aahash.hash_num;
+  }
+
+  size_t get_pos() const { return aahash.get_pos(); }
+  unsigned get_hash_num() const { return aahash.get_hash_num(); }
+  unsigned get_k() const { return aahash.get_k(); }
+  const char* get_seq() const { return aahash.get_seq(); }
+};
+
 } // namespace btllib
 
 #endif
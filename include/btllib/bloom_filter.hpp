@@ -36,6 +36,11 @@ static const char* const HASH_FN = NTHASH_FN_NAME;
 static const unsigned MAX_HASH_VALUES = 1024;
 static const unsigned PLACEHOLDER_NEWLINES = 50;
 
+template<typename T>
+class CountingBloomFilter;
+template<typename T>
+class KmerCountingBloomFilter;
+
 /// @cond HIDDEN_SYMBOLS
 class BloomFilterInitializer
 {
@@ -135,6 +140,20 @@ public:
     return contains(hashes.data());
   }
 
+  /**
+   * Check for the presence of several elements at once. The filter bytes of
+   * all elements are prefetched before any of them is checked, so that their
+   * cache misses overlap.
+   *
+   * @param hashes Integer array of the hash values of the elements, hash_num
+   * values per element one after another.
+   * @param n Number of elements, at most 32.
+   *
+   * @return Bit mask of the present elements, bit i set if element i is
+   * present.
+   */
+  unsigned contains_batch(const uint64_t* hashes, unsigned n) const;
+
   /**
    * Check for the presence of an element's hash values and insert if missing.
    *
@@ -200,6 +219,8 @@ private:
 
   friend class KmerBloomFilter;
   friend class SeedBloomFilter;
+  template<typename T>
+  friend class CountingBloomFilter;
 
   size_t bytes = 0;
   size_t array_size =
@@ -257,6 +278,26 @@ public:
    */
   void insert(const std::string& seq) { insert(seq.c_str(), seq.size()); }
 
+  /**
+   * Insert a long sequence's k-mers into the filter, hashing chunks of the
+   * sequence with all OpenMP threads. Inserts the same k-mers as insert().
+   *
+   * @param seq Sequence to k-merize.
+   * @param seq_len Length of seq.
+   */
+  void insert_parallel(const char* seq, size_t seq_len);
+
+  /**
+   * Insert a long sequence's k-mers into the filter, hashing chunks of the
+   * sequence with all OpenMP threads. Inserts the same k-mers as insert().
+   *
+   * @param seq Sequence to k-merize.
+   */
+  void insert_parallel(const std::string& seq)
+  {
+    insert_parallel(seq.c_str(), seq.size());
+  }
+
   /**
    * Insert an element's hash values.
    *
@@ -318,6 +359,45 @@ public:
     return bloom_filter.contains(hashes);
   }
 
+  /**
+   * Check for the presence of several elements at once. See
+   * BloomFilter::contains_batch().
+   *
+   * @param hashes Integer array of the hash values of the elements, hash_num
+   * values per element one after another.
+   * @param n Number of elements, at most 32.
+   *
+   * @return Bit mask of the present elements, bit i set if element i is
+   * present.
+   */
+  unsigned contains_batch(const uint64_t* hashes, unsigned n) const
+  {
+    return bloom_filter.contains_batch(hashes, n);
+  }
+
+  /**
+   * Query the presence of the four k-mers that follow the current k-mer of a
+   * BlindNtHash, e.g. the successors of a node of an implicit de Bruijn graph.
+   * The object must hash k-mers of size get_k() with get_hash_num() hashes.
+   *
+   * @param nthash BlindNtHash object at the current k-mer.
+   *
+   * @return Bit mask of the present k-mers, bit i set if the k-mer ending with
+   * BlindNtHash::EXTENSION_BASES[i] is present.
+   */
+  unsigned contains_successors(const BlindNtHash& nthash) const;
+
+  /**
+   * Query the presence of the four k-mers that precede the current k-mer of a
+   * BlindNtHash. See contains_successors().
+   *
+   * @param nthash BlindNtHash object at the current k-mer.
+   *
+   * @return Bit mask of the present k-mers, bit i set if the k-mer starting
+   * with BlindNtHash::EXTENSION_BASES[i] is present.
+   */
+  unsigned contains_predecessors(const BlindNtHash& nthash) const;
+
   /**
    * Query the presence of k-mers of a sequence and insert if missing.
    *
@@ -404,6 +484,8 @@ private:
   KmerBloomFilter(const std::shared_ptr<BloomFilterInitializer>& bfi);
 
   friend class SeedBloomFilter;
+  template<typename T>
+  friend class KmerCountingBloomFilter;
 
   unsigned k = 0;
   BloomFilter bloom_filter;
@@ -649,6 +731,7 @@ private:
   std::vector<std::string> seeds;
   std::vector<btllib::hashing_internals::SpacedSeed> parsed_seeds;
   KmerBloomFilter kmer_bloom_filter;
+  std::shared_ptr<const ParsedSeeds> seed_blocks;
 };
 
 } // namespace btllib
@@ -8,7 +8,9 @@
 
 #include "cpptoml.h"
 
+#include <algorithm>
 #include <atomic>
+#include <climits>
 #include <cmath>
 #include <cstdint>
 #include <fstream>
@@ -193,6 +195,228 @@ CountingBloomFilter<T>::get_fpr(const T threshold) const
   return std::pow(get_occupancy(threshold), double(hash_num));
 }
 
+template<typename T>
+inline void
+CountingBloomFilter<T>::check_compatible(
+  const size_t other_bytes,
+  const unsigned other_hash_num,
+  const size_t other_counter_bits,
+  const std::string& other_hash_fn) const
+{
+  check_error(sizeof(array[0]) * CHAR_BIT != other_counter_bits,
+              "CountingBloomFilter: counter sizes differ (" +
+                std::to_string(sizeof(array[0]) * CHAR_BIT) + " vs " +
+                std::to_string(other_counter_bits) + " bits).");
+  check_error(bytes != other_bytes,
+              "CountingBloomFilter: filter sizes differ (" +
+                std::to_string(bytes) + " vs " + std::to_string(other_bytes) +
+                " bytes).");
+  check_error(hash_num != other_hash_num,
+              "CountingBloomFilter: numbers of hash values differ (" +
+                std::to_string(hash_num) + " vs " +
+                std::to_string(other_hash_num) + ").");
+  check_error(!hash_fn.empty() && !other_hash_fn.empty() &&
+                hash_fn != other_hash_fn,
+              "CountingBloomFilter: hash functions differ (" + hash_fn +
+                " vs " + other_hash_fn + ").");
+}
+
+template<typename T>
+template<typename Op>
+inline void
+CountingBloomFilter<T>::combine(const CountingBloomFilter& other, Op op)
+{
+  check_compatible(other.bytes,
+                   other.hash_num,
+                   sizeof(other.array[0]) * CHAR_BIT,
+                   other.hash_fn);
+  // The filters are not modified concurrently, so the counters can be accessed
+  // as plain integers, which lets the compiler vectorize the loop.
+  auto* const data = (T*)array.get();
+  const auto* const other_data = (const T*)other.array.get();
+  const auto size = array_size;
+// NOLINTNEXTLINE(openmp-use-default-none,-warnings-as-errors)
+#pragma omp parallel for simd
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = op(data[i], other_data[i]);
+  }
+}
+
+template<typename T>
+template<typename Op>
+inline void
+CountingBloomFilter<T>::combine(
+  const std::shared_ptr<BloomFilterInitializer>& bfi,
+  Op op)
+{
+  check_compatible(*(bfi->table->get_as<size_t>("bytes")),
+                   *(bfi->table->get_as<unsigned>("hash_num")),
+                   *(bfi->table->get_as<size_t>("counter_bits")),
+                   bfi->table->contains("hash_fn")
+                     ? *(bfi->table->get_as<std::string>("hash_fn"))
+                     : "");
+  auto* const data = (T*)array.get();
+  const size_t chunk_size =
+    std::min(array_size, COMBINE_CHUNK_BYTES / sizeof(array[0]));
+  std::unique_ptr<T[]> chunk(new T[chunk_size]);
+  for (size_t start = 0; start < array_size; start += chunk_size) {
+    const size_t len = std::min(chunk_size, array_size - start);
+    bfi->ifs.read((char*)chunk.get(), std::streamsize(len * sizeof(T)));
+    check_error(size_t(bfi->ifs.gcount()) != len * sizeof(T),
+                "CountingBloomFilter: " + bfi->path + " is truncated.");
+    auto* const dst = data + start;
+    const auto* const src = chunk.get();
+// NOLINTNEXTLINE(openmp-use-default-none,-warnings-as-errors)
+#pragma omp parallel for simd
+    for (size_t i = 0; i < len; ++i) {
+      dst[i] = op(dst[i], src[i]);
+    }
+  }
+}
+
+template<typename T>
+inline std::shared_ptr<BloomFilterInitializer>
+CountingBloomFilter<T>::open_counting_bloom_file(const std::string& path)
+{
+  return std::make_shared<BloomFilterInitializer>(
+    path,
+    KmerCountingBloomFilter<T>::is_bloom_file(path)
+      ? KMER_COUNTING_BLOOM_FILTER_SIGNATURE
+      : COUNTING_BLOOM_FILTER_SIGNATURE);
+}
+
+template<typename T>
+inline void
+CountingBloomFilter<T>::add(const CountingBloomFilter& other)
+{
+  combine(other, saturating_add);
+}
+
+template<typename T>
+inline void
+CountingBloomFilter<T>::add(const std::string& path)
+{
+  combine(open_counting_bloom_file(path), saturating_add);
+}
+
+template<typename T>
+inline void
+CountingBloomFilter<T>::subtract(const CountingBloomFilter& other)
+{
+  combine(other, saturating_subtract);
+}
+
+template<typename T>
+inline void
+CountingBloomFilter<T>::subtract(const std::string& path)
+{
+  combine(open_counting_bloom_file(path), saturating_subtract);
+}
+
+template<typename T>
+inline void
+CountingBloomFilter<T>::max(const CountingBloomFilter& other)
+{
+  combine(other, maximum);
+}
+
+template<typename T>
+inline void
+CountingBloomFilter<T>::max(const std::string& path)
+{
+  combine(open_counting_bloom_file(path), maximum);
+}
+
+template<typename T>
+inline std::vector<uint64_t>
+CountingBloomFilter<T>::get_histogram(const T max_count) const
+{
+  const size_t bins = size_t(max_count) + 1;
+  std::vector<uint64_t> histogram(bins, 0);
+  const auto* const data = (const T*)array.get();
+  const auto size = array_size;
+// NOLINTNEXTLINE(openmp-use-default-none,-warnings-as-errors)
+#pragma omp parallel
+  {
+    // Counts are spread over several lanes so that runs of equal counters
+    // (e.g. zeros) don't serialize on a single bin.
+    std::vector<uint64_t> local(bins * HISTOGRAM_LANES, 0);
+#pragma omp for nowait
+    for (size_t i = 0; i < size; ++i) {
+      const T count = data[i] < max_count ? data[i] : max_count;
+      ++local[size_t(count) * HISTOGRAM_LANES + (i % HISTOGRAM_LANES)];
+    }
+#pragma omp critical
+    for (size_t bin = 0; bin < bins; ++bin) {
+      for (size_t lane = 0; lane < HISTOGRAM_LANES; ++lane) {
+        histogram[bin] += local[bin * HISTOGRAM_LANES + lane];
+      }
+    }
+  }
+  return histogram;
+}
+
+template<typename T>
+inline size_t
+CountingBloomFilter<T>::get_bloom_filter_bytes(const size_t bytes) const
+{
+  if (bytes != 0) {
+    return bytes;
+  }
+  check_error(array_size % (sizeof(uint64_t) * CHAR_BIT) != 0,
+              "CountingBloomFilter: number of counters (" +
+                std::to_string(array_size) +
+                ") must be a multiple of 64 to convert to a Bloom filter of "
+                "the same geometry.");
+  return array_size / CHAR_BIT;
+}
+
+template<typename T>
+inline void
+CountingBloomFilter<T>::to_bloom_filter(BloomFilter& bloom_filter,
+                                        const T threshold) const
+{
+  check_error(hash_num != bloom_filter.hash_num,
+              "CountingBloomFilter: numbers of hash values differ (" +
+                std::to_string(hash_num) + " vs " +
+                std::to_string(bloom_filter.hash_num) + ").");
+  const size_t target_bits = bloom_filter.array_bits;
+  check_error(target_bits == 0 || array_size % target_bits != 0,
+              "CountingBloomFilter: Bloom filter bits (" +
+                std::to_string(target_bits) +
+                ") must evenly divide the number of counters (" +
+                std::to_string(array_size) + ").");
+  // hash % target_bits == (hash % array_size) % target_bits when target_bits
+  // divides array_size, so every counter maps to exactly one target bit.
+  const auto* const data = (const T*)array.get();
+  auto* const bits = (uint8_t*)bloom_filter.array.get();
+  const auto size = array_size;
+  const auto target_bytes = bloom_filter.array_size;
+// NOLINTNEXTLINE(openmp-use-default-none,-warnings-as-errors)
+#pragma omp parallel for
+  for (size_t byte = 0; byte < target_bytes; ++byte) {
+    uint8_t out = 0;
+    for (size_t offset = byte * CHAR_BIT; offset < size;
+         offset += target_bits) {
+      for (unsigned bit = 0; bit < CHAR_BIT; ++bit) {
+        out |= data[offset + bit] >= threshold ? BIT_MASKS[bit] : 0;
+      }
+    }
+    bits[byte] = out;
+  }
+}
+
+template<typename T>
+inline std::unique_ptr<BloomFilter>
+CountingBloomFilter<T>::to_bloom_filter(const T threshold,
+                                        const size_t bytes) const
+{
+  std::unique_ptr<BloomFilter> bloom_filter( // NOLINT(modernize-make-unique)
+    new BloomFilter(get_bloom_filter_bytes(bytes), hash_num, hash_fn));
+  to_bloom_filter(*bloom_filter, threshold);
+  return bloom_filter;
+}
+
 template<typename T>
 inline CountingBloomFilter<T>::CountingBloomFilter(const std::string& path)
   : CountingBloomFilter<T>::CountingBloomFilter(
@@ -360,6 +584,104 @@ KmerCountingBloomFilter<T>::contains_insert_thresh(const char* seq,
   return sum;
 }
 
+template<typename T>
+inline void
+KmerCountingBloomFilter<T>::check_compatible(
+  const KmerCountingBloomFilter& other) const
+{
+  check_error(k != other.k,
+              "KmerCountingBloomFilter: k-mer sizes differ (" +
+                std::to_string(k) + " vs " + std::to_string(other.k) + ").");
+}
+
+template<typename T>
+inline std::shared_ptr<BloomFilterInitializer>
+KmerCountingBloomFilter<T>::open_compatible(const std::string& path) const
+{
+  auto bfi = std::make_shared<BloomFilterInitializer>(
+    path, KMER_COUNTING_BLOOM_FILTER_SIGNATURE);
+  const auto loaded_k = *(bfi->table->get_as<decltype(k)>("k"));
+  check_error(k != loaded_k,
+              "KmerCountingBloomFilter: k-mer sizes differ (" +
+                std::to_string(k) + " vs " + std::to_string(loaded_k) + ").");
+  return bfi;
+}
+
+template<typename T>
+inline void
+KmerCountingBloomFilter<T>::add(const KmerCountingBloomFilter& other)
+{
+  check_compatible(other);
+  counting_bloom_filter.add(other.counting_bloom_filter);
+}
+
+template<typename T>
+inline void
+KmerCountingBloomFilter<T>::add(const std::string& path)
+{
+  counting_bloom_filter.combine(open_compatible(path),
+                                CountingBloomFilter<T>::saturating_add);
+}
+
+template<typename T>
+inline void
+KmerCountingBloomFilter<T>::subtract(const KmerCountingBloomFilter& other)
+{
+  check_compatible(other);
+  counting_bloom_filter.subtract(other.counting_bloom_filter);
+}
+
+template<typename T>
+inline void
+KmerCountingBloomFilter<T>::subtract(const std::string& path)
+{
+  counting_bloom_filter.combine(open_compatible(path),
+                                CountingBloomFilter<T>::saturating_subtract);
+}
+
+template<typename T>
+inline void
+KmerCountingBloomFilter<T>::max(const KmerCountingBloomFilter& other)
+{
+  check_compatible(other);
+  counting_bloom_filter.max(other.counting_bloom_filter);
+}
+
+template<typename T>
+inline void
+KmerCountingBloomFilter<T>::max(const std::string& path)
+{
+  counting_bloom_filter.combine(open_compatible(path),
+                                CountingBloomFilter<T>::maximum);
+}
+
+template<typename T>
+inline void
+KmerCountingBloomFilter<T>::to_bloom_filter(KmerBloomFilter& kmer_bloom_filter,
+                                            const T threshold) const
+{
+  check_error(k != kmer_bloom_filter.k,
+              "KmerCountingBloomFilter: k-mer sizes differ (" +
+                std::to_string(k) + " vs " +
+                std::to_string(kmer_bloom_filter.k) + ").");
+  counting_bloom_filter.to_bloom_filter(kmer_bloom_filter.bloom_filter,
+                                        threshold);
+}
+
+template<typename T>
+inline std::unique_ptr<KmerBloomFilter>
+KmerCountingBloomFilter<T>::to_bloom_filter(const T threshold,
+                                            const size_t bytes) const
+{
+  const auto bloom_filter_bytes =
+    counting_bloom_filter.get_bloom_filter_bytes(bytes);
+  std::unique_ptr<KmerBloomFilter>
+    kmer_bloom_filter( // NOLINT(modernize-make-unique)
+      new KmerBloomFilter(bloom_filter_bytes, get_hash_num(), k));
+  to_bloom_filter(*kmer_bloom_filter, threshold);
+  return kmer_bloom_filter;
+}
+
 template<typename T>
 inline KmerCountingBloomFilter<T>::KmerCountingBloomFilter(
   const std::string& path)
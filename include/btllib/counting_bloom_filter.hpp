@@ -249,6 +249,93 @@ public:
     return contains_insert_thresh(hashes.data(), threshold);
   }
 
+  /**
+   * Add the counters of another filter to this one, saturating at the maximum
+   * counter value. Both filters must have the same size and number of hashes.
+   *
+   * @param other Filter to add.
+   */
+  void add(const CountingBloomFilter& other);
+
+  /**
+   * Add the counters of a saved filter to this one, streaming it from disk
+   * instead of loading it into memory.
+   *
+   * @param path Filepath of a saved (k-mer) counting Bloom filter.
+   */
+  void add(const std::string& path);
+
+  /**
+   * Subtract the counters of another filter from this one, saturating at zero.
+   * Both filters must have the same size and number of hashes.
+   *
+   * @param other Filter to subtract.
+   */
+  void subtract(const CountingBloomFilter& other);
+
+  /**
+   * Subtract the counters of a saved filter from this one, streaming it from
+   * disk instead of loading it into memory.
+   *
+   * @param path Filepath of a saved (k-mer) counting Bloom filter.
+   */
+  void subtract(const std::string& path);
+
+  /**
+   * Set each counter to the maximum of itself and the corresponding counter of
+   * another filter. Both filters must have the same size and number of hashes.
+   *
+   * @param other Filter to take the maximum with.
+   */
+  void max(const CountingBloomFilter& other);
+
+  /**
+   * Set each counter to the maximum of itself and the corresponding counter of
+   * a saved filter, streaming it from disk instead of loading it into memory.
+   *
+   * @param path Filepath of a saved (k-mer) counting Bloom filter.
+   */
+  void max(const std::string& path);
+
+  /**
+   * Get the histogram of counter values. Useful as a proxy for the k-mer
+   * spectrum of the inserted data.
+   *
+   * @param max_count Counters larger than this are accumulated in the last bin.
+   *
+   * @return Vector of size max_count + 1 where element i is the number of
+   * counters with the value i.
+   */
+  std::vector<uint64_t> get_histogram(
+    T max_count = DEFAULT_HISTOGRAM_MAX_COUNT) const;
+
+  /**
+   * Set the bits of a Bloom filter for the counters that are >= threshold.
+   * The resulting filter answers contains() queries the same way as
+   * contains() >= threshold on this filter. The target filter must have the
+   * same number of hashes and its number of bits must evenly divide the number
+   * of counters in this filter. If it is smaller, counters are folded onto
+   * the target bits, which is equivalent to re-inserting the elements into it.
+   * Existing contents of the target filter are overwritten.
+   *
+   * @param bloom_filter Target Bloom filter.
+   * @param threshold Minimum count of elements kept in the Bloom filter.
+   */
+  void to_bloom_filter(BloomFilter& bloom_filter, T threshold = 1) const;
+
+  /**
+   * Create a Bloom filter containing elements with count >= threshold.
+   *
+   * @param threshold Minimum count of elements kept in the Bloom filter.
+   * @param bytes Size of the Bloom filter in bytes. The default of 0 uses one
+   * bit per counter of this filter. Otherwise, the number of bits must evenly
+   * divide the number of counters.
+   *
+   * @return The new Bloom filter.
+   */
+  std::unique_ptr<BloomFilter> to_bloom_filter(T threshold = 1,
+                                               size_t bytes = 0) const;
+
   /** Get filter size in bytes. */
   size_t get_bytes() const { return bytes; }
   /** Get population count, i.e. the number of counters >= threshold in the
@@ -286,11 +373,44 @@ public:
       path, COUNTING_BLOOM_FILTER_SIGNATURE);
   }
 
+  /** Default histogram size cap. Avoids allocating 2^32 bins for 32-bit
+   * counters. */
+  static constexpr T DEFAULT_HISTOGRAM_MAX_COUNT =
+    std::numeric_limits<T>::max() > std::numeric_limits<uint16_t>::max()
+      ? T(std::numeric_limits<uint16_t>::max())
+      : std::numeric_limits<T>::max();
+
 private:
+  /** Size of the buffer used when streaming a saved filter from disk. */
+  static constexpr size_t COMBINE_CHUNK_BYTES = 16ULL * 1024ULL * 1024ULL;
+  /** Number of interleaved per-thread histogram lanes. */
+  static constexpr size_t HISTOGRAM_LANES = 4;
+
   CountingBloomFilter(const std::shared_ptr<BloomFilterInitializer>& bfi);
 
   void set(const uint64_t* hashes, T min_val, T new_val);
 
+  size_t get_bloom_filter_bytes(size_t bytes) const;
+
+  void check_compatible(size_t other_bytes,
+                        unsigned other_hash_num,
+                        size_t other_counter_bits,
+                        const std::string& other_hash_fn) const;
+  template<typename Op>
+  void combine(const CountingBloomFilter& other, Op op);
+  template<typename Op>
+  void combine(const std::shared_ptr<BloomFilterInitializer>& bfi, Op op);
+  static std::shared_ptr<BloomFilterInitializer> open_counting_bloom_file(
+    const std::string& path);
+
+  static T saturating_add(T a, T b)
+  {
+    const T sum = T(a + b);
+    return sum < a ? std::numeric_limits<T>::max() : sum;
+  }
+  static T saturating_subtract(T a, T b) { return a > b ? T(a - b) : T(0); }
+  static T maximum(T a, T b) { return a > b ? a : b; }
+
   friend class KmerCountingBloomFilter<T>;
 
   size_t bytes = 0;
@@ -701,6 +821,98 @@ public:
     return counting_bloom_filter.contains_insert_thresh(hashes, threshold);
   }
 
+  /**
+   * Add the counters of another k-mer filter to this one, saturating at the
+   * maximum counter value. Both filters must have the same size, number of
+   * hashes and k-mer size.
+   *
+   * @param other Filter to add.
+   */
+  void add(const KmerCountingBloomFilter& other);
+
+  /**
+   * Add the counters of a saved k-mer filter to this one, streaming it from
+   * disk instead of loading it into memory.
+   *
+   * @param path Filepath of a saved k-mer counting Bloom filter.
+   */
+  void add(const std::string& path);
+
+  /**
+   * Subtract the counters of another k-mer filter from this one, saturating at
+   * zero. Both filters must have the same size, number of hashes and k-mer
+   * size.
+   *
+   * @param other Filter to subtract.
+   */
+  void subtract(const KmerCountingBloomFilter& other);
+
+  /**
+   * Subtract the counters of a saved k-mer filter from this one, streaming it
+   * from disk instead of loading it into memory.
+   *
+   * @param path Filepath of a saved k-mer counting Bloom filter.
+   */
+  void subtract(const std::string& path);
+
+  /**
+   * Set each counter to the maximum of itself and the corresponding counter of
+   * another k-mer filter. Both filters must have the same size, number of
+   * hashes and k-mer size.
+   *
+   * @param other Filter to take the maximum with.
+   */
+  void max(const KmerCountingBloomFilter& other);
+
+  /**
+   * Set each counter to the maximum of itself and the corresponding counter of
+   * a saved k-mer filter, streaming it from disk instead of loading it into
+   * memory.
+   *
+   * @param path Filepath of a saved k-mer counting Bloom filter.
+   */
+  void max(const std::string& path);
+
+  /**
+   * Get the histogram of counter values. Useful as a proxy for the k-mer
+   * spectrum of the inserted data.
+   *
+   * @param max_count Counters larger than this are accumulated in the last bin.
+   *
+   * @return Vector of size max_count + 1 where element i is the number of
+   * counters with the value i.
+   */
+  std::vector<uint64_t> get_histogram(
+    T max_count = CountingBloomFilter<T>::DEFAULT_HISTOGRAM_MAX_COUNT) const
+  {
+    return counting_bloom_filter.get_histogram(max_count);
+  }
+
+  /**
+   * Set the bits of a k-mer Bloom filter for the counters that are >=
+   * threshold. The target filter must have the same number of hashes and k-mer
+   * size, and its number of bits must evenly divide the number of counters in
+   * this filter. Existing contents of the target filter are overwritten.
+   *
+   * @param kmer_bloom_filter Target k-mer Bloom filter.
+   * @param threshold Minimum count of k-mers kept in the Bloom filter.
+   */
+  void to_bloom_filter(KmerBloomFilter& kmer_bloom_filter,
+                       T threshold = 1) const;
+
+  /**
+   * Create a k-mer Bloom filter containing k-mers with count >= threshold.
+   *
+   * @param threshold Minimum count of k-mers kept in the Bloom filter.
+   * @param bytes Size of the Bloom filter in bytes. The default of 0 uses one
+   * bit per counter of this filter. Otherwise, the number of bits must evenly
+   * divide the number of counters.
+   *
+   * @return The new k-mer Bloom filter.
+   */
+  std::unique_ptr<KmerBloomFilter> to_bloom_filter(T threshold = 1,
+                                                   size_t bytes = 0) const;
+
   /** Get filter size in bytes. */
   size_t get_bytes() const { return counting_bloom_filter.get_bytes(); }
   /** Get population count, i.e. the number of counters >0 in the filter. */
@@ -760,6 +972,10 @@ public:
 private:
   KmerCountingBloomFilter(const std::shared_ptr<BloomFilterInitializer>& bfi);
 
+  void check_compatible(const KmerCountingBloomFilter& other) const;
+  std::shared_ptr<BloomFilterInitializer> open_compatible(
+    const std::string& path) const;
+
   unsigned k = 0;
   CountingBloomFilter<T> counting_bloom_filter;
 };
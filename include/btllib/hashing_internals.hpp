@@ -1,9 +1,14 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <limits>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
+
 namespace btllib::hashing_internals {
 
 using NUM_HASHES_TYPE = uint8_t;
@@ -26,7 +31,7 @@ static_assert(std::numeric_limits<uint64_t>::max() + 1 == 0,
  * @param x A 64-bit unsigned integer
  * @return Split-rotation result
  */
-inline uint64_t
+constexpr uint64_t
 srol(const uint64_t x)
 {
   uint64_t m = ((x & 0x8000000000000000ULL) >> 30) | // NOLINT
@@ -65,7 +70,7 @@ srol_table(unsigned char c, unsigned d);
  * @param x A 64-bit unsigned integer
  * @return Split-rotation result
  */
-inline uint64_t
+constexpr uint64_t
 sror(const uint64_t x)
 {
   uint64_t m = ((x & 0x200000000ULL) << 30) | ((x & 1ULL) << 32); // NOLINT
@@ -121,6 +126,218 @@ extend_hashes(uint64_t base_hash, unsigned k, unsigned h, uint64_t* hash_array)
   }
 }
 
+/**
+ * Extend the hash arrays of a batch of k-mers. Equivalent to calling
+ * extend_hashes() for each k-mer.
+ * @param fwd_hashes Forward hash values of the k-mers
+ * @param rev_hashes Reverse hash values of the k-mers
+ * @param n Number of k-mers
+ * @param k k-mer size
+ * @param h Number of hashes per k-mer
+ * @param hash_arrays Output array, the hashes of k-mer i are stored starting
+ * at hash_arrays[i * stride]
+ * @param stride Distance between the hash arrays of consecutive k-mers, at
+ * least h
+ */
+inline void
+extend_hashes_batch_scalar(const uint64_t* fwd_hashes,
+                           const uint64_t* rev_hashes,
+                           size_t n,
+                           unsigned k,
+                           unsigned h,
+                           uint64_t* hash_arrays,
+                           size_t stride)
+{
+  for (size_t j = 0; j < n; j++) {
+    extend_hashes(fwd_hashes[j], rev_hashes[j], k, h, hash_arrays + j * stride);
+  }
+}
+
+// The SIMD kernels are hidden from SWIG, which cannot parse their target
+// attributes and vector types
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(SWIG)
+/// @cond HIDDEN_SYMBOLS
+// With many hashes per k-mer, the SIMD kernels compute several extensions of
+// one k-mer per instruction, so that each hash array is written with
+// contiguous (masked) stores. Lane i of a chunk holds the multiplier of
+// extension i, and lane 0 is then overwritten with the canonical hash. With
+// few hashes per k-mer, AVX-512 instead computes one extension of 8 k-mers at
+// a time and writes it with a scatter; AVX2 has no scatter and is not used.
+const unsigned SIMD_MIN_HASHES = 8;
+
+__attribute__((target("avx2"))) inline void
+extend_hashes_batch_avx2(const uint64_t* fwd_hashes,
+                         const uint64_t* rev_hashes,
+                         size_t n,
+                         unsigned k,
+                         unsigned h,
+                         uint64_t* hash_arrays,
+                         size_t stride)
+{
+  const unsigned lanes = 4;
+  const __m256i index = _mm256_set_epi64x(3, 2, 1, 0);
+  const __m256i seed = _mm256_set1_epi64x(int64_t(k * MULTISEED));
+  for (size_t j = 0; j < n; j++) {
+    const uint64_t base_hash = canonical(fwd_hashes[j], rev_hashes[j]);
+    const __m256i base = _mm256_set1_epi64x(int64_t(base_hash));
+    const __m256i base_high = _mm256_set1_epi64x(int64_t(base_hash >> 32));
+    uint64_t* const hash_array = hash_arrays + j * stride;
+    for (unsigned i = 0; i < h; i += lanes) {
+      const __m256i offset = _mm256_set1_epi64x(i);
+      const __m256i mul =
+        _mm256_xor_si256(_mm256_add_epi64(index, offset), seed);
+      // AVX2 has no 64-bit multiplication, so it is composed of 32-bit ones
+      const __m256i cross =
+        _mm256_add_epi64(_mm256_mul_epu32(base_high, mul),
+                         _mm256_mul_epu32(base, _mm256_srli_epi64(mul, 32)));
+      __m256i t_val = _mm256_add_epi64(_mm256_mul_epu32(base, mul),
+                                       _mm256_slli_epi64(cross, 32));
+      t_val = _mm256_xor_si256(t_val, _mm256_srli_epi64(t_val, MULTISHIFT));
+      const __m256i mask =
+        _mm256_cmpgt_epi64(_mm256_set1_epi64x(h - i), index);
+      _mm256_maskstore_epi64(
+        reinterpret_cast<long long*>(hash_array + i), mask, t_val); // NOLINT
+    }
+    hash_array[0] = base_hash;
+  }
+}
+
+__attribute__((target("avx512f,avx512dq"))) inline void
+extend_hashes_batch_avx512(const uint64_t* fwd_hashes,
+                           const uint64_t* rev_hashes,
+                           size_t n,
+                           unsigned k,
+                           unsigned h,
+                           uint64_t* hash_arrays,
+                           size_t stride)
+{
+  const unsigned lanes = 8;
+  const __m512i index = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+  if (h < SIMD_MIN_HASHES) {
+    const __m512i offsets = _mm512_mullo_epi64(
+      index, _mm512_set1_epi64(int64_t(stride * sizeof(uint64_t))));
+    size_t j = 0;
+    for (; j + lanes <= n; j += lanes) {
+      const __m512i base = _mm512_add_epi64(
+        _mm512_loadu_si512(fwd_hashes + j), _mm512_loadu_si512(rev_hashes + j));
+      uint64_t* const hash_array = hash_arrays + j * stride;
+      _mm512_i64scatter_epi64(hash_array, offsets, base, 1);
+      for (unsigned i = 1; i < h; i++) {
+        const __m512i mul = _mm512_set1_epi64(int64_t(i ^ k * MULTISEED));
+        __m512i t_val = _mm512_mullo_epi64(base, mul);
+        // The zero-masked shift avoids a spurious uninitialized warning in GCC
+        const __m512i shifted =
+          _mm512_maskz_srli_epi64(__mmask8(0xFF), t_val, MULTISHIFT);
+        t_val = _mm512_xor_si512(t_val, shifted);
+        _mm512_i64scatter_epi64(hash_array + i, offsets, t_val, 1);
+      }
+    }
+    extend_hashes_batch_scalar(fwd_hashes + j,
+                               rev_hashes + j,
+                               n - j,
+                               k,
+                               h,
+                               hash_arrays + j * stride,
+                               stride);
+    return;
+  }
+  const __m512i seed = _mm512_set1_epi64(int64_t(k * MULTISEED));
+  for (size_t j = 0; j < n; j++) {
+    const uint64_t base_hash = canonical(fwd_hashes[j], rev_hashes[j]);
+    const __m512i base = _mm512_set1_epi64(int64_t(base_hash));
+    uint64_t* const hash_array = hash_arrays + j * stride;
+    for (unsigned i = 0; i < h; i += lanes) {
+      const __m512i offset = _mm512_set1_epi64(i);
+      const __m512i mul =
+        _mm512_xor_si512(_mm512_add_epi64(index, offset), seed);
+      __m512i t_val = _mm512_mullo_epi64(base, mul);
+      const __m512i shifted =
+        _mm512_maskz_srli_epi64(__mmask8(0xFF), t_val, MULTISHIFT);
+      t_val = _mm512_xor_si512(t_val, shifted);
+      const unsigned left = h - i;
+      const __mmask8 mask = left >= lanes ? 0xFF : (1U << left) - 1;
+      _mm512_mask_storeu_epi64(hash_array + i, mask, t_val);
+    }
+    hash_array[0] = base_hash;
+  }
+}
+/// @endcond
+#endif
+
+/**
+ * Instruction sets usable by the batch hashing kernels.
+ */
+enum class SimdLevel
+{
+  SCALAR,
+  AVX2,
+  AVX512
+};
+
+/**
+ * Get the best instruction set supported by the running CPU. Detected once.
+ * @return Instruction set used by extend_hashes_batch()
+ */
+inline SimdLevel
+get_simd_level()
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+  static const SimdLevel level = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512dq")) {
+      return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+      return SimdLevel::AVX2;
+    }
+    return SimdLevel::SCALAR;
+  }();
+  return level;
+#else
+  return SimdLevel::SCALAR;
+#endif
+}
+
+/**
+ * Extend the hash arrays of a batch of k-mers using the widest SIMD
+ * instructions supported by the CPU. Same output as
+ * extend_hashes_batch_scalar().
+ * @param level Instruction set to use, must be supported by the CPU
+ */
+inline void
+extend_hashes_batch(const uint64_t* fwd_hashes,
+                    const uint64_t* rev_hashes,
+                    size_t n,
+                    unsigned k,
+                    unsigned h,
+                    uint64_t* hash_arrays,
+                    size_t stride,
+                    SimdLevel level = get_simd_level())
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+  switch (level) {
+    case SimdLevel::AVX512:
+      extend_hashes_batch_avx512(
+        fwd_hashes, rev_hashes, n, k, h, hash_arrays, stride);
+      return;
+    case SimdLevel::AVX2:
+      if (h >= SIMD_MIN_HASHES) {
+        extend_hashes_batch_avx2(
+          fwd_hashes, rev_hashes, n, k, h, hash_arrays, stride);
+        return;
+      }
+      break;
+    default:
+      break;
+  }
+#else
+  (void)level;
+#endif
+  extend_hashes_batch_scalar(
+    fwd_hashes, rev_hashes, n, k, h, hash_arrays, stride);
+}
+
 // offset for the complement base in the random seeds table
 const uint8_t CP_OFF = 0x07;
 
@@ -133,7 +350,7 @@ const uint64_t SEED_N = 0x0000000000000000;
 
 const int ASCII_SIZE = 256;
 
-const uint64_t SEED_TAB[ASCII_SIZE] = {
+constexpr uint64_t SEED_TAB[ASCII_SIZE] = {
   SEED_N, SEED_T, SEED_N, SEED_G, SEED_A, SEED_A, SEED_N, SEED_C, // 0..7
   SEED_N, SEED_N, SEED_N, SEED_N, SEED_N, SEED_N, SEED_N, SEED_N, // 8..15
   SEED_N, SEED_N, SEED_N, SEED_N, SEED_N, SEED_N, SEED_N, SEED_N, // 16..23
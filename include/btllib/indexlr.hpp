@@ -5,6 +5,7 @@
 #include "btllib/nthash.hpp"
 #include "btllib/order_queue.hpp"
 #include "btllib/seq_reader.hpp"
+#include "btllib/sketch.hpp"
 #include "btllib/status.hpp"
 #include "btllib/util.hpp"
 
@@ -146,7 +147,8 @@ public:
    * stdin.
    * @param k k-mer size for the minimizer.
    * @param w window size when selecting minimizers.
-   * @param q quality threshold to ignore potential minimizers.
+   * @param q quality threshold to ignore potential minimizers. If greater than
+   * 0, every sequence must have quality scores.
    * @param flags Modifier flags. Specifiying either short or long mode flag is
    * mandatory; other flags are optional.
    * @param threads Maximum number of processing threads to use. Must be at
@@ -231,19 +233,13 @@ private:
                                  const BloomFilter& filter_out_bf);
 
   static void filter_kmer_qual(Indexlr::HashedKmer& hk,
-                               const std::string& kmer_qual,
+                               const std::vector<size_t>& qual_sums,
+                               size_t k,
                                size_t q);
-  static size_t calc_kmer_quality(const std::string& qual);
-
-  static void calc_minimizer(
-    const std::vector<Indexlr::HashedKmer>& hashed_kmers_buffer,
-    const Indexlr::Minimizer*& min_current,
-    size_t idx,
-    ssize_t& min_idx_left,
-    ssize_t& min_idx_right,
-    ssize_t& min_pos_prev,
-    size_t w,
-    std::vector<Indexlr::Minimizer>& minimizers);
+  static void calc_qual_sums(const std::string& qual,
+                             size_t seq_len,
+                             std::vector<size_t>& qual_sums);
+
   std::vector<Minimizer> minimize(const std::string& seq,
                                   const std::string& qual) const;
 
@@ -415,29 +411,17 @@ Indexlr::close() noexcept
 // Minimerize a sequence: Find the minimizers of a vector of hash values
 // representing a sequence.
 /* Algorithm
-v is a vector of non-negative integers
-w is the window size
-Invariants
-    0 <  w <= v.size() - 1
-    0 <= l <= r <= v.size() - 1
-Initial conditions
-    M    = NIL       Final set of minimizers, empty initially
-    min  = -1        Minimum element
-    i    = -1        Index of minimum element
-    prev = -1        Index of previous minimum element
-    l    = 0         Index of left end of window
-    r    = l + w - 1 Index of right end of window
-Computation
-At each window, if the previous minimum is out of scope, find the new,
-right-most, minimum or else, check with only the right-most element to determine
-if that is the new minimum. A minimizer is added to the final vector only if
-it's index has changed. for each window of v bounded by [l, r] if (i < l) i =
-index of minimum element in [l, r], furthest from l. else if (v[r] <= v[i]) i =
-r min = v[i] if (i != prev) { prev = i M <- M + m
-    }
-    l = l + 1        Move window's left bound by one element
-    r = l + w - 1    Set window's right bound
-}*/
+The minimizer of a window of w consecutive k-mers is its k-mer with the
+smallest hash value, the right-most one on ties. The hash values of the
+k-mers are pushed into a MinimizerSelector, which keeps the candidates for
+the minimizers of the current and future windows in a monotone deque: pushing
+a hash value removes all candidates with larger or equal hash values, as they
+can no longer be the right-most minimum of any window. The first candidate is
+the minimizer of the window and leaves the deque when it leaves the window.
+Every k-mer enters and leaves the deque at most once, so each k-mer takes O(1)
+amortized time regardless of w. A minimizer is added to the final vector only
+if its index has changed and it was not filtered out.
+*/
 
 inline std::string
 Indexlr::extract_barcode(const std::string& id, const std::string& comment)
@@ -487,66 +471,32 @@ Indexlr::filter_hashed_kmer(Indexlr::HashedKmer& hk,
 
 inline void
 Indexlr::filter_kmer_qual(Indexlr::HashedKmer& hk,
-                          const std::string& kmer_qual,
-                          size_t q)
+                          const std::vector<size_t>& qual_sums,
+                          const size_t k,
+                          const size_t q)
 {
-  if (calc_kmer_quality(kmer_qual) < q) {
+  // Mean Phred score of the k-mer (potential improvement: use other
+  // statistics)
+  if ((qual_sums[hk.pos + k] - qual_sums[hk.pos]) / k < q) {
     hk.min_hash = std::numeric_limits<uint64_t>::max();
   }
 }
 
-inline size_t
-Indexlr::calc_kmer_quality(const std::string& qual)
-{
-  // convert the quality scores to integers
-  std::vector<int> qual_ints;
-  const int thirty_three = 33;
-  qual_ints.reserve(qual.size());
-  for (auto c : qual) {
-    qual_ints.push_back(c - thirty_three);
-  }
-  // calculate the mean (potential improvement: use other statistics)
-  size_t sum = 0;
-  for (auto q : qual_ints) {
-    sum += q;
-  }
-  return (sum / qual_ints.size());
-}
-
 inline void
-Indexlr::calc_minimizer(
-  const std::vector<Indexlr::HashedKmer>& hashed_kmers_buffer,
-  const Indexlr::Minimizer*& min_current,
-  const size_t idx,
-  ssize_t& min_idx_left,
-  ssize_t& min_idx_right,
-  ssize_t& min_pos_prev,
-  const size_t w,
-  std::vector<Indexlr::Minimizer>& minimizers)
+Indexlr::calc_qual_sums(const std::string& qual,
+                        const size_t seq_len,
+                        std::vector<size_t>& qual_sums)
 {
-  min_idx_left = ssize_t(idx + 1 - w);
-  min_idx_right = ssize_t(idx + 1);
-  const auto& min_left =
-    hashed_kmers_buffer[min_idx_left % hashed_kmers_buffer.size()];
-  const auto& min_right =
-    hashed_kmers_buffer[(min_idx_right - 1) % hashed_kmers_buffer.size()];
-
-  if (min_current == nullptr || min_current->pos < min_left.pos) {
-    min_current = &min_left;
-    // Use of operator '<=' returns the minimum that is furthest from left.
-    for (ssize_t i = min_idx_left; i < min_idx_right; i++) {
-      const auto& min_i = hashed_kmers_buffer[i % hashed_kmers_buffer.size()];
-      if (min_i.min_hash <= min_current->min_hash) {
-        min_current = &min_i;
-      }
-    }
-  } else if (min_right.min_hash <= min_current->min_hash) {
-    min_current = &min_right;
-  }
-  if (ssize_t(min_current->pos) > min_pos_prev &&
-      min_current->min_hash != std::numeric_limits<uint64_t>::max()) {
-    min_pos_prev = ssize_t(min_current->pos);
-    minimizers.push_back(*min_current);
+  check_error(qual.size() < seq_len,
+              "Indexlr: quality filtering requires a quality score for every "
+              "base, e.g. FASTQ input.");
+  // qual_sums[i] is the sum of the Phred scores of the first i bases, so the
+  // quality of any k-mer takes two lookups
+  const int thirty_three = 33;
+  qual_sums.resize(seq_len + 1);
+  qual_sums[0] = 0;
+  for (size_t i = 0; i < seq_len; i++) {
+    qual_sums[i + 1] = qual_sums[i] + (qual[i] - thirty_three);
   }
 }
 
@@ -558,37 +508,46 @@ Indexlr::minimize(const std::string& seq, const std::string& qual) const
   }
   std::vector<Minimizer> minimizers;
   minimizers.reserve(2 * (seq.size() - k + 1) / w);
-  std::vector<HashedKmer> hashed_kmers_buffer(w + 1);
-  ssize_t min_idx_left, min_idx_right, min_pos_prev = -1;
-  const Minimizer* min_current = nullptr;
+  // Candidate minimizers, indexed by the number of k-mers hashed before them
+  // modulo w. Their sequence and quality are only extracted once they are
+  // selected.
+  std::vector<HashedKmer> hashed_kmers_buffer(w);
+  MinimizerSelector selector(w);
+  std::vector<size_t> qual_sums;
+  if (q > 0) {
+    calc_qual_sums(qual, seq.size(), qual_sums);
+  }
   size_t idx = 0;
-  for (NtHash nh(seq, 2, k); nh.roll(); ++idx) {
-    auto& hk = hashed_kmers_buffer[idx % hashed_kmers_buffer.size()];
+  for (NtHash nh(seq, 2, k); nh.roll();) {
+    auto& hk = hashed_kmers_buffer[idx];
 
-    hk = HashedKmer(nh.hashes()[0],
-                    nh.hashes()[1],
-                    nh.get_pos(),
-                    nh.get_forward_hash() <= nh.get_reverse_hash(),
-                    output_seq() ? seq.substr(nh.get_pos(), k) : "",
-                    output_qual() ? qual.substr(nh.get_pos(), k) : "");
+    hk.min_hash = nh.hashes()[0];
+    hk.out_hash = nh.hashes()[1];
+    hk.pos = nh.get_pos();
+    hk.forward = nh.get_forward_hash() <= nh.get_reverse_hash();
 
     filter_hashed_kmer(
       hk, filter_in(), filter_out(), filter_in_bf.get(), filter_out_bf.get());
 
     if (q > 0) {
-      filter_kmer_qual(hk, qual.substr(nh.get_pos(), k), q);
+      filter_kmer_qual(hk, qual_sums, k, q);
     }
 
-    if (idx + 1 >= w) {
-      calc_minimizer(hashed_kmers_buffer,
-                     min_current,
-                     idx,
-                     min_idx_left,
-                     min_idx_right,
-                     min_pos_prev,
-                     w,
-                     minimizers);
+    // A k-mer is selected at most once, so it can be moved out of the buffer
+    if (selector.push(hk.min_hash, hk.pos) &&
+        selector.get_hash() != std::numeric_limits<uint64_t>::max()) {
+      auto& min = hashed_kmers_buffer[selector.get_index() % w];
+      if (output_seq()) {
+        min.seq = seq.substr(min.pos, k);
+      }
+      if (output_qual()) {
+        min.qual = qual.substr(min.pos, k);
+      }
+      minimizers.push_back(std::move(min));
+      min.seq.clear();
+      min.qual.clear();
     }
+    idx = idx + 1 == w ? 0 : idx + 1;
   }
   return minimizers;
 }
@@ -7,8 +7,15 @@
 
 #include "cpptoml.h"
 
+#include <algorithm>
+#include <array>
 #include <climits>
 #include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
 
 #include <sdsl/bit_vector_il.hpp>
 #include <sdsl/rank_support.hpp>
@@ -73,11 +80,53 @@ MIBloomFilterInitializer::parse_header(const std::string& expected_signature)
   return header_config->get_table(header_string);
 }
 
+inline MIBloomFilterMapping::MIBloomFilterMapping(const std::string& path)
+{
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  check_error(fd < 0,
+              "MIBloomFilterMapping: failed to open " + path + ": " +
+                get_strerror());
+  struct stat info
+  {};
+  check_error(fstat(fd, &info) != 0,
+              "MIBloomFilterMapping: fstat failed: " + get_strerror());
+  length = size_t(info.st_size);
+  addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  check_error(addr == MAP_FAILED, // NOLINT(performance-no-int-to-ptr)
+              "MIBloomFilterMapping: mmap failed: " + get_strerror());
+}
+
+inline MIBloomFilterMapping::~MIBloomFilterMapping()
+{
+  munmap(addr, length);
+}
+
+/// @cond HIDDEN_SYMBOLS
+inline size_t
+align_mi_bloom_filter_offset(const size_t offset)
+{
+  return (offset + MI_BLOOM_FILTER_ALIGNMENT - 1) / MI_BLOOM_FILTER_ALIGNMENT *
+         MI_BLOOM_FILTER_ALIGNMENT;
+}
+/// @endcond
+
+template<typename T>
+inline bool
+MIBloomFilter<T>::is_single_file(const std::string& path)
+{
+  std::ifstream ifs(path);
+  std::string file_signature;
+  return MIBloomFilterInitializer::check_file_signature(
+    ifs, MI_BLOOM_FILTER_SINGLE_FILE_SIGNATURE, file_signature);
+}
+
 template<typename T>
 MIBloomFilter<T>::MIBloomFilter(const std::string& path)
-  : MIBloomFilter<T>::MIBloomFilter(
-      std::make_shared<MIBloomFilterInitializer>(path,
-                                                 MI_BLOOM_FILTER_SIGNATURE))
+  : MIBloomFilter<T>::MIBloomFilter(std::make_shared<MIBloomFilterInitializer>(
+      path,
+      is_single_file(path) ? MI_BLOOM_FILTER_SINGLE_FILE_SIGNATURE
+                           : MI_BLOOM_FILTER_SIGNATURE))
 {
 }
 
@@ -91,29 +140,196 @@ inline MIBloomFilter<T>::MIBloomFilter(
   , hash_fn(mibfi->table->contains("hash_fn")
               ? *(mibfi->table->get_as<decltype(hash_fn)>("hash_fn"))
               : "")
-
-  , id_array(new std::atomic<T>[id_array_size])
   , bv_insertion_completed(
       static_cast<bool>(*(mibfi->table->get_as<int>("bv_insertion_completed"))))
   , id_insertion_completed(
       static_cast<bool>(*(mibfi->table->get_as<int>("id_insertion_completed"))))
 {
-  // read id array
-  mibfi->ifs_id_arr.read((char*)id_array.get(),
-                         std::streamsize(id_array_size * sizeof(T)));
-  // read bv and bv rank support
-  sdsl::load_from_file(il_bit_vector, mibfi->path + ".sdsl");
-  bv_rank_support = sdsl::rank_support_il<1>(&il_bit_vector);
+  if (mibfi->table->contains("single_file")) {
+    load_mapped(mibfi);
+  } else {
+    // read id array
+    id_array_storage =
+      std::unique_ptr<std::atomic<T>[]>(new std::atomic<T>[id_array_size]);
+    id_array = id_array_storage.get();
+    mibfi->ifs_id_arr.read((char*)id_array,
+                           std::streamsize(id_array_size * sizeof(T)));
+    // read bv and build rank support
+    load_sdsl_bit_vector(mibfi->path + ".sdsl");
+
+    // init counts array
+    counts_array = std::unique_ptr<std::atomic<uint16_t>[]>(
+      new std::atomic<uint16_t>[id_array_size]);
+    std::memset(
+      (void*)counts_array.get(), 0, id_array_size * sizeof(counts_array[0]));
+  }
 
-  // init counts array
-  counts_array = std::unique_ptr<std::atomic<uint16_t>[]>(
-    new std::atomic<uint16_t>[id_array_size]);
-  std::memset(
-    (void*)counts_array.get(), 0, id_array_size * sizeof(counts_array[0]));
+  log_info("MIBloomFilter: Bit vector size: " +
+           std::to_string(rank_bit_vector.size()) +
+           "\nPopcount: " + std::to_string(get_pop_cnt()));
+}
 
-  log_info(
-    "MIBloomFilter: Bit vector size: " + std::to_string(il_bit_vector.size()) +
-    "\nPopcount: " + std::to_string(get_pop_cnt()));
+template<typename T>
+inline void
+MIBloomFilter<T>::load_mapped(
+  const std::shared_ptr<MIBloomFilterInitializer>& mibfi)
+{
+  const auto id_bits = *(mibfi->table->get_as<size_t>("id_bits"));
+  check_error(id_bits != sizeof(T) * CHAR_BIT,
+              "MIBloomFilter" + std::to_string(sizeof(T) * CHAR_BIT) +
+                " tried to load a file of MIBloomFilter" +
+                std::to_string(id_bits));
+  const auto bv_bits = *(mibfi->table->get_as<size_t>("bv_size"));
+  const unsigned id_width =
+    mibfi->table->contains("id_width")
+      ? unsigned(*(mibfi->table->get_as<size_t>("id_width")))
+      : 0;
+  const size_t dictionary_size =
+    mibfi->table->contains("id_dictionary_size")
+      ? *(mibfi->table->get_as<size_t>("id_dictionary_size"))
+      : 0;
+
+  // The data sections start at the first aligned offset after the header
+  const auto id_array_offset =
+    align_mi_bloom_filter_offset(size_t(mibfi->ifs_id_arr.tellg()));
+  const auto dictionary_offset =
+    id_width > 0 ? align_mi_bloom_filter_offset(
+                     id_array_offset +
+                     PackedIntArray::bytes(id_array_size, id_width))
+                 : id_array_offset;
+  const auto bv_offset =
+    id_width > 0
+      ? align_mi_bloom_filter_offset(dictionary_offset +
+                                     dictionary_size * sizeof(T))
+      : align_mi_bloom_filter_offset(id_array_offset +
+                                     id_array_size * sizeof(T));
+
+  mapping = std::unique_ptr<MIBloomFilterMapping>( // NOLINT
+    new MIBloomFilterMapping(mibfi->path));
+  check_error(mapping->size() < bv_offset + RankBitVector::bytes(bv_bits),
+              "MIBloomFilter: " + mibfi->path + " is truncated.");
+  if (id_width > 0) {
+    packed_ids = PackedIntArray::view(
+      (const uint64_t*)(mapping->data() + id_array_offset),
+      id_array_size,
+      id_width);
+    const T* const dictionary =
+      (const T*)(mapping->data() + dictionary_offset);
+    id_dictionary.assign(dictionary, dictionary + dictionary_size);
+    set_packed_layout(id_width);
+    compacted = true;
+  } else {
+    // std::atomic<T> has the same layout as T, which save() relies on as well
+    id_array = (std::atomic<T>*)(mapping->data() + id_array_offset);
+  }
+  madvise((void*)(mapping->data() + id_array_offset),
+          bv_offset - id_array_offset,
+          MADV_RANDOM);
+  // The rank blocks are used in place, so nothing is read until queried
+  rank_bit_vector = RankBitVector::view(
+    (const uint64_t*)(mapping->data() + bv_offset), bv_bits);
+}
+
+template<typename T>
+inline void
+MIBloomFilter<T>::set_packed_layout(const unsigned width)
+{
+  packed_flags_shift = width - 2;
+  packed_id_mask = (uint64_t(1) << packed_flags_shift) - 1;
+}
+
+template<typename T>
+inline void
+MIBloomFilter<T>::compact(const bool dictionary)
+{
+  assert(id_insertion_completed);
+  if (compacted) {
+    return;
+  }
+  check_writable();
+  T max_id = 0;
+  for (size_t i = 0; i < id_array_size; ++i) {
+    max_id = std::max(max_id, T(id_array[i] & ID_MASK));
+  }
+  // Two extra bits for the saturation and strand flags
+  unsigned width = PackedIntArray::width_of(max_id) + 2;
+
+  std::vector<T> distinct;
+  if (dictionary) {
+    std::unordered_map<T, uint64_t> frequencies;
+    for (size_t i = 0; i < id_array_size; ++i) {
+      ++frequencies[id_array[i]];
+    }
+    for (const auto& entry : frequencies) {
+      distinct.push_back(entry.first);
+    }
+    std::sort(distinct.begin(), distinct.end(), [&](const T a, const T b) {
+      return frequencies[a] != frequencies[b] ? frequencies[a] > frequencies[b]
+                                              : a < b;
+    });
+    const unsigned dictionary_width =
+      PackedIntArray::width_of(distinct.empty() ? 0 : distinct.size() - 1);
+    if (dictionary_width < width) {
+      width = dictionary_width;
+    } else {
+      distinct.clear();
+    }
+  }
+
+  PackedIntArray packed(id_array_size, width);
+  if (distinct.empty()) {
+    const unsigned flags_shift = width - 2;
+    for (size_t i = 0; i < id_array_size; ++i) {
+      const T id = id_array[i];
+      packed.set(i,
+                 uint64_t(id & ID_MASK) |
+                   (uint64_t(id >> (sizeof(T) * CHAR_BIT - 2)) << flags_shift));
+    }
+    set_packed_layout(width);
+  } else {
+    std::unordered_map<T, uint64_t> codes;
+    for (size_t code = 0; code < distinct.size(); ++code) {
+      codes[distinct[code]] = code;
+    }
+    for (size_t i = 0; i < id_array_size; ++i) {
+      packed.set(i, codes[id_array[i]]);
+    }
+  }
+  packed_ids = std::move(packed);
+  id_dictionary = std::move(distinct);
+  compacted = true;
+  id_array = nullptr;
+  id_array_storage.reset();
+  counts_array.reset();
+}
+
+template<typename T>
+inline void
+MIBloomFilter<T>::load_sdsl_bit_vector(const std::string& path)
+{
+  sdsl::bit_vector_il<BLOCKSIZE> il_bit_vector;
+  sdsl::load_from_file(il_bit_vector, path);
+  const size_t bits = il_bit_vector.size();
+  std::vector<uint64_t> words((bits + 63) / 64);
+  for (size_t w = 0; w < words.size(); ++w) {
+    const size_t i = w * 64;
+    words[w] =
+      il_bit_vector.get_int(i, uint8_t(std::min<size_t>(64, bits - i)));
+  }
+  rank_bit_vector = RankBitVector(words.data(), bits);
+}
+
+template<typename T>
+inline void
+MIBloomFilter<T>::save_sdsl_bit_vector(const std::string& path) const
+{
+  sdsl::bit_vector plain_bit_vector(rank_bit_vector.size());
+  uint64_t* const words = plain_bit_vector.data();
+  // Bits past the end are zero in both vectors
+  for (size_t w = 0; w < (rank_bit_vector.size() + 63) / 64; ++w) {
+    words[w] = rank_bit_vector.get_word(w);
+  }
+  sdsl::store_to_file(sdsl::bit_vector_il<BLOCKSIZE>(plain_bit_vector), path);
 }
 
 template<typename T>
@@ -155,12 +371,12 @@ MIBloomFilter<T>::insert_bv(const uint64_t* hashes)
 }
 template<typename T>
 inline bool
-MIBloomFilter<T>::bv_contains(const uint64_t* hashes)
+MIBloomFilter<T>::bv_contains(const uint64_t* hashes) const
 {
   assert(bv_insertion_completed);
   for (unsigned i = 0; i < hash_num; i++) {
-    uint64_t pos = hashes[i] % il_bit_vector.size();
-    if (il_bit_vector[pos] == 0) {
+    uint64_t pos = hashes[i] % rank_bit_vector.size();
+    if (!rank_bit_vector[pos]) {
       return false;
     }
   }
@@ -173,12 +389,13 @@ MIBloomFilter<T>::complete_bv_insertion()
   assert(!id_insertion_completed);
   bv_insertion_completed = true;
 
-  il_bit_vector = sdsl::bit_vector_il<BLOCKSIZE>(bit_vector);
-  bv_rank_support = sdsl::rank_support_il<1>(&il_bit_vector);
+  rank_bit_vector = RankBitVector(bit_vector.data(), bit_vector.size());
+  bit_vector = sdsl::bit_vector();
   id_array_size = get_pop_cnt();
-  id_array =
+  id_array_storage =
     std::unique_ptr<std::atomic<T>[]>(new std::atomic<T>[id_array_size]);
-  std::memset((void*)id_array.get(), 0, id_array_size * sizeof(std::atomic<T>));
+  id_array = id_array_storage.get();
+  std::memset((void*)id_array, 0, id_array_size * sizeof(std::atomic<T>));
   counts_array = std::unique_ptr<std::atomic<uint16_t>[]>(
     new std::atomic<uint16_t>[id_array_size]);
   std::memset(
@@ -189,6 +406,7 @@ inline void
 MIBloomFilter<T>::insert_id(const uint64_t* hashes, const T& id)
 {
   assert(bv_insertion_completed && !id_insertion_completed);
+  check_writable();
 
   uint32_t rand = std::rand(); // NOLINT
   for (unsigned i = 0; i < hash_num; ++i) {
@@ -208,14 +426,66 @@ MIBloomFilter<T>::get_id(const uint64_t* hashes)
 }
 template<typename T>
 inline void
+MIBloomFilter<T>::get_id(const uint64_t* hashes, T* ids) const
+{
+  for (unsigned i = 0; i < hash_num; ++i) {
+    ids[i] = get_data(get_rank_pos(hashes[i]));
+  }
+}
+template<typename T>
+inline void
+MIBloomFilter<T>::get_ids(const uint64_t* hashes,
+                          const size_t n_elements,
+                          T* ids) const
+{
+  const size_t n = n_elements * hash_num;
+  const size_t bv_bits = rank_bit_vector.size();
+  std::array<uint64_t, GET_IDS_BATCH> rank_pos{};
+  for (size_t start = 0; start < n; start += GET_IDS_BATCH) {
+    const size_t len = std::min(size_t(GET_IDS_BATCH), n - start);
+    // Stage 1: each rank query reads a single rank block. Prefetch all blocks
+    // of the batch first, then resolve the ranks and prefetch the ID array
+    // entries as soon as their positions are known.
+    for (size_t i = 0; i < len; ++i) {
+      rank_pos[i] = hashes[start + i] % bv_bits;
+      rank_bit_vector.prefetch(rank_pos[i]);
+    }
+    for (size_t i = 0; i < len; ++i) {
+      rank_pos[i] = rank_bit_vector.rank(rank_pos[i]);
+      prefetch_data(rank_pos[i]);
+    }
+    // Stage 2: read the (hopefully) cached ID array entries.
+    for (size_t i = 0; i < len; ++i) {
+      ids[start + i] = get_data(rank_pos[i]);
+    }
+  }
+}
+template<typename T>
+inline void
 MIBloomFilter<T>::insert_saturation(const uint64_t* hashes, const T& id)
+{
+  QueryBuffer buffer(hash_num);
+  insert_saturation(hashes, id, buffer);
+}
+template<typename T>
+inline void
+MIBloomFilter<T>::insert_saturation(const uint64_t* hashes,
+                                    const T& id,
+                                    QueryBuffer& buffer)
 {
   assert(id_insertion_completed);
-  std::vector<uint64_t> rank_pos = get_rank_pos(hashes);
-  std::vector<T> results = get_data(rank_pos);
-  std::vector<T> replacement_ids(hash_num);
+  check_writable();
+  get_rank_pos(hashes, buffer.rank_pos.data());
+  get_data(buffer.rank_pos.data(), buffer.ids.data());
+  const uint64_t* const rank_pos = buffer.rank_pos.data();
+  const T* const results = buffer.ids.data();
+  // Both sets start with a single empty (0) ID, which makes empty entries
+  // replaceable.
+  auto& replacement_ids = buffer.replacement_ids;
+  auto& seen_set = buffer.seen_set;
+  replacement_ids.assign(1, T(0));
+  seen_set.assign(1, T(0));
   bool value_found = false;
-  std::vector<T> seen_set(hash_num);
 
   for (unsigned i = 0; i < hash_num; i++) {
     T current_result = results[i] & (btllib::MIBloomFilter<T>::ANTI_MASK &
@@ -273,7 +543,7 @@ inline void
 MIBloomFilter<T>::set_saturated(const uint64_t* hashes)
 {
   for (unsigned i = 0; i < hash_num; ++i) {
-    uint64_t pos = bv_rank_support(hashes[i] % il_bit_vector.size());
+    uint64_t pos = get_rank_pos(hashes[i]);
     id_array[pos].fetch_or(MASK);
   }
 }
@@ -282,21 +552,33 @@ inline std::vector<uint64_t>
 MIBloomFilter<T>::get_rank_pos(const uint64_t* hashes) const
 {
   std::vector<uint64_t> rank_pos(hash_num);
+  get_rank_pos(hashes, rank_pos.data());
+  return rank_pos;
+}
+template<typename T>
+inline void
+MIBloomFilter<T>::get_rank_pos(const uint64_t* hashes,
+                               uint64_t* rank_pos) const
+{
   for (unsigned i = 0; i < hash_num; ++i) {
-    uint64_t pos = hashes[i] % il_bit_vector.size();
-    rank_pos[i] = bv_rank_support(pos);
+    rank_pos[i] = get_rank_pos(hashes[i]);
   }
-  return rank_pos;
 }
 template<typename T>
 inline std::vector<T>
 MIBloomFilter<T>::get_data(const std::vector<uint64_t>& rank_pos) const
 {
   std::vector<T> results(hash_num);
+  get_data(rank_pos.data(), results.data());
+  return results;
+}
+template<typename T>
+inline void
+MIBloomFilter<T>::get_data(const uint64_t* rank_pos, T* data) const
+{
   for (unsigned i = 0; i < hash_num; ++i) {
-    results[i] = id_array[rank_pos[i]];
+    data[i] = get_data(rank_pos[i]);
   }
-  return results;
 }
 template<typename T>
 inline void
@@ -320,7 +602,45 @@ MIBloomFilter<T>::save(const std::string& path,
 
 template<typename T>
 inline void
-MIBloomFilter<T>::save(const std::string& path)
+MIBloomFilter<T>::save_single_file(const std::string& path,
+                                   cpptoml::table& root)
+{
+  std::ofstream ofs(path.c_str(), std::ios::out | std::ios::binary);
+  check_error(!ofs, "MIBloomFilter: failed to open " + path);
+
+  ofs << root << "[HeaderEnd]\n";
+  for (unsigned i = 0; i < PLACEHOLDER_NEWLINES_MIBF; i++) {
+    if (i == 1) {
+      ofs << "  <binary data>";
+    }
+    ofs << '\n';
+  }
+  const std::string padding(MI_BLOOM_FILTER_ALIGNMENT, '\0');
+  const auto pad = [&]() {
+    const auto offset = size_t(ofs.tellp());
+    ofs.write(padding.data(),
+              std::streamsize(align_mi_bloom_filter_offset(offset) - offset));
+  };
+  pad();
+  if (compacted) {
+    ofs.write((const char*)packed_ids.data(),
+              std::streamsize(packed_ids.bytes()));
+    pad();
+    ofs.write((const char*)id_dictionary.data(),
+              std::streamsize(id_dictionary.size() * sizeof(T)));
+  } else {
+    ofs.write((const char*)id_array,
+              std::streamsize(id_array_size * sizeof(id_array[0])));
+  }
+  pad();
+  ofs.write((const char*)rank_bit_vector.data(),
+            std::streamsize(rank_bit_vector.bytes()));
+  check_error(!ofs, "MIBloomFilter: failed to write to " + path);
+}
+
+template<typename T>
+inline void
+MIBloomFilter<T>::save(const std::string& path, const bool single_file)
 {
   /* Initialize cpptoml root table
    *     Note: Tables and fields are unordered
@@ -342,12 +662,35 @@ MIBloomFilter<T>::save(const std::string& path)
   if (!hash_fn.empty()) {
     header->insert("hash_fn", get_hash_fn());
   }
-  std::string header_string = MI_BLOOM_FILTER_SIGNATURE;
+  std::string header_string = single_file
+                                ? MI_BLOOM_FILTER_SINGLE_FILE_SIGNATURE
+                                : MI_BLOOM_FILTER_SIGNATURE;
   header_string =
     header_string.substr(1, header_string.size() - 2); // Remove [ ]
+  if (single_file) {
+    header->insert("single_file", 1);
+    header->insert("id_bits", size_t(sizeof(T) * CHAR_BIT));
+    header->insert("bv_size", rank_bit_vector.size());
+    if (compacted) {
+      header->insert("id_width", size_t(packed_ids.get_width()));
+      header->insert("id_dictionary_size", id_dictionary.size());
+    }
+    root->insert(header_string, header);
+    save_single_file(path, *root);
+    return;
+  }
   root->insert(header_string, header);
-  save(path, *root, (char*)id_array.get(), id_array_size * sizeof(id_array[0]));
-  sdsl::store_to_file(il_bit_vector, path + ".sdsl");
+  if (compacted) {
+    // The v2 format only stores full width IDs
+    std::vector<T> ids(id_array_size);
+    for (size_t i = 0; i < id_array_size; ++i) {
+      ids[i] = get_data(i);
+    }
+    save(path, *root, (char*)ids.data(), id_array_size * sizeof(T));
+  } else {
+    save(path, *root, (char*)id_array, id_array_size * sizeof(id_array[0]));
+  }
+  save_sdsl_bit_vector(path + ".sdsl");
 }
 
 template<typename T>
@@ -355,11 +698,7 @@ inline uint64_t
 MIBloomFilter<T>::get_pop_cnt()
 {
   assert(bv_insertion_completed);
-  size_t index = il_bit_vector.size() - 1;
-  while (il_bit_vector[index] == 0) {
-    --index;
-  }
-  return bv_rank_support(index) + 1;
+  return rank_bit_vector.count();
 }
 template<typename T>
 inline uint64_t
@@ -367,7 +706,7 @@ MIBloomFilter<T>::get_pop_saturated_cnt()
 {
   size_t count = 0;
   for (size_t i = 0; i < id_array_size; ++i) {
-    if (id_array[i] >= MASK) {
+    if (get_data(i) >= MASK) {
       ++count;
     }
   }
@@ -386,12 +725,13 @@ MIBloomFilter<T>::get_id_occurence_count(const bool& include_saturated)
 
   // Iterate over the id_array in parallel, incrementing the counts in count_vec
 #pragma omp parallel for default(none)                                         \
-  shared(id_array_size, include_saturated, id_array, count_vec)
+  shared(id_array_size, include_saturated, count_vec)
   for (size_t k = 0; k < id_array_size; k++) {
-    if (!include_saturated && id_array[k] > ANTI_MASK) {
+    const T id = get_data(k);
+    if (!include_saturated && id > ANTI_MASK) {
       continue;
     }
-    count_vec[id_array[k] & ANTI_MASK].fetch_add(1);
+    count_vec[id & ANTI_MASK].fetch_add(1);
   }
 
   // Convert the atomic count_vec to a non-atomic result vector,
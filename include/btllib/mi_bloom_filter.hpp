@@ -2,6 +2,8 @@
 #define BTLLIB_MI_BLOOM_FILTER_HPP
 
 #include "nthash.hpp"
+#include "packed_int_array.hpp"
+#include "rank_bit_vector.hpp"
 #include "status.hpp"
 
 // clang-format off
@@ -20,6 +22,13 @@
 namespace btllib {
 
 static const char* const MI_BLOOM_FILTER_SIGNATURE = "[BTLMIBloomFilter_v2]";
+// NOLINTNEXTLINE(clang-diagnostic-unneeded-internal-declaration)
+static const char* const MI_BLOOM_FILTER_SINGLE_FILE_SIGNATURE =
+  "[BTLMIBloomFilter_v3]";
+
+/** Alignment of the data sections of single-file multi-indexed Bloom filters.
+ */
+static const size_t MI_BLOOM_FILTER_ALIGNMENT = 4096;
 
 static const unsigned PLACEHOLDER_NEWLINES_MIBF = 50;
 
@@ -55,8 +64,33 @@ private:
    * variants. */
   std::shared_ptr<cpptoml::table> parse_header(const std::string& signature);
 };
+
+/** Read-only memory mapping of a whole file. */
+class MIBloomFilterMapping
+{
+
+public:
+  explicit MIBloomFilterMapping(const std::string& path);
+  ~MIBloomFilterMapping();
+
+  MIBloomFilterMapping(const MIBloomFilterMapping&) = delete;
+  MIBloomFilterMapping(MIBloomFilterMapping&&) = delete;
+
+  MIBloomFilterMapping& operator=(const MIBloomFilterMapping&) = delete;
+  MIBloomFilterMapping& operator=(MIBloomFilterMapping&&) = delete;
+
+  const char* data() const { return (const char*)addr; }
+  size_t size() const { return length; }
+
+private:
+  void* addr = nullptr;
+  size_t length = 0;
+};
 /// @endcond
 
+template<typename T>
+class MIBloomFilterBuilder;
+
 template<typename T>
 class MIBloomFilter
 {
@@ -69,8 +103,44 @@ public:
 
   static const T ID_MASK = ANTI_STRAND & ANTI_MASK;
 
+  /** Block size of the sdsl interleaved bit vector in .sdsl files. */
   static const unsigned BLOCKSIZE = 512;
 
+  /** Number of hash values resolved per prefetching stage in get_ids. */
+  static const unsigned GET_IDS_BATCH = 64;
+
+  /**
+   * Reusable buffers for allocation-free queries and saturation insertions.
+   * Construct one per thread and pass it to the overloads that accept it.
+   */
+  class QueryBuffer
+  {
+  public:
+    /**
+     * Construct buffers for a filter with the given number of hashes.
+     *
+     * @param hash_num Number of hash values per element of the filter.
+     */
+    explicit QueryBuffer(unsigned hash_num)
+      : rank_pos(hash_num)
+      , ids(hash_num)
+    {
+      seen_set.reserve(hash_num + 1);
+      replacement_ids.reserve(hash_num + 1);
+    }
+
+    /** ID array positions of the last queried element. */
+    std::vector<uint64_t> rank_pos;
+    /** IDs of the last queried element. */
+    std::vector<T> ids;
+
+  private:
+    friend class MIBloomFilter;
+
+    std::vector<T> seen_set;
+    std::vector<T> replacement_ids;
+  };
+
   /** Construct a dummy multi-indexed Bloom filter (e.g. as a default argument).
    */
   MIBloomFilter() {}
@@ -140,7 +210,7 @@ public:
    * @param hashes Integer array of hash values. Array size should equal the
    * hash_num argument used when the multi-indexed Bloom filter was constructed.
    */
-  bool bv_contains(const uint64_t* hashes);
+  bool bv_contains(const uint64_t* hashes) const;
 
   /**
    * Check for presence of an element's hash values in the bit vector
@@ -149,7 +219,7 @@ public:
    * @param hashes Integer vector of hash values. Array size should equal the
    * hash_num argument used when the multi-indexed Bloom filter was constructed.
    */
-  bool bv_contains(const std::vector<uint64_t>& hashes)
+  bool bv_contains(const std::vector<uint64_t>& hashes) const
   {
     return bv_contains(hashes.data());
   }
@@ -185,6 +255,33 @@ public:
    */
   std::vector<T> get_id(const uint64_t* hashes);
 
+  /**
+   * Get the ID's for corresponding to the hashes without allocating memory.
+   *
+   * @param hashes Integer array of hash values. Array size should equal the
+   * hash_num argument used when the multi-indexed Bloom filter was constructed.
+   * @param ids Output array of hash_num IDs.
+   */
+  void get_id(const uint64_t* hashes, T* ids) const;
+
+  /**
+   * Get the ID's for corresponding to the hashes, storing them in a reusable
+   * buffer.
+   *
+   * @param hashes Integer array of hash values.
+   * @param buffer Per-thread query buffer. On return, its ids and rank_pos
+   * members hold the result.
+   *
+   * @return Reference to the IDs in the buffer.
+   */
+  const std::vector<T>& get_id(const uint64_t* hashes,
+                               QueryBuffer& buffer) const
+  {
+    get_rank_pos(hashes, buffer.rank_pos.data());
+    get_data(buffer.rank_pos.data(), buffer.ids.data());
+    return buffer.ids;
+  }
+
   /**
    * Get the ID's for corresponding to the hashes.
    *
@@ -195,6 +292,35 @@ public:
     return get_id(hashes.data());
   }
 
+  /**
+   * Get the IDs of many elements at once. The ID array lookups of a batch of
+   * elements are prefetched before they are read, so the memory accesses of
+   * different elements overlap instead of being serialized.
+   *
+   * @param hashes Integer array of n_elements * hash_num hash values, with the
+   * hash values of each element stored contiguously.
+   * @param n_elements Number of elements.
+   * @param ids Output array of n_elements * hash_num IDs, laid out like hashes.
+   */
+  void get_ids(const uint64_t* hashes, size_t n_elements, T* ids) const;
+
+  /**
+   * Get the IDs of many elements at once.
+   *
+   * @param hashes Integer vector of hash values, hash_num per element.
+   *
+   * @return Vector of IDs laid out like hashes.
+   */
+  std::vector<T> get_ids(const std::vector<uint64_t>& hashes) const
+  {
+    check_error(hashes.size() % hash_num != 0,
+                "MIBloomFilter: number of hash values is not a multiple of "
+                "hash_num.");
+    std::vector<T> ids(hashes.size());
+    get_ids(hashes.data(), hashes.size() / hash_num, ids.data());
+    return ids;
+  }
+
   /**
    * Inserts saturation if ID is not represented after trying to survive.
    *
@@ -214,13 +340,77 @@ public:
     insert_saturation(hashes.data(), id);
   }
 
+  /**
+   * Inserts saturation if ID is not represented after trying to survive,
+   * using a reusable buffer instead of allocating memory.
+   *
+   * @param hashes Integer array of hash values.
+   * @param ID is the ID to look for.
+   * @param buffer Per-thread query buffer.
+   */
+  void insert_saturation(const uint64_t* hashes,
+                         const T& id,
+                         QueryBuffer& buffer);
+
+  /**
+   * Get the ID array positions corresponding to the hashes.
+   *
+   * @param hashes Integer array of hash values.
+   * @param rank_pos Output array of hash_num positions.
+   */
+  void get_rank_pos(const uint64_t* hashes, uint64_t* rank_pos) const;
+
+  /**
+   * Get the IDs stored at ID array positions.
+   *
+   * @param rank_pos Array of hash_num positions.
+   * @param data Output array of hash_num IDs.
+   */
+  void get_data(const uint64_t* rank_pos, T* data) const;
+
   /**
    * Save the multi-indexed Bloom filter to a file that can be loaded in the
    * future.
    *
    * @param path Filepath to store filter at.
+   * @param single_file If false, the bit vector is stored in a separate
+   * path + ".sdsl" file. If true, everything is stored in a single file whose
+   * ID array is memory-mapped when loaded, so that processes loading the same
+   * file share its pages. Filters loaded from single files are read-only.
+   */
+  void save(const std::string& path, bool single_file = false);
+
+  /**
+   * Check whether the file at the given path is a single-file multi-indexed
+   * Bloom filter.
+   *
+   * @param path Filepath to check.
+   */
+  static bool is_single_file(const std::string& path);
+
+  /** Check whether the filter was memory-mapped from a single file and is
+   * therefore read-only. */
+  bool is_mapped() const { return bool(mapping); }
+
+  /**
+   * Pack the completed ID array into the minimum number of bits per entry, i.e.
+   * the width of the largest ID plus the saturation and strand flags. IDs are
+   * decoded on the fly by queries. The filter is read-only afterwards.
+   *
+   * @param dictionary If true and it results in a smaller width, store an
+   * index into a table of the distinct entries instead, ordered by decreasing
+   * frequency. This pays off when only a few of a wide ID range are used.
    */
-  void save(const std::string& path);
+  void compact(bool dictionary = false);
+
+  /** Check whether the ID array is packed and therefore read-only. */
+  bool is_compacted() const { return compacted; }
+
+  /** Get the number of bits stored per ID array entry. */
+  unsigned get_id_width() const
+  {
+    return compacted ? packed_ids.get_width() : sizeof(T) * CHAR_BIT;
+  }
 
   /** Get population count, i.e. the number of 1 bits in the filter. */
   uint64_t get_pop_cnt();
@@ -249,20 +439,54 @@ public:
 
 private:
   MIBloomFilter(const std::shared_ptr<MIBloomFilterInitializer>& mibfi);
+  void load_mapped(const std::shared_ptr<MIBloomFilterInitializer>& mibfi);
+  void set_packed_layout(unsigned width);
+  void load_sdsl_bit_vector(const std::string& path);
+  void save_sdsl_bit_vector(const std::string& path) const;
   static void save(const std::string& path,
                    const cpptoml::table& table,
                    const char* data,
                    size_t n);
+  void save_single_file(const std::string& path, cpptoml::table& root);
+  void check_writable() const
+  {
+    check_error(is_mapped(),
+                "MIBloomFilter: filters loaded from single files are "
+                "read-only.");
+    check_error(compacted, "MIBloomFilter: compacted filters are read-only.");
+  }
   std::vector<uint64_t> get_rank_pos(const uint64_t* hashes) const;
   uint64_t get_rank_pos(const uint64_t hash) const
   {
-    return bv_rank_support(hash % il_bit_vector.size());
+    return rank_bit_vector.rank(hash % rank_bit_vector.size());
   }
   std::vector<T> get_data(const std::vector<uint64_t>& rank_pos) const;
-  T get_data(const uint64_t& rank) const { return id_array[rank]; }
+  T get_data(const uint64_t& rank) const
+  {
+    return compacted ? decode_id(packed_ids.get(rank)) : T(id_array[rank]);
+  }
+  void prefetch_data(const uint64_t& rank) const
+  {
+    if (compacted) {
+      packed_ids.prefetch(rank);
+    } else {
+      __builtin_prefetch(&id_array[rank]);
+    }
+  }
+  T decode_id(const uint64_t code) const
+  {
+    if (!id_dictionary.empty()) {
+      return id_dictionary[code];
+    }
+    // The flags are stored in the two bits above the ID
+    const T flags = T(code >> packed_flags_shift);
+    return T(code & packed_id_mask) | T(flags << (sizeof(T) * CHAR_BIT - 2));
+  }
   void set_data(const uint64_t& pos, const T& id);
   void set_saturated(const uint64_t* hashes);
 
+  friend class MIBloomFilterBuilder<T>;
+
   size_t id_array_size = 0;
   size_t bv_size = 0;
   unsigned kmer_size = 0;
@@ -270,10 +494,18 @@ private:
   std::string hash_fn;
 
   sdsl::bit_vector bit_vector;
-  sdsl::bit_vector_il<BLOCKSIZE> il_bit_vector;
-  sdsl::rank_support_il<1> bv_rank_support;
+  // Built from bit_vector by complete_bv_insertion(), which frees the latter
+  RankBitVector rank_bit_vector;
   std::unique_ptr<std::atomic<uint16_t>[]> counts_array;
-  std::unique_ptr<std::atomic<T>[]> id_array;
+  std::unique_ptr<std::atomic<T>[]> id_array_storage;
+  std::unique_ptr<MIBloomFilterMapping> mapping;
+  std::atomic<T>* id_array = nullptr;
+
+  bool compacted = false;
+  PackedIntArray packed_ids;
+  unsigned packed_flags_shift = 0;
+  uint64_t packed_id_mask = 0;
+  std::vector<T> id_dictionary;
 
   bool bv_insertion_completed = false, id_insertion_completed = false;
 };
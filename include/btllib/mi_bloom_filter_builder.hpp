@@ -0,0 +1,469 @@
+#ifndef BTLLIB_MI_BLOOM_FILTER_BUILDER_HPP
+#define BTLLIB_MI_BLOOM_FILTER_BUILDER_HPP
+
+#include "btllib/hashing_internals.hpp"
+#include "btllib/mi_bloom_filter.hpp"
+#include "btllib/nthash.hpp"
+#include "btllib/seq_reader.hpp"
+#include "btllib/status.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace btllib {
+
+/**
+ * Builds a multi-indexed Bloom filter from a list of sequence files. The files
+ * are read and hashed only once. The k-mer hash values are cached in memory,
+ * or spilled to disk once the cache exceeds a memory budget, and replayed for
+ * the bit vector, ID and saturation stages. Only the base hash value of each
+ * k-mer is cached and the other hash values are recomputed from it on replay,
+ * so a k-mer takes 8 + sizeof(T) bytes of cache. Spaced seed hash values are
+ * independent of each other and are all cached. IDs are derived from the
+ * record and file indices, so no lock or shared map is needed to assign them.
+ */
+template<typename T>
+class MIBloomFilterBuilder
+{
+
+public:
+  /* Has to be a struct and not an enum because:
+   * 1) Non-class enums are not name qualified and can collide
+   * 2) class enums can't be implicitly converted into integers
+   */
+  struct Flag
+  {
+    /** Assign one ID per file rather than one ID per sequence. */
+    static const unsigned BY_FILE = 1;
+    /** Optimizes reading performance for long sequences (approx. >5kbp) */
+    static const unsigned LONG_MODE = 2;
+  };
+
+  bool by_file() const { return bool(flags & Flag::BY_FILE); }
+  bool long_mode() const { return bool(flags & Flag::LONG_MODE); }
+
+  /** Number of k-mers hashed per cache chunk. */
+  static const size_t CHUNK_KMERS = 65536;
+  /** Default memory budget for the hash cache (1 GiB). */
+  static const size_t DEFAULT_MAX_CACHE_BYTES = size_t(1) << 30;
+  /** Default occupancy used to size the filter if no size is given. */
+  static constexpr double DEFAULT_OCCUPANCY = 0.5;
+
+  /**
+   * Construct a builder that hashes k-mers with NtHash.
+   *
+   * @param paths Sequence files to build the filter from.
+   * @param hash_num Number of hash values per k-mer.
+   * @param k K-mer size.
+   * @param flags Modifier flags.
+   * @param max_cache_bytes Memory budget for the hash cache. Once the cache
+   * grows above it, further hashes are spilled to disk. 0 spills everything.
+   * @param spill_dir Directory to spill the hash cache to. Defaults to TMPDIR
+   * or /tmp.
+   * @param reader_threads Number of threads used by each SeqReader.
+   */
+  MIBloomFilterBuilder(std::vector<std::string> paths,
+                       unsigned hash_num,
+                       unsigned k,
+                       unsigned flags = 0,
+                       size_t max_cache_bytes = DEFAULT_MAX_CACHE_BYTES,
+                       std::string spill_dir = "",
+                       unsigned reader_threads = 6);
+
+  /**
+   * Construct a builder that hashes spaced seed k-mers with SeedNtHash. One
+   * hash value is generated per seed.
+   *
+   * @param paths Sequence files to build the filter from.
+   * @param seeds Spaced seed patterns as strings of 1s (cares) and 0s (don't
+   * cares). All seeds must be of the same length, which is used as k.
+   * @param flags Modifier flags.
+   * @param max_cache_bytes Memory budget for the hash cache. Once the cache
+   * grows above it, further hashes are spilled to disk. 0 spills everything.
+   * @param spill_dir Directory to spill the hash cache to. Defaults to TMPDIR
+   * or /tmp.
+   * @param reader_threads Number of threads used by each SeqReader.
+   */
+  MIBloomFilterBuilder(std::vector<std::string> paths,
+                       const std::vector<std::string>& seeds,
+                       unsigned flags = 0,
+                       size_t max_cache_bytes = DEFAULT_MAX_CACHE_BYTES,
+                       std::string spill_dir = "",
+                       unsigned reader_threads = 6);
+
+  MIBloomFilterBuilder(const MIBloomFilterBuilder&) = delete;
+  MIBloomFilterBuilder(MIBloomFilterBuilder&&) = delete;
+
+  MIBloomFilterBuilder& operator=(const MIBloomFilterBuilder&) = delete;
+  MIBloomFilterBuilder& operator=(MIBloomFilterBuilder&&) = delete;
+
+  ~MIBloomFilterBuilder() { clear_cache(); }
+
+  /**
+   * Read and hash the sources, then run all build stages over the cached
+   * hashes.
+   *
+   * @param bv_size Bit vector size in bits. If 0, the size is calculated from
+   * the number of k-mers read and the occupancy.
+   * @param occupancy Target bit vector occupancy, used if bv_size is 0.
+   *
+   * @return The completed multi-indexed Bloom filter.
+   */
+  std::unique_ptr<MIBloomFilter<T>> build(
+    size_t bv_size = 0,
+    double occupancy = DEFAULT_OCCUPANCY);
+
+  /**
+   * Get the names assigned to IDs by the last build. The element at index i is
+   * the sequence ID (or file path in by-file mode) of ID i.
+   */
+  const std::vector<std::string>& get_id_names() const { return id_names; }
+
+  /** Get the number of k-mers hashed by the last build. */
+  uint64_t get_kmer_count() const { return kmer_count; }
+
+  /** Get the number of k-mers that were spilled to disk by the last build. */
+  uint64_t get_spilled_kmer_count() const { return spilled_kmer_count; }
+
+private:
+  using QueryBuffer = typename MIBloomFilter<T>::QueryBuffer;
+
+  struct Chunk
+  {
+    std::vector<T> ids;
+    std::vector<uint64_t> hashes;
+
+    size_t size() const { return ids.size(); }
+    size_t bytes() const
+    {
+      return ids.size() * sizeof(T) + hashes.size() * sizeof(uint64_t);
+    }
+  };
+
+  void hash_sources();
+  template<typename H>
+  void hash_record(H& hasher, T id, Chunk& chunk);
+  void flush_chunk(Chunk& chunk);
+  template<typename F>
+  void replay(F f);
+  void clear_cache();
+  T make_id(size_t id) const;
+  // Number of hash values cached per k-mer
+  unsigned cached_hash_num() const { return seeds.empty() ? 1 : hash_num; }
+
+  const std::vector<std::string> paths;
+  const unsigned hash_num;
+  const unsigned k;
+  const std::vector<std::vector<unsigned>> seeds;
+  const unsigned flags;
+  const size_t max_cache_bytes;
+  const std::string spill_path;
+  const unsigned reader_threads;
+
+  std::mutex cache_mutex;
+  std::vector<Chunk> cache;
+  size_t cache_bytes = 0;
+  std::ofstream spill_ofs;
+  uint64_t kmer_count = 0;
+  uint64_t spilled_kmer_count = 0;
+  std::vector<std::string> id_names;
+};
+
+/// @cond HIDDEN_SYMBOLS
+inline std::string
+get_mi_bloom_filter_spill_path(const std::string& spill_dir,
+                               const void* const builder)
+{
+  std::string dir = spill_dir;
+  if (dir.empty()) {
+    const auto* const tmpdir =
+      std::getenv("TMPDIR"); // NOLINT(concurrency-mt-unsafe)
+    dir = tmpdir != nullptr ? tmpdir : "/tmp";
+  }
+  if (!dir.empty() && dir.back() != '/') {
+    dir += '/';
+  }
+  return dir + "btllib-mibf-" + std::to_string(getpid()) + "-" +
+         std::to_string(uintptr_t(builder)) + ".cache";
+}
+/// @endcond
+
+template<typename T>
+inline MIBloomFilterBuilder<T>::MIBloomFilterBuilder(
+  std::vector<std::string> paths,
+  const unsigned hash_num,
+  const unsigned k,
+  const unsigned flags,
+  const size_t max_cache_bytes,
+  std::string spill_dir,
+  const unsigned reader_threads)
+  : paths(std::move(paths))
+  , hash_num(hash_num)
+  , k(k)
+  , flags(flags)
+  , max_cache_bytes(max_cache_bytes)
+  , spill_path(get_mi_bloom_filter_spill_path(spill_dir, this))
+  , reader_threads(reader_threads)
+{
+  check_error(this->paths.empty(), "MIBloomFilterBuilder: no input files.");
+  check_error(hash_num == 0,
+              "MIBloomFilterBuilder: number of hash values must be >0.");
+  check_error(k == 0, "MIBloomFilterBuilder: k must be >0.");
+}
+
+template<typename T>
+inline MIBloomFilterBuilder<T>::MIBloomFilterBuilder(
+  std::vector<std::string> paths,
+  const std::vector<std::string>& seeds,
+  const unsigned flags,
+  const size_t max_cache_bytes,
+  std::string spill_dir,
+  const unsigned reader_threads)
+  : paths(std::move(paths))
+  , hash_num(seeds.size())
+  , k(seeds.empty() ? 0 : seeds[0].size())
+  , seeds(parse_seeds(seeds))
+  , flags(flags)
+  , max_cache_bytes(max_cache_bytes)
+  , spill_path(get_mi_bloom_filter_spill_path(spill_dir, this))
+  , reader_threads(reader_threads)
+{
+  check_error(this->paths.empty(), "MIBloomFilterBuilder: no input files.");
+  check_error(seeds.empty(), "MIBloomFilterBuilder: no spaced seeds given.");
+}
+
+template<typename T>
+inline T
+MIBloomFilterBuilder<T>::make_id(const size_t id) const
+{
+  check_error(id > size_t(MIBloomFilter<T>::ID_MASK),
+              "MIBloomFilterBuilder: total ID number overflows ID type.");
+  return T(id);
+}
+
+template<typename T>
+template<typename H>
+inline void
+MIBloomFilterBuilder<T>::hash_record(H& hasher, const T id, Chunk& chunk)
+{
+  while (hasher.roll()) {
+    chunk.ids.push_back(id);
+    chunk.hashes.insert(chunk.hashes.end(),
+                        hasher.hashes(),
+                        hasher.hashes() + cached_hash_num());
+    if (chunk.size() >= CHUNK_KMERS) {
+      flush_chunk(chunk);
+    }
+  }
+}
+
+template<typename T>
+inline void
+MIBloomFilterBuilder<T>::flush_chunk(Chunk& chunk)
+{
+  if (chunk.size() == 0) {
+    return;
+  }
+  const std::unique_lock<std::mutex> lock(cache_mutex);
+  kmer_count += chunk.size();
+  if (cache_bytes + chunk.bytes() <= max_cache_bytes) {
+    cache_bytes += chunk.bytes();
+    cache.push_back(std::move(chunk));
+    chunk = Chunk();
+  } else {
+    if (!spill_ofs.is_open()) {
+      spill_ofs.open(spill_path, std::ios::out | std::ios::binary);
+      check_error(!spill_ofs,
+                  "MIBloomFilterBuilder: failed to open " + spill_path);
+    }
+    const uint64_t size = chunk.size();
+    spill_ofs.write((const char*)&size, sizeof(size));
+    spill_ofs.write((const char*)chunk.ids.data(),
+                    std::streamsize(chunk.ids.size() * sizeof(T)));
+    spill_ofs.write((const char*)chunk.hashes.data(),
+                    std::streamsize(chunk.hashes.size() * sizeof(uint64_t)));
+    check_error(!spill_ofs,
+                "MIBloomFilterBuilder: failed to write to " + spill_path);
+    spilled_kmer_count += size;
+    chunk.ids.clear();
+    chunk.hashes.clear();
+  }
+}
+
+template<typename T>
+inline void
+MIBloomFilterBuilder<T>::hash_sources()
+{
+  clear_cache();
+  kmer_count = 0;
+  spilled_kmer_count = 0;
+  id_names.clear();
+  const unsigned reader_flags =
+    long_mode() ? SeqReader::Flag::LONG_MODE : SeqReader::Flag::SHORT_MODE;
+  size_t id_offset = 0;
+  for (size_t file_idx = 0; file_idx < paths.size(); ++file_idx) {
+    const auto& path = paths[file_idx];
+    SeqReader reader(path, reader_flags, reader_threads);
+    size_t record_count = 0;
+    std::vector<std::pair<size_t, std::string>> names;
+// NOLINTNEXTLINE(openmp-use-default-none,-warnings-as-errors)
+#pragma omp parallel reduction(max : record_count)
+    {
+      Chunk chunk;
+      std::vector<std::pair<size_t, std::string>> local_names;
+      try {
+        for (const auto record : reader) {
+          record_count = std::max(record_count, record.num + 1);
+          const T id = make_id(by_file() ? file_idx : id_offset + record.num);
+          if (!by_file()) {
+            local_names.emplace_back(record.num, record.id);
+          }
+          if (record.seq.size() < k) {
+            continue;
+          }
+          if (seeds.empty()) {
+            NtHash nthash(record.seq, hash_num, k);
+            hash_record(nthash, id, chunk);
+          } else {
+            SeedNtHash nthash(record.seq, seeds, 1, k);
+            hash_record(nthash, id, chunk);
+          }
+        }
+        flush_chunk(chunk);
+      } catch (const std::exception& e) {
+        log_error(e.what());
+        std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+      }
+#pragma omp critical
+      names.insert(names.end(),
+                   std::make_move_iterator(local_names.begin()),
+                   std::make_move_iterator(local_names.end()));
+    }
+    if (by_file()) {
+      id_names.push_back(path);
+    } else {
+      id_names.resize(id_offset + record_count);
+      for (auto& name : names) {
+        id_names[id_offset + name.first] = std::move(name.second);
+      }
+      id_offset += record_count;
+    }
+  }
+  if (spill_ofs.is_open()) {
+    spill_ofs.close();
+  }
+}
+
+template<typename T>
+template<typename F>
+inline void
+MIBloomFilterBuilder<T>::replay(F f)
+{
+  const auto process = [&](const Chunk& chunk) {
+    const T* const ids = chunk.ids.data();
+    const uint64_t* const hashes = chunk.hashes.data();
+    const size_t size = chunk.size();
+    const size_t stride = cached_hash_num();
+// NOLINTNEXTLINE(openmp-use-default-none,-warnings-as-errors)
+#pragma omp parallel
+    {
+      QueryBuffer buffer(hash_num);
+      std::vector<uint64_t> extended(hash_num);
+#pragma omp for
+      for (size_t i = 0; i < size; ++i) {
+        if (seeds.empty()) {
+          hashing_internals::extend_hashes(
+            hashes[i], k, hash_num, extended.data());
+          f(extended.data(), ids[i], buffer);
+        } else {
+          f(hashes + i * stride, ids[i], buffer);
+        }
+      }
+    }
+  };
+  for (const auto& chunk : cache) {
+    process(chunk);
+  }
+  if (spilled_kmer_count > 0) {
+    std::ifstream ifs(spill_path, std::ios::in | std::ios::binary);
+    check_error(!ifs, "MIBloomFilterBuilder: failed to open " + spill_path);
+    Chunk chunk;
+    uint64_t size = 0;
+    while (ifs.read((char*)&size, sizeof(size))) {
+      chunk.ids.resize(size);
+      chunk.hashes.resize(size * cached_hash_num());
+      ifs.read((char*)chunk.ids.data(), std::streamsize(size * sizeof(T)));
+      ifs.read((char*)chunk.hashes.data(),
+               std::streamsize(chunk.hashes.size() * sizeof(uint64_t)));
+      check_error(!ifs,
+                  "MIBloomFilterBuilder: " + spill_path + " is truncated.");
+      process(chunk);
+    }
+  }
+}
+
+template<typename T>
+inline void
+MIBloomFilterBuilder<T>::clear_cache()
+{
+  cache.clear();
+  cache_bytes = 0;
+  if (spilled_kmer_count > 0) {
+    std::remove(spill_path.c_str());
+  }
+}
+
+template<typename T>
+inline std::unique_ptr<MIBloomFilter<T>>
+MIBloomFilterBuilder<T>::build(size_t bv_size, const double occupancy)
+{
+  log_info("MIBloomFilterBuilder: Hashing input files");
+  hash_sources();
+  log_info("MIBloomFilterBuilder: Hashed " + std::to_string(kmer_count) +
+           " k-mers (" + std::to_string(spilled_kmer_count) +
+           " spilled to disk)");
+
+  if (bv_size == 0) {
+    bv_size =
+      MIBloomFilter<T>::calc_optimal_size(kmer_count, hash_num, occupancy);
+  }
+  std::unique_ptr<MIBloomFilter<T>> mi_bf( // NOLINT(modernize-make-unique)
+    new MIBloomFilter<T>(
+      bv_size, hash_num, seeds.empty() ? NTHASH_FN_NAME : SEED_NTHASH_FN_NAME));
+  mi_bf->kmer_size = k;
+
+  log_info("MIBloomFilterBuilder: BV Insertion stage started");
+  replay([&](const uint64_t* hashes, T, QueryBuffer&) {
+    mi_bf->insert_bv(hashes);
+  });
+  mi_bf->complete_bv_insertion();
+
+  log_info("MIBloomFilterBuilder: ID Insertion stage started");
+  replay([&](const uint64_t* hashes, T id, QueryBuffer&) {
+    mi_bf->insert_id(hashes, id);
+  });
+  mi_bf->complete_id_insertion();
+
+  log_info("MIBloomFilterBuilder: Saturation stage started");
+  replay([&](const uint64_t* hashes, T id, QueryBuffer& buffer) {
+    mi_bf->insert_saturation(hashes, id, buffer);
+  });
+
+  clear_cache();
+  return mi_bf;
+}
+
+} // namespace btllib
+
+#endif
@@ -0,0 +1,574 @@
+#ifndef BTLLIB_MI_BLOOM_FILTER_CLASSIFIER_HPP
+#define BTLLIB_MI_BLOOM_FILTER_CLASSIFIER_HPP
+
+#include "btllib/mi_bloom_filter.hpp"
+#include "btllib/nthash.hpp"
+#include "btllib/order_queue.hpp"
+#include "btllib/seq_reader.hpp"
+#include "btllib/status.hpp"
+#include "btllib/util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace btllib {
+
+/**
+ * Classifies sequences against a multi-indexed Bloom filter. Every k-mer of a
+ * read that is present in the bit vector votes once for each distinct ID
+ * stored in its ID array entries, and the IDs with the most votes are
+ * reported. Reads are processed by a pool of worker threads and returned in
+ * input order.
+ */
+template<typename T>
+class MIBloomFilterClassifier
+{
+
+public:
+  /* Has to be a struct and not an enum because:
+   * 1) Non-class enums are not name qualified and can collide
+   * 2) class enums can't be implicitly converted into integers
+   */
+  struct Flag
+  {
+    /** Optimizes performance for short sequences (approx. <=5kbp) */
+    static const unsigned SHORT_MODE = 1;
+    /** Optimizes performance for long sequences (approx. >5kbp) */
+    static const unsigned LONG_MODE = 2;
+    /** Do not count votes from saturated ID array entries. */
+    static const unsigned NO_SATURATED = 4;
+  };
+
+  bool short_mode() const { return bool(flags & Flag::SHORT_MODE); }
+  bool long_mode() const { return bool(flags & Flag::LONG_MODE); }
+  bool no_saturated() const { return bool(flags & Flag::NO_SATURATED); }
+
+  /** Number of k-mers whose IDs are looked up together in one batch. */
+  static const size_t QUERY_BATCH_KMERS = 256;
+
+  static const size_t MAX_SIMULTANEOUS_CLASSIFIERS = 256;
+
+  struct Record
+  {
+    Record() {}
+
+    size_t num = 0;
+    std::string id;
+    size_t readlen = 0;
+    /** Number of k-mers in the read. */
+    size_t kmers = 0;
+    /** Number of k-mers found in the filter's bit vector. */
+    size_t matched_kmers = 0;
+    /** Number of matched k-mers whose ID array entries are all saturated. */
+    size_t saturated_kmers = 0;
+    /** IDs with the most votes, in increasing order. Empty if the read is
+     * unclassified. */
+    std::vector<T> ids;
+    /** Votes of the best IDs. */
+    size_t hits = 0;
+    /** Votes of the runner-up ID. */
+    size_t second_hits = 0;
+    /** (hits - second_hits) / hits, i.e. 1 for an unambiguous call and 0 for
+     * a tie. */
+    double confidence = 0;
+
+    operator bool() const { return valid; }
+
+  private:
+    friend class MIBloomFilterClassifier;
+
+    bool valid = false;
+  };
+
+  /**
+   * Read the next classified record.
+   */
+  Record read();
+
+  /**
+   * Construct a classifier that hashes k-mers with NtHash, using the k-mer
+   * size and hash number of the filter.
+   *
+   * @param seqfile Filepath to read sequences from. Pass "-" to read from
+   * stdin.
+   * @param mi_bf Multi-indexed Bloom filter to classify against. It must
+   * outlive the classifier.
+   * @param flags Modifier flags. Specifiying either short or long mode flag is
+   * mandatory; other flags are optional.
+   * @param min_hits Minimum number of votes for the best ID for a read to be
+   * classified.
+   * @param min_confidence Minimum confidence for a read to be classified.
+   * @param threads Maximum number of processing threads to use. Must be at
+   * least 1.
+   */
+  MIBloomFilterClassifier(std::string seqfile,
+                          const MIBloomFilter<T>& mi_bf,
+                          unsigned flags,
+                          size_t min_hits = 1,
+                          double min_confidence = 0,
+                          unsigned threads = 5);
+
+  /**
+   * Construct a classifier that hashes spaced seed k-mers with SeedNtHash.
+   *
+   * @param seqfile Filepath to read sequences from. Pass "-" to read from
+   * stdin.
+   * @param mi_bf Multi-indexed Bloom filter to classify against. It must
+   * outlive the classifier.
+   * @param seeds Spaced seed patterns the filter was built with, as strings of
+   * 1s (cares) and 0s (don't cares).
+   * @param flags Modifier flags. Specifiying either short or long mode flag is
+   * mandatory; other flags are optional.
+   * @param min_hits Minimum number of votes for the best ID for a read to be
+   * classified.
+   * @param min_confidence Minimum confidence for a read to be classified.
+   * @param threads Maximum number of processing threads to use. Must be at
+   * least 1.
+   */
+  MIBloomFilterClassifier(std::string seqfile,
+                          const MIBloomFilter<T>& mi_bf,
+                          const std::vector<std::string>& seeds,
+                          unsigned flags,
+                          size_t min_hits = 1,
+                          double min_confidence = 0,
+                          unsigned threads = 5);
+
+  ~MIBloomFilterClassifier();
+
+  void close() noexcept;
+
+  /** For range-based for loop only. */
+  /// @cond HIDDEN_SYMBOLS
+  class RecordIterator
+  {
+  public:
+    void operator++() { record = classifier.read(); }
+    bool operator!=(const RecordIterator& i)
+    {
+      return bool(record) || bool(i.record);
+    }
+    Record operator*() { return std::move(record); }
+    // For wrappers
+    Record next()
+    {
+      auto val = operator*();
+      operator++();
+      return val;
+    }
+
+  private:
+    friend MIBloomFilterClassifier;
+
+    RecordIterator(MIBloomFilterClassifier& classifier, bool end)
+      : classifier(classifier)
+    {
+      if (!end) {
+        operator++();
+      }
+    }
+
+    MIBloomFilterClassifier& classifier;
+    Record record;
+  };
+  /// @endcond
+
+  RecordIterator begin() { return RecordIterator(*this, false); }
+  RecordIterator end() { return RecordIterator(*this, true); }
+
+private:
+  /// @cond HIDDEN_SYMBOLS
+  /** Per-thread lookup buffers and vote table. */
+  struct VoteTable
+  {
+    explicit VoteTable(unsigned hash_num)
+      : hashes(QUERY_BATCH_KMERS * hash_num)
+      , ids(QUERY_BATCH_KMERS * hash_num)
+    {
+    }
+
+    std::vector<uint64_t> hashes;
+    std::vector<T> ids;
+    size_t batch_kmers = 0;
+    // Indexed by ID. last_kmer stores the 1-based index of the last k-mer that
+    // voted for the ID, so each k-mer votes once per ID.
+    std::vector<size_t> votes;
+    std::vector<size_t> last_kmer;
+    std::vector<T> touched;
+    size_t kmer_idx = 0;
+  };
+  /// @endcond
+
+  template<typename H>
+  void query_kmers(H& hasher, VoteTable& table, Record& record) const;
+  void count_votes(VoteTable& table, Record& record) const;
+  void score(VoteTable& table, Record& record) const;
+  void classify(const std::string& seq, VoteTable& table, Record& record) const;
+
+  const std::string seqfile;
+  const std::reference_wrapper<const MIBloomFilter<T>> mi_bf;
+  const std::vector<std::vector<unsigned>> seeds;
+  const unsigned hash_num;
+  const unsigned k;
+  const unsigned flags;
+  const size_t min_hits;
+  const double min_confidence;
+  const long id;
+  std::atomic<bool> closed{ false };
+
+  SeqReader reader;
+  OrderQueueMPSC<Record> output_queue;
+
+  using OutputQueueType = decltype(output_queue);
+  static std::unique_ptr<typename OutputQueueType::Block>* ready_blocks_array()
+  {
+    thread_local static std::unique_ptr<typename OutputQueueType::Block>
+      var[MAX_SIMULTANEOUS_CLASSIFIERS];
+    return var;
+  }
+
+  static long* ready_blocks_owners()
+  {
+    thread_local static long var[MAX_SIMULTANEOUS_CLASSIFIERS] = { 0 };
+    return var;
+  }
+
+  static size_t* ready_blocks_current()
+  {
+    thread_local static size_t var[MAX_SIMULTANEOUS_CLASSIFIERS] = { 0 };
+    return var;
+  }
+
+  static std::atomic<long>& last_id()
+  {
+    static std::atomic<long> var(0);
+    return var;
+  }
+
+  class Worker
+  {
+  public:
+    void start() { t = std::thread(do_work, this); }
+    void join() { t.join(); }
+    void set_id(const int id) { this->id = id; }
+
+    Worker& operator=(const Worker& worker) = delete;
+    Worker& operator=(Worker&& worker) = delete;
+
+    Worker(MIBloomFilterClassifier& classifier)
+      : classifier(classifier)
+    {
+    }
+    Worker(const Worker& worker)
+      : Worker(worker.classifier)
+    {
+    }
+    Worker(Worker&& worker) noexcept
+      : Worker(worker.classifier)
+    {
+    }
+
+  private:
+    void work();
+    static void do_work(Worker* worker) { worker->work(); }
+
+    int id = -1;
+    MIBloomFilterClassifier& classifier;
+    std::thread t;
+  };
+
+  std::vector<Worker> workers;
+  Barrier end_barrier;
+  std::mutex last_block_num_mutex;
+  uint64_t last_block_num = 0;
+  bool last_block_num_valid = false;
+};
+
+template<typename T>
+inline MIBloomFilterClassifier<T>::MIBloomFilterClassifier(
+  std::string seqfile,
+  const MIBloomFilter<T>& mi_bf,
+  const std::vector<std::string>& seeds,
+  const unsigned flags,
+  const size_t min_hits,
+  const double min_confidence,
+  const unsigned threads)
+  : seqfile(std::move(seqfile))
+  , mi_bf(mi_bf)
+  , seeds(parse_seeds(seeds))
+  , hash_num(seeds.empty() ? mi_bf.get_hash_num() : seeds.size())
+  , k(seeds.empty() ? mi_bf.get_k() : seeds[0].size())
+  , flags(flags)
+  , min_hits(min_hits)
+  , min_confidence(min_confidence)
+  , id(++last_id())
+  , reader(this->seqfile,
+           short_mode() ? SeqReader::Flag::SHORT_MODE
+                        : SeqReader::Flag::LONG_MODE)
+  , output_queue(reader.get_buffer_size(), reader.get_block_size())
+  , workers(std::vector<Worker>(threads, Worker(*this)))
+  , end_barrier(threads)
+{
+  check_error(!short_mode() && !long_mode(),
+              "MIBloomFilterClassifier: no mode selected, either short or long "
+              "mode flag must be provided.");
+  check_error(short_mode() && long_mode(),
+              "MIBloomFilterClassifier: short and long mode are mutually "
+              "exclusive.");
+  check_error(threads == 0,
+              "MIBloomFilterClassifier: Number of processing threads cannot "
+              "be 0.");
+  check_error(hash_num != mi_bf.get_hash_num(),
+              "MIBloomFilterClassifier: number of seeds does not match the "
+              "filter's hash number.");
+  check_error(k == 0, "MIBloomFilterClassifier: k-mer size is unknown.");
+  int id_counter = 0;
+  for (auto& worker : workers) {
+    worker.set_id(id_counter++);
+    worker.start();
+  }
+}
+
+template<typename T>
+inline MIBloomFilterClassifier<T>::MIBloomFilterClassifier(
+  std::string seqfile,
+  const MIBloomFilter<T>& mi_bf,
+  const unsigned flags,
+  const size_t min_hits,
+  const double min_confidence,
+  const unsigned threads)
+  : MIBloomFilterClassifier(std::move(seqfile),
+                            mi_bf,
+                            {},
+                            flags,
+                            min_hits,
+                            min_confidence,
+                            threads)
+{
+}
+
+template<typename T>
+inline MIBloomFilterClassifier<T>::~MIBloomFilterClassifier()
+{
+  close();
+}
+
+template<typename T>
+inline void
+MIBloomFilterClassifier<T>::close() noexcept
+{
+  bool closed_expected = false;
+  if (closed.compare_exchange_strong(closed_expected, true)) {
+    try {
+      reader.close();
+      output_queue.close();
+      for (auto& worker : workers) {
+        worker.join();
+      }
+    } catch (const std::system_error& e) {
+      log_error("MIBloomFilterClassifier thread join failure: " +
+                std::string(e.what()));
+      std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+    }
+  }
+}
+
+template<typename T>
+inline void
+MIBloomFilterClassifier<T>::count_votes(VoteTable& table, Record& record) const
+{
+  if (table.batch_kmers == 0) {
+    return;
+  }
+  mi_bf.get().get_ids(
+    table.hashes.data(), table.batch_kmers, table.ids.data());
+  for (size_t i = 0; i < table.batch_kmers; ++i) {
+    ++table.kmer_idx;
+    const T* const kmer_ids = table.ids.data() + i * hash_num;
+    bool saturated = true;
+    for (unsigned j = 0; j < hash_num; ++j) {
+      if ((kmer_ids[j] & MIBloomFilter<T>::MASK) == 0) {
+        saturated = false;
+      } else if (no_saturated()) {
+        continue;
+      }
+      const T vote_id = kmer_ids[j] & MIBloomFilter<T>::ID_MASK;
+      if (vote_id >= table.votes.size()) {
+        table.votes.resize(size_t(vote_id) + 1, 0);
+        table.last_kmer.resize(size_t(vote_id) + 1, 0);
+      }
+      if (table.last_kmer[vote_id] != table.kmer_idx) {
+        table.last_kmer[vote_id] = table.kmer_idx;
+        if (table.votes[vote_id]++ == 0) {
+          table.touched.push_back(vote_id);
+        }
+      }
+    }
+    if (saturated) {
+      ++record.saturated_kmers;
+    }
+  }
+  table.batch_kmers = 0;
+}
+
+template<typename T>
+template<typename H>
+inline void
+MIBloomFilterClassifier<T>::query_kmers(H& hasher,
+                                        VoteTable& table,
+                                        Record& record) const
+{
+  while (hasher.roll()) {
+    ++record.kmers;
+    if (!mi_bf.get().bv_contains(hasher.hashes())) {
+      continue;
+    }
+    ++record.matched_kmers;
+    std::copy(hasher.hashes(),
+              hasher.hashes() + hash_num,
+              table.hashes.data() + table.batch_kmers * hash_num);
+    if (++table.batch_kmers == QUERY_BATCH_KMERS) {
+      count_votes(table, record);
+    }
+  }
+  count_votes(table, record);
+}
+
+template<typename T>
+inline void
+MIBloomFilterClassifier<T>::score(VoteTable& table, Record& record) const
+{
+  for (const auto vote_id : table.touched) {
+    const size_t votes = table.votes[vote_id];
+    if (votes > record.hits) {
+      record.second_hits = record.hits;
+      record.hits = votes;
+      record.ids.clear();
+      record.ids.push_back(vote_id);
+    } else if (votes == record.hits) {
+      record.ids.push_back(vote_id);
+    } else if (votes > record.second_hits) {
+      record.second_hits = votes;
+    }
+    table.votes[vote_id] = 0;
+  }
+  table.touched.clear();
+  if (record.ids.size() > 1) {
+    record.second_hits = record.hits;
+  }
+  std::sort(record.ids.begin(), record.ids.end());
+  if (record.hits > 0) {
+    record.confidence =
+      double(record.hits - record.second_hits) / double(record.hits);
+  }
+  if (record.hits == 0 || record.hits < min_hits ||
+      record.confidence < min_confidence) {
+    record.ids.clear();
+  }
+}
+
+template<typename T>
+inline void
+MIBloomFilterClassifier<T>::classify(const std::string& seq,
+                                     VoteTable& table,
+                                     Record& record) const
+{
+  if (seq.size() >= k) {
+    if (seeds.empty()) {
+      NtHash nthash(seq, hash_num, k);
+      query_kmers(nthash, table, record);
+    } else {
+      SeedNtHash nthash(seq, seeds, 1, k);
+      query_kmers(nthash, table, record);
+    }
+  }
+  score(table, record);
+}
+
+template<typename T>
+inline typename MIBloomFilterClassifier<T>::Record
+MIBloomFilterClassifier<T>::read()
+{
+  if (ready_blocks_owners()[id % MAX_SIMULTANEOUS_CLASSIFIERS] != id) {
+    ready_blocks_array()[id % MAX_SIMULTANEOUS_CLASSIFIERS] =
+      std::unique_ptr< // NOLINT(modernize-make-unique)
+        typename OutputQueueType::Block>(
+        new typename OutputQueueType::Block(reader.get_block_size()));
+    ready_blocks_owners()[id % MAX_SIMULTANEOUS_CLASSIFIERS] = id;
+    ready_blocks_current()[id % MAX_SIMULTANEOUS_CLASSIFIERS] = 0;
+  }
+  auto& block = *(ready_blocks_array()[id % MAX_SIMULTANEOUS_CLASSIFIERS]);
+  auto& current = ready_blocks_current()[id % MAX_SIMULTANEOUS_CLASSIFIERS];
+  if (current >= block.count) {
+    block.count = 0;
+    output_queue.read(block);
+    if (block.count == 0) {
+      output_queue.close();
+      block = typename OutputQueueType::Block(reader.get_block_size());
+      return Record();
+    }
+    current = 0;
+  }
+  return std::move(block.data[current++]);
+}
+
+template<typename T>
+inline void
+MIBloomFilterClassifier<T>::Worker::work()
+{
+  typename OutputQueueType::Block output_block(
+    classifier.reader.get_block_size());
+  VoteTable table(classifier.hash_num);
+  uint64_t last_block_num = 0;
+  bool last_block_num_valid = false;
+  for (;;) {
+    auto input_block = classifier.reader.read_block();
+    if (input_block.count == 0) {
+      break;
+    }
+
+    output_block.num = input_block.num;
+    for (size_t idx = 0; idx < input_block.count; idx++) {
+      Record record;
+      auto& reader_record = input_block.data[idx];
+      record.num = reader_record.num;
+      record.id = std::move(reader_record.id);
+      record.readlen = reader_record.seq.size();
+      record.valid = true;
+      classifier.classify(reader_record.seq, table, record);
+      output_block.data[output_block.count++] = std::move(record);
+    }
+    if (output_block.count > 0) {
+      last_block_num = output_block.num;
+      last_block_num_valid = true;
+      classifier.output_queue.write(output_block);
+      output_block.count = 0;
+    }
+  }
+  if (last_block_num_valid) {
+    std::unique_lock<std::mutex> lock(classifier.last_block_num_mutex);
+    classifier.last_block_num =
+      std::max(classifier.last_block_num, last_block_num);
+    classifier.last_block_num_valid = true;
+    lock.unlock();
+  }
+  classifier.end_barrier.wait();
+  if (last_block_num_valid && classifier.last_block_num_valid &&
+      last_block_num == classifier.last_block_num) {
+    output_block.num = last_block_num + 1;
+    classifier.output_queue.write(output_block);
+  } else if (!classifier.last_block_num_valid && id == 0) {
+    output_block.num = 0;
+    classifier.output_queue.write(output_block);
+  }
+}
+
+} // namespace btllib
+
+#endif
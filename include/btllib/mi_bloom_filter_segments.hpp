@@ -0,0 +1,551 @@
+#ifndef BTLLIB_MI_BLOOM_FILTER_SEGMENTS_HPP
+#define BTLLIB_MI_BLOOM_FILTER_SEGMENTS_HPP
+
+#include "btllib/mi_bloom_filter.hpp"
+#include "btllib/nthash.hpp"
+#include "btllib/status.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace btllib {
+
+/**
+ * A multi-indexed Bloom filter that accepts new IDs after it has been built.
+ * The structure consists of an immutable base filter and a list of delta
+ * filters. New k-mers are first staged, then commit() builds a delta filter
+ * from the staged k-mers in a background thread. Like a binary counter, the
+ * newest delta is merged with the one before it as long as it holds at least
+ * as many k-mers, so there are O(log n) deltas and every k-mer is rebuilt
+ * O(log n) times. Queries combine the IDs of all filters into one result and
+ * are not blocked by a running commit; they see the previous deltas until the
+ * new ones are complete.
+ *
+ * The hash values and IDs of the committed k-mers are kept in memory, taking
+ * 8 * hash_num + sizeof(T) bytes per k-mer, so that deltas can be merged and
+ * saved. Their number is capped by max_delta_kmers. Deltas are never folded
+ * into the base filter, because the base does not keep the hash values of its
+ * k-mers. Once the cap is reached, the base filter has to be rebuilt from the
+ * reference sequences, e.g. with MIBloomFilterBuilder.
+ */
+template<typename T>
+class MIBloomFilterSegments
+{
+
+public:
+  /** Default occupancy of the delta filters' bit vectors. */
+  static constexpr double DEFAULT_OCCUPANCY = 0.5;
+  /**
+   * Default maximum number of committed k-mers, which take about 1.6 GiB with
+   * 3 hashes per k-mer. Deltas are not folded into the base filter, so the base
+   * has to be rebuilt to commit more.
+   */
+  static const uint64_t DEFAULT_MAX_DELTA_KMERS = uint64_t(1) << 26;
+
+  /**
+   * Construct from a completed base filter whose k-mers were hashed with
+   * NtHash.
+   *
+   * @param base Base multi-indexed Bloom filter.
+   * @param occupancy Target bit vector occupancy of the delta filters.
+   * @param max_delta_kmers Maximum number of committed k-mers, see commit().
+   */
+  explicit MIBloomFilterSegments(
+    std::shared_ptr<const MIBloomFilter<T>> base,
+    double occupancy = DEFAULT_OCCUPANCY,
+    uint64_t max_delta_kmers = DEFAULT_MAX_DELTA_KMERS);
+
+  /**
+   * Construct from a completed base filter whose k-mers were hashed with
+   * SeedNtHash, one hash value per seed, as done by MIBloomFilterBuilder.
+   *
+   * @param base Base multi-indexed Bloom filter.
+   * @param seeds Spaced seed patterns the base filter was built with.
+   * @param occupancy Target bit vector occupancy of the delta filters.
+   * @param max_delta_kmers Maximum number of committed k-mers, see commit().
+   */
+  MIBloomFilterSegments(std::shared_ptr<const MIBloomFilter<T>> base,
+                        const std::vector<std::string>& seeds,
+                        double occupancy = DEFAULT_OCCUPANCY,
+                        uint64_t max_delta_kmers = DEFAULT_MAX_DELTA_KMERS);
+
+  MIBloomFilterSegments(const MIBloomFilterSegments&) = delete;
+  MIBloomFilterSegments(MIBloomFilterSegments&&) = delete;
+
+  MIBloomFilterSegments& operator=(const MIBloomFilterSegments&) = delete;
+  MIBloomFilterSegments& operator=(MIBloomFilterSegments&&) = delete;
+
+  ~MIBloomFilterSegments() { wait(); }
+
+  /**
+   * Stage a k-mer for insertion. It becomes visible to queries once a
+   * subsequent commit() completes. This function is thread-safe.
+   *
+   * @param hashes Integer array of hash_num hash values.
+   * @param id ID of the k-mer.
+   */
+  void insert(const uint64_t* hashes, T id);
+
+  /**
+   * Stage all k-mers of a sequence for insertion, hashed like the k-mers of
+   * the base filter: with NtHash using its k-mer size and hash number, or with
+   * SeedNtHash if spaced seeds were given. This function is thread-safe.
+   *
+   * @param seq Sequence to insert.
+   * @param id ID of the sequence.
+   */
+  void insert(const std::string& seq, T id);
+
+  /**
+   * Start building a delta filter from the staged k-mers in a background
+   * thread, merging it with previous deltas as needed. Waits for a previous
+   * commit to finish first.
+   *
+   * @return \p false if the staged k-mers would bring the committed k-mers
+   * over max_delta_kmers. Nothing is committed and the k-mers stay staged.
+   */
+  bool commit();
+
+  /** Wait for a running commit to finish. */
+  void wait();
+
+  /**
+   * Check for presence of an element's hash values in either filter.
+   *
+   * @param hashes Integer array of hash_num hash values.
+   */
+  bool bv_contains(const uint64_t* hashes) const;
+
+  /**
+   * Get the IDs of an element, combined from every filter that contains it.
+   * Like MIBloomFilter::get_id(), one ID is returned per hash value. Each is
+   * chosen among the IDs the filters have for that hash value: unsaturated IDs
+   * first, then the ID that is most common among all of the element's IDs,
+   * then the one from the newest filter.
+   *
+   * @param hashes Integer array of hash_num hash values.
+   * @param ids Output vector, set to the hash_num IDs of the element, or
+   * cleared if no filter contains it.
+   *
+   * @return \p true if any filter contains the element.
+   */
+  bool get_id(const uint64_t* hashes, std::vector<T>& ids) const;
+
+  /**
+   * Get the IDs of an element, combined from every filter that contains it.
+   *
+   * @param hashes Integer array of hash_num hash values.
+   */
+  std::vector<T> get_id(const uint64_t* hashes) const
+  {
+    std::vector<T> ids;
+    get_id(hashes, ids);
+    return ids;
+  }
+
+  /**
+   * Save the committed k-mers of the delta filters, so they can be restored
+   * with load_delta() on top of the same base filter.
+   *
+   * @param path Output filepath.
+   */
+  void save_delta(const std::string& path);
+
+  /**
+   * Commit the k-mers saved with save_delta() as a new delta filter. Blocks
+   * until the delta filter is built.
+   *
+   * @param path Input filepath.
+   *
+   * @return \p false if the saved k-mers would bring the committed k-mers over
+   * max_delta_kmers, in which case nothing is loaded.
+   */
+  bool load_delta(const std::string& path);
+
+  /** Get the base filter. */
+  const MIBloomFilter<T>& get_base() const { return *base; }
+
+  /** Get the current delta filters, newest first. */
+  std::vector<std::shared_ptr<const MIBloomFilter<T>>> get_deltas() const
+  {
+    return *std::atomic_load(&deltas);
+  }
+
+  /** Get the number of staged k-mers that are not committed yet. */
+  uint64_t get_staged_kmer_count();
+
+  /** Get the number of k-mers in the current delta filters. */
+  uint64_t get_delta_kmer_count() const { return delta_kmer_count; }
+
+  unsigned get_hash_num() const { return hash_num; }
+
+private:
+  /// @cond HIDDEN_SYMBOLS
+  struct KmerCache
+  {
+    std::vector<T> ids;
+    std::vector<uint64_t> hashes;
+  };
+
+  struct Segment
+  {
+    std::shared_ptr<const MIBloomFilter<T>> filter;
+    KmerCache kmers;
+  };
+  /// @endcond
+
+  using DeltaList = std::vector<std::shared_ptr<const MIBloomFilter<T>>>;
+
+  void add_segment(KmerCache kmers);
+  std::shared_ptr<const MIBloomFilter<T>> build_filter(
+    const KmerCache& kmers) const;
+
+  const std::shared_ptr<const MIBloomFilter<T>> base;
+  const unsigned hash_num;
+  const std::vector<std::vector<unsigned>> seeds;
+  const double occupancy;
+  const uint64_t max_delta_kmers;
+
+  std::mutex staged_mutex;
+  KmerCache staged;
+  // Oldest first. Only accessed by the commit thread, or after waiting for it.
+  std::vector<Segment> segments;
+  std::shared_ptr<const DeltaList> deltas;
+  std::atomic<uint64_t> delta_kmer_count{ 0 };
+  std::thread commit_thread;
+};
+
+static const char* const MI_BLOOM_FILTER_DELTA_SIGNATURE =
+  "BTLMIBloomFilterDelta_v1";
+
+template<typename T>
+inline MIBloomFilterSegments<T>::MIBloomFilterSegments(
+  std::shared_ptr<const MIBloomFilter<T>> base,
+  const double occupancy,
+  const uint64_t max_delta_kmers)
+  : base(std::move(base))
+  , hash_num(this->base ? this->base->get_hash_num() : 0)
+  , occupancy(occupancy)
+  , max_delta_kmers(max_delta_kmers)
+  , deltas(std::make_shared<const DeltaList>())
+{
+  check_error(!this->base, "MIBloomFilterSegments: no base filter given.");
+  check_error(occupancy <= 0 || occupancy >= 1,
+              "MIBloomFilterSegments: occupancy must be in (0, 1).");
+}
+
+template<typename T>
+inline MIBloomFilterSegments<T>::MIBloomFilterSegments(
+  std::shared_ptr<const MIBloomFilter<T>> base,
+  const std::vector<std::string>& seeds,
+  const double occupancy,
+  const uint64_t max_delta_kmers)
+  : base(std::move(base))
+  , hash_num(this->base ? this->base->get_hash_num() : 0)
+  , seeds(parse_seeds(seeds))
+  , occupancy(occupancy)
+  , max_delta_kmers(max_delta_kmers)
+  , deltas(std::make_shared<const DeltaList>())
+{
+  check_error(!this->base, "MIBloomFilterSegments: no base filter given.");
+  check_error(occupancy <= 0 || occupancy >= 1,
+              "MIBloomFilterSegments: occupancy must be in (0, 1).");
+  check_error(seeds.empty(), "MIBloomFilterSegments: no spaced seeds given.");
+  check_error(seeds.size() != hash_num,
+              "MIBloomFilterSegments: number of spaced seeds (" +
+                std::to_string(seeds.size()) +
+                ") differs from the base filter hash number (" +
+                std::to_string(hash_num) + ").");
+  for (const auto& seed : seeds) {
+    check_error(seed.size() != this->base->get_k(),
+                "MIBloomFilterSegments: spaced seed length (" +
+                  std::to_string(seed.size()) +
+                  ") differs from the base filter k-mer size (" +
+                  std::to_string(this->base->get_k()) + ").");
+  }
+}
+
+template<typename T>
+inline void
+MIBloomFilterSegments<T>::insert(const uint64_t* hashes, const T id)
+{
+  check_error(id > MIBloomFilter<T>::ID_MASK,
+              "MIBloomFilterSegments: ID overflows ID type.");
+  const std::unique_lock<std::mutex> lock(staged_mutex);
+  staged.ids.push_back(id);
+  staged.hashes.insert(staged.hashes.end(), hashes, hashes + hash_num);
+}
+
+template<typename T>
+inline void
+MIBloomFilterSegments<T>::insert(const std::string& seq, const T id)
+{
+  check_error(id > MIBloomFilter<T>::ID_MASK,
+              "MIBloomFilterSegments: ID overflows ID type.");
+  check_error(base->get_k() == 0,
+              "MIBloomFilterSegments: base filter k-mer size is unknown.");
+  check_error(seeds.empty() && base->get_hash_fn() == SEED_NTHASH_FN_NAME,
+              "MIBloomFilterSegments: base filter was built with spaced "
+              "seeds, which have to be given to insert sequences.");
+  if (seq.size() < base->get_k()) {
+    return;
+  }
+  KmerCache kmers;
+  const auto add_kmers = [&](auto& nthash) {
+    while (nthash.roll()) {
+      kmers.ids.push_back(id);
+      kmers.hashes.insert(
+        kmers.hashes.end(), nthash.hashes(), nthash.hashes() + hash_num);
+    }
+  };
+  if (seeds.empty()) {
+    NtHash nthash(seq, hash_num, base->get_k());
+    add_kmers(nthash);
+  } else {
+    SeedNtHash nthash(seq, seeds, 1, base->get_k());
+    add_kmers(nthash);
+  }
+  const std::unique_lock<std::mutex> lock(staged_mutex);
+  staged.ids.insert(staged.ids.end(), kmers.ids.begin(), kmers.ids.end());
+  staged.hashes.insert(
+    staged.hashes.end(), kmers.hashes.begin(), kmers.hashes.end());
+}
+
+template<typename T>
+inline uint64_t
+MIBloomFilterSegments<T>::get_staged_kmer_count()
+{
+  const std::unique_lock<std::mutex> lock(staged_mutex);
+  return staged.ids.size();
+}
+
+template<typename T>
+inline bool
+MIBloomFilterSegments<T>::commit()
+{
+  wait();
+  KmerCache kmers;
+  {
+    const std::unique_lock<std::mutex> lock(staged_mutex);
+    if (delta_kmer_count + staged.ids.size() > max_delta_kmers) {
+      return false;
+    }
+    kmers = std::move(staged);
+    staged = KmerCache();
+  }
+  if (kmers.ids.empty()) {
+    return true;
+  }
+  commit_thread = std::thread([this, kmers = std::move(kmers)]() mutable {
+    try {
+      add_segment(std::move(kmers));
+    } catch (const std::exception& e) {
+      log_error(e.what());
+      std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+    }
+  });
+  return true;
+}
+
+template<typename T>
+inline void
+MIBloomFilterSegments<T>::wait()
+{
+  if (commit_thread.joinable()) {
+    commit_thread.join();
+  }
+}
+
+template<typename T>
+inline void
+MIBloomFilterSegments<T>::add_segment(KmerCache kmers)
+{
+  const uint64_t kmer_count = delta_kmer_count + kmers.ids.size();
+  // Older k-mers go first, so that they are inserted in commit order
+  while (!segments.empty() &&
+         segments.back().kmers.ids.size() <= kmers.ids.size()) {
+    KmerCache& older = segments.back().kmers;
+    older.ids.insert(older.ids.end(), kmers.ids.begin(), kmers.ids.end());
+    older.hashes.insert(
+      older.hashes.end(), kmers.hashes.begin(), kmers.hashes.end());
+    kmers = std::move(older);
+    segments.pop_back();
+  }
+  auto filter = build_filter(kmers);
+  segments.push_back({ std::move(filter), std::move(kmers) });
+
+  auto new_deltas = std::make_shared<DeltaList>();
+  for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+    new_deltas->push_back(it->filter);
+  }
+  std::atomic_store(&deltas, std::shared_ptr<const DeltaList>(new_deltas));
+  delta_kmer_count = kmer_count;
+}
+
+template<typename T>
+inline std::shared_ptr<const MIBloomFilter<T>>
+MIBloomFilterSegments<T>::build_filter(const KmerCache& kmers) const
+{
+  const size_t kmer_count = kmers.ids.size();
+  const size_t bv_size =
+    MIBloomFilter<T>::calc_optimal_size(kmer_count, hash_num, occupancy);
+  auto filter = std::make_shared<MIBloomFilter<T>>(
+    bv_size, hash_num, base->get_hash_fn());
+  const uint64_t* const hashes = kmers.hashes.data();
+  const T* const ids = kmers.ids.data();
+// NOLINTNEXTLINE(openmp-use-default-none,-warnings-as-errors)
+#pragma omp parallel for
+  for (size_t i = 0; i < kmer_count; ++i) {
+    filter->insert_bv(hashes + i * hash_num);
+  }
+  filter->complete_bv_insertion();
+// NOLINTNEXTLINE(openmp-use-default-none,-warnings-as-errors)
+#pragma omp parallel for
+  for (size_t i = 0; i < kmer_count; ++i) {
+    filter->insert_id(hashes + i * hash_num, ids[i]);
+  }
+  filter->complete_id_insertion();
+// NOLINTNEXTLINE(openmp-use-default-none,-warnings-as-errors)
+#pragma omp parallel
+  {
+    typename MIBloomFilter<T>::QueryBuffer buffer(hash_num);
+#pragma omp for
+    for (size_t i = 0; i < kmer_count; ++i) {
+      filter->insert_saturation(hashes + i * hash_num, ids[i], buffer);
+    }
+  }
+  return filter;
+}
+
+template<typename T>
+inline bool
+MIBloomFilterSegments<T>::bv_contains(const uint64_t* hashes) const
+{
+  if (base->bv_contains(hashes)) {
+    return true;
+  }
+  const auto current_deltas = std::atomic_load(&deltas);
+  for (const auto& delta : *current_deltas) {
+    if (delta->bv_contains(hashes)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template<typename T>
+inline bool
+MIBloomFilterSegments<T>::get_id(const uint64_t* hashes,
+                                 std::vector<T>& ids) const
+{
+  ids.clear();
+  const auto add_ids = [&](const MIBloomFilter<T>& filter) {
+    if (filter.bv_contains(hashes)) {
+      const size_t offset = ids.size();
+      ids.resize(offset + hash_num);
+      filter.get_id(hashes, ids.data() + offset);
+    }
+  };
+  const auto current_deltas = std::atomic_load(&deltas);
+  for (const auto& delta : *current_deltas) {
+    add_ids(*delta);
+  }
+  add_ids(*base);
+  const size_t candidates = ids.size();
+  if (candidates <= hash_num) {
+    return candidates > 0;
+  }
+  // An ID that the element really has appears at several of its hash values,
+  // while a false positive filter contributes unrelated IDs
+  const auto score = [&](const T id) {
+    size_t count = 0;
+    for (size_t j = 0; j < candidates; ++j) {
+      if ((ids[j] & MIBloomFilter<T>::ID_MASK) ==
+          (id & MIBloomFilter<T>::ID_MASK)) {
+        ++count;
+      }
+    }
+    return (id & MIBloomFilter<T>::MASK) ? count : count + candidates;
+  };
+  ids.reserve(candidates + hash_num);
+  for (size_t i = 0; i < hash_num; ++i) {
+    size_t best = i;
+    size_t best_score = score(ids[i]);
+    for (size_t j = i + hash_num; j < candidates; j += hash_num) {
+      const size_t candidate_score = score(ids[j]);
+      if (candidate_score > best_score) {
+        best = j;
+        best_score = candidate_score;
+      }
+    }
+    ids.push_back(ids[best]);
+  }
+  ids.erase(ids.begin(), ids.begin() + std::ptrdiff_t(candidates));
+  return true;
+}
+
+template<typename T>
+inline void
+MIBloomFilterSegments<T>::save_delta(const std::string& path)
+{
+  wait();
+  std::ofstream ofs(path, std::ios::out | std::ios::binary);
+  check_error(!ofs, "MIBloomFilterSegments: failed to open " + path);
+  const uint64_t header[] = { hash_num, sizeof(T), delta_kmer_count };
+  ofs << MI_BLOOM_FILTER_DELTA_SIGNATURE << '\n';
+  ofs.write((const char*)header, sizeof(header));
+  for (const auto& segment : segments) {
+    ofs.write((const char*)segment.kmers.ids.data(),
+              std::streamsize(segment.kmers.ids.size() * sizeof(T)));
+  }
+  for (const auto& segment : segments) {
+    ofs.write((const char*)segment.kmers.hashes.data(),
+              std::streamsize(segment.kmers.hashes.size() * sizeof(uint64_t)));
+  }
+  check_error(!ofs, "MIBloomFilterSegments: failed to write to " + path);
+}
+
+template<typename T>
+inline bool
+MIBloomFilterSegments<T>::load_delta(const std::string& path)
+{
+  wait();
+  std::ifstream ifs(path, std::ios::in | std::ios::binary);
+  check_error(!ifs, "MIBloomFilterSegments: failed to open " + path);
+  std::string signature;
+  std::getline(ifs, signature);
+  check_error(signature != MI_BLOOM_FILTER_DELTA_SIGNATURE,
+              "MIBloomFilterSegments: " + path +
+                " is not a delta filter file.");
+  uint64_t header[3] = { 0 };
+  ifs.read((char*)header, sizeof(header));
+  check_error(header[0] != hash_num || header[1] != sizeof(T),
+              "MIBloomFilterSegments: " + path +
+                " has a different hash number or ID size.");
+  if (delta_kmer_count + header[2] > max_delta_kmers) {
+    return false;
+  }
+  KmerCache kmers;
+  kmers.ids.resize(header[2]);
+  kmers.hashes.resize(header[2] * hash_num);
+  ifs.read((char*)kmers.ids.data(), std::streamsize(header[2] * sizeof(T)));
+  ifs.read((char*)kmers.hashes.data(),
+           std::streamsize(kmers.hashes.size() * sizeof(uint64_t)));
+  check_error(!ifs, "MIBloomFilterSegments: " + path + " is truncated.");
+  if (!kmers.ids.empty()) {
+    add_segment(std::move(kmers));
+  }
+  return true;
+}
+
+} // namespace btllib
+
+#endif
@@ -11,7 +11,11 @@
 
 #include <btllib/hashing_internals.hpp>
 #include <btllib/nthash_kmer.hpp>
+#include <btllib/nthash_multi.hpp>
+#include <btllib/nthash_packed.hpp>
+#include <btllib/nthash_parallel.hpp>
 #include <btllib/nthash_seed.hpp>
+#include <btllib/nthash_static.hpp>
 #include <btllib/status.hpp>
 
 namespace btllib {
@@ -23,4 +27,10 @@ namespace btllib {
  */
 static const char* const NTHASH_FN_NAME = "ntHash_v2";
 
+/**
+ * String representing ntHash over spaced seed k-mers, one hash value per seed,
+ * e.g. in multi-indexed Bloom filters built by MIBloomFilterBuilder.
+ */
+static const char* const SEED_NTHASH_FN_NAME = "ntHash_v2_seeds";
+
 } // namespace btllib
\ No newline at end of file
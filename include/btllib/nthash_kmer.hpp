@@ -174,6 +174,88 @@ prev_reverse_hash(uint64_t rh_val,
   return h_val;
 }
 
+/**
+ * Compute the change of the forward hash value of a k-mer when a character is
+ * substituted, i.e. the value XORed into the hash value.
+ *
+ * @param char_out Character at the substituted position.
+ * @param char_in Character placed at the position.
+ * @param pos Index of the substituted position.
+ * @param k k-mer size.
+ * @return Change of the forward hash value.
+ */
+inline uint64_t
+sub_forward_delta(unsigned char char_out,
+                  unsigned char char_in,
+                  unsigned pos,
+                  unsigned k)
+{
+  return srol_table(char_out, k - 1 - pos) ^ srol_table(char_in, k - 1 - pos);
+}
+
+/**
+ * Compute the change of the reverse hash value of a k-mer when a character is
+ * substituted, i.e. the value XORed into the hash value.
+ *
+ * @param char_out Character at the substituted position.
+ * @param char_in Character placed at the position.
+ * @param pos Index of the substituted position.
+ * @return Change of the reverse hash value.
+ */
+inline uint64_t
+sub_reverse_delta(unsigned char char_out, unsigned char char_in, unsigned pos)
+{
+  return srol_table(char_out & CP_OFF, pos) ^ srol_table(char_in & CP_OFF, pos);
+}
+
+/**
+ * Compute the forward hash value of a k-mer after substituting characters.
+ *
+ * @param fh_val Forward hash value of the k-mer.
+ * @param kmer_seq Array of characters representing the k-mer.
+ * @param positions Indicies of the positions to be substituted.
+ * @param new_bases Characters to be placed in the indicies indicated in
+ * positions.
+ * @param k k-mer size.
+ * @return Forward hash value of the substituted k-mer.
+ */
+inline uint64_t
+sub_forward_hash(uint64_t fh_val,
+                 const char* kmer_seq,
+                 const std::vector<unsigned>& positions,
+                 const std::vector<unsigned char>& new_bases,
+                 unsigned k)
+{
+  for (size_t i = 0; i < positions.size(); i++) {
+    const auto pos = positions[i];
+    fh_val ^= sub_forward_delta(kmer_seq[pos], new_bases[i], pos, k);
+  }
+  return fh_val;
+}
+
+/**
+ * Compute the reverse hash value of a k-mer after substituting characters.
+ *
+ * @param rh_val Reverse hash value of the k-mer.
+ * @param kmer_seq Array of characters representing the k-mer.
+ * @param positions Indicies of the positions to be substituted.
+ * @param new_bases Characters to be placed in the indicies indicated in
+ * positions.
+ * @return Reverse hash value of the substituted k-mer.
+ */
+inline uint64_t
+sub_reverse_hash(uint64_t rh_val,
+                 const char* kmer_seq,
+                 const std::vector<unsigned>& positions,
+                 const std::vector<unsigned char>& new_bases)
+{
+  for (size_t i = 0; i < positions.size(); i++) {
+    const auto pos = positions[i];
+    rh_val ^= sub_reverse_delta(kmer_seq[pos], new_bases[i], pos);
+  }
+  return rh_val;
+}
+
 /**
  * Generate multiple new hash values for the input k-mer by substituting
  * multiple characters.
@@ -198,21 +280,9 @@ sub_hash(uint64_t fh_val,
          unsigned m,
          uint64_t* h_val)
 {
-  uint64_t b_val = 0;
-
-  for (size_t i = 0; i < positions.size(); i++) {
-    const auto pos = positions[i];
-    const auto new_base = new_bases[i];
-
-    fh_val ^= srol_table((unsigned char)kmer_seq[pos], k - 1 - pos);
-    fh_val ^= srol_table(new_base, k - 1 - pos);
-
-    rh_val ^= srol_table((unsigned char)kmer_seq[pos] & CP_OFF, pos);
-    rh_val ^= srol_table(new_base & CP_OFF, pos);
-  }
-
-  b_val = canonical(fh_val, rh_val);
-  extend_hashes(b_val, k, m, h_val);
+  fh_val = sub_forward_hash(fh_val, kmer_seq, positions, new_bases, k);
+  rh_val = sub_reverse_hash(rh_val, kmer_seq, positions, new_bases);
+  extend_hashes(canonical(fh_val, rh_val), k, m, h_val);
 }
 
 } // namespace btllib::hashing_internals
@@ -231,9 +301,40 @@ using hashing_internals::SEED_TAB;
 using hashing_internals::sub_hash;
 
 /**
- * Normal k-mer hashing.
+ * Strands hashed by BasicNtHash and StaticNtHash. In the FORWARD and REVERSE
+ * modes, the hash values are derived from the hash of the given strand only,
+ * and the other strand is not computed (its hash value is reported as 0).
+ * Useful for stranded data.
  */
-class NtHash
+enum class NtHashMode
+{
+  CANONICAL,
+  FORWARD,
+  REVERSE
+};
+
+/**
+ * Substitutions that turn a k-mer into one of its variants. See
+ * NtHash::hash_variants().
+ */
+struct KmerVariant
+{
+  /** Number of substituted positions, 1 or 2. */
+  unsigned num;
+  /** Substituted positions in the k-mer, in increasing order. */
+  unsigned positions[2];
+  /** Bases placed at the substituted positions. */
+  char bases[2];
+};
+
+/**
+ * Normal k-mer hashing. Usually used through the NtHash, ForwardNtHash and
+ * ReverseNtHash aliases.
+ * @tparam MODE Strands to hash. The code of each mode is specialized at
+ * compile time, so the canonical mode is as fast as plain canonical hashing.
+ */
+template<NtHashMode MODE = NtHashMode::CANONICAL>
+class BasicNtHash
 {
 
 public:
@@ -245,11 +346,11 @@ public:
    * @param k K-mer size
    * @param pos Position in the sequence to start hashing from
    */
-  NtHash(const char* seq,
-         size_t seq_len,
-         hashing_internals::NUM_HASHES_TYPE num_hashes,
-         hashing_internals::K_TYPE k,
-         size_t pos = 0)
+  BasicNtHash(const char* seq,
+              size_t seq_len,
+              hashing_internals::NUM_HASHES_TYPE num_hashes,
+              hashing_internals::K_TYPE k,
+              size_t pos = 0)
     : seq(seq)
     , seq_len(seq_len)
     , num_hashes(num_hashes)
@@ -259,13 +360,7 @@ public:
     , hash_arr(new uint64_t[num_hashes])
   {
     check_error(k == 0, "NtHash: k must be greater than 0");
-    check_error(this->seq_len < k,
-                "NtHash: sequence length (" + std::to_string(this->seq_len) +
-                  ") is smaller than k (" + std::to_string(k) + ")");
-    check_error(pos > this->seq_len - k,
-                "NtHash: passed position (" + std::to_string(pos) +
-                  ") is larger than sequence length (" +
-                  std::to_string(this->seq_len) + ")");
+    reset(seq, seq_len, pos);
   }
 
   /**
@@ -275,15 +370,15 @@ public:
    * @param k K-mer size
    * @param pos Position in sequence to start hashing from
    */
-  NtHash(const std::string& seq,
-         hashing_internals::NUM_HASHES_TYPE num_hashes,
-         hashing_internals::K_TYPE k,
-         size_t pos = 0)
-    : NtHash(seq.data(), seq.size(), num_hashes, k, pos)
+  BasicNtHash(const std::string& seq,
+              hashing_internals::NUM_HASHES_TYPE num_hashes,
+              hashing_internals::K_TYPE k,
+              size_t pos = 0)
+    : BasicNtHash(seq.data(), seq.size(), num_hashes, k, pos)
   {
   }
 
-  NtHash(const NtHash& obj)
+  BasicNtHash(const BasicNtHash& obj)
     : seq(obj.seq)
     , seq_len(obj.seq_len)
     , num_hashes(obj.num_hashes)
@@ -298,7 +393,40 @@ public:
       hash_arr.get(), obj.hash_arr.get(), num_hashes * sizeof(uint64_t));
   }
 
-  NtHash(NtHash&&) = default;
+  BasicNtHash(BasicNtHash&&) = default;
+
+  /**
+   * Start hashing a new sequence, reusing this object and its hash buffer
+   * instead of constructing a new one. The object is left in the same state
+   * as a newly constructed one with the same k and number of hashes.
+   * @param seq C-string containing sequence data
+   * @param seq_len Length of the sequence
+   * @param pos Position in the sequence to start hashing from
+   */
+  void reset(const char* seq, size_t seq_len, size_t pos = 0)
+  {
+    check_error(seq_len < k,
+                "NtHash: sequence length (" + std::to_string(seq_len) +
+                  ") is smaller than k (" + std::to_string(k) + ")");
+    check_error(pos > seq_len - k,
+                "NtHash: passed position (" + std::to_string(pos) +
+                  ") is larger than sequence length (" +
+                  std::to_string(seq_len) + ")");
+    this->seq = seq;
+    this->seq_len = seq_len;
+    this->pos = pos;
+    initialized = false;
+  }
+
+  /**
+   * Start hashing a new sequence, reusing this object and its hash buffer.
+   * @param seq Sequence string
+   * @param pos Position in the sequence to start hashing from
+   */
+  void reset(const std::string& seq, size_t pos = 0)
+  {
+    reset(seq.data(), seq.size(), pos);
+  }
 
   /**
    * Calculate the hash values of current k-mer and advance to the next k-mer.
@@ -314,24 +442,95 @@ public:
    */
   bool roll()
   {
-    if (!initialized) {
-      return init();
-    }
-    if (pos >= seq_len - k) {
+    if (!roll_base()) {
       return false;
     }
-    if (hashing_internals::SEED_TAB[(unsigned char)seq[pos + k]] ==
-        hashing_internals::SEED_N) {
-      pos += k;
-      return init();
-    }
-    fwd_hash = next_forward_hash(fwd_hash, k, seq[pos], seq[pos + k]);
-    rev_hash = next_reverse_hash(rev_hash, k, seq[pos], seq[pos + k]);
     extend_hashes(fwd_hash, rev_hash, k, num_hashes, hash_arr.get());
-    ++pos;
     return true;
   }
 
+  /**
+   * Like calling roll() up to \p n times, but the hash values of the k-mers
+   * are written to \p hashes and their extensions are computed for the whole
+   * batch with the widest SIMD instructions supported by the CPU. The hash
+   * values of the i-th k-mer are stored starting at hashes[i * stride]. After
+   * the call, the object is in the same state as after the equivalent roll()
+   * calls, i.e. hashes() and get_pos() refer to the last hashed k-mer.
+   * @param n Maximum number of k-mers to hash
+   * @param hashes Output array with room for \p n * \p stride hash values
+   * @param stride Distance between the hash values of consecutive k-mers, at
+   * least get_hash_num()
+   * @param positions Optional output array for the positions of the k-mers
+   * @return Number of hashed k-mers, less than \p n only when the end of the
+   * sequence was reached
+   */
+  size_t roll_batch(size_t n,
+                    uint64_t* hashes,
+                    size_t stride,
+                    size_t* positions = nullptr)
+  {
+    uint64_t fwd_hashes[BATCH_SIZE];
+    uint64_t rev_hashes[BATCH_SIZE];
+    size_t hashed = 0;
+    bool more = true;
+    while (more && hashed < n) {
+      size_t batch = 0;
+      while (batch < BATCH_SIZE && hashed + batch < n) {
+        if (!roll_base()) {
+          more = false;
+          break;
+        }
+        fwd_hashes[batch] = fwd_hash;
+        rev_hashes[batch] = rev_hash;
+        if (positions != nullptr) {
+          positions[hashed + batch] = pos;
+        }
+        ++batch;
+      }
+      hashing_internals::extend_hashes_batch(fwd_hashes,
+                                             rev_hashes,
+                                             batch,
+                                             k,
+                                             num_hashes,
+                                             hashes + hashed * stride,
+                                             stride);
+      hashed += batch;
+    }
+    if (hashed > 0) {
+      std::memcpy(hash_arr.get(),
+                  hashes + (hashed - 1) * stride,
+                  num_hashes * sizeof(uint64_t));
+    }
+    return hashed;
+  }
+
+  /**
+   * Hash all remaining k-mers of the sequence, like roll_batch() with an
+   * unlimited batch size.
+   * @param hashes Output array with room for the hash values of
+   * get_max_kmers() k-mers, \p stride apart
+   * @param stride Distance between the hash values of consecutive k-mers, at
+   * least get_hash_num()
+   * @param positions Optional output array for the positions of the k-mers
+   * @return Number of hashed k-mers
+   */
+  size_t hash_all(uint64_t* hashes, size_t stride, size_t* positions = nullptr)
+  {
+    return roll_batch(get_max_kmers(), hashes, stride, positions);
+  }
+
+  /**
+   * Get an upper bound on the number of k-mers left to hash, i.e. the number
+   * of k-mers hash_all() would produce if the sequence had no invalid
+   * characters.
+   * @return Maximum number of remaining k-mers
+   */
+  size_t get_max_kmers() const
+  {
+    const size_t next = initialized ? pos + 1 : pos;
+    return next > seq_len - k ? 0 : seq_len - k + 1 - next;
+  }
+
   /**
    * Like the roll() function, but advance backwards.
    * @return \p true on success and \p false otherwise
@@ -351,8 +550,12 @@ public:
     if (SEED_TAB[(unsigned char)seq[pos - 1]] == SEED_N) {
       return false;
     }
-    fwd_hash = prev_forward_hash(fwd_hash, k, seq[pos + k - 1], seq[pos - 1]);
-    rev_hash = prev_reverse_hash(rev_hash, k, seq[pos + k - 1], seq[pos - 1]);
+    if constexpr (MODE != NtHashMode::REVERSE) {
+      fwd_hash = prev_forward_hash(fwd_hash, k, seq[pos + k - 1], seq[pos - 1]);
+    }
+    if constexpr (MODE != NtHashMode::FORWARD) {
+      rev_hash = prev_reverse_hash(rev_hash, k, seq[pos + k - 1], seq[pos - 1]);
+    }
     extend_hashes(fwd_hash, rev_hash, k, num_hashes, hash_arr.get());
     --pos;
     return true;
@@ -398,8 +601,13 @@ public:
     if (SEED_TAB[(unsigned char)char_in] == SEED_N) {
       return false;
     }
-    const uint64_t fwd = next_forward_hash(fwd_hash, k, seq[pos], char_in);
-    const uint64_t rev = next_reverse_hash(rev_hash, k, seq[pos], char_in);
+    uint64_t fwd = 0, rev = 0;
+    if constexpr (MODE != NtHashMode::REVERSE) {
+      fwd = next_forward_hash(fwd_hash, k, seq[pos], char_in);
+    }
+    if constexpr (MODE != NtHashMode::FORWARD) {
+      rev = next_reverse_hash(rev_hash, k, seq[pos], char_in);
+    }
     extend_hashes(fwd, rev, k, num_hashes, hash_arr.get());
     return true;
   }
@@ -417,8 +625,13 @@ public:
       return false;
     }
     const unsigned char char_out = seq[pos + k - 1];
-    const uint64_t fwd = prev_forward_hash(fwd_hash, k, char_out, char_in);
-    const uint64_t rev = prev_reverse_hash(rev_hash, k, char_out, char_in);
+    uint64_t fwd = 0, rev = 0;
+    if constexpr (MODE != NtHashMode::REVERSE) {
+      fwd = prev_forward_hash(fwd_hash, k, char_out, char_in);
+    }
+    if constexpr (MODE != NtHashMode::FORWARD) {
+      rev = prev_reverse_hash(rev_hash, k, char_out, char_in);
+    }
     extend_hashes(fwd, rev, k, num_hashes, hash_arr.get());
     return true;
   }
@@ -426,14 +639,129 @@ public:
   void sub(const std::vector<unsigned>& positions,
            const std::vector<unsigned char>& new_bases)
   {
-    sub_hash(fwd_hash,
-             rev_hash,
-             seq + pos,
-             positions,
-             new_bases,
-             get_k(),
-             get_hash_num(),
-             hash_arr.get());
+    uint64_t fwd = 0, rev = 0;
+    if constexpr (MODE != NtHashMode::REVERSE) {
+      fwd = hashing_internals::sub_forward_hash(
+        fwd_hash, seq + pos, positions, new_bases, k);
+    }
+    if constexpr (MODE != NtHashMode::FORWARD) {
+      rev = hashing_internals::sub_reverse_hash(
+        rev_hash, seq + pos, positions, new_bases);
+    }
+    extend_hashes(fwd, rev, k, num_hashes, hash_arr.get());
+  }
+
+  /**
+   * Compute the hash values of every k-mer at Hamming distance 1 (and
+   * optionally 2) from the current k-mer, like calling sub() for each of them,
+   * but without allocations and with the extensions of the hash values
+   * computed in batches with the widest SIMD instructions supported by the
+   * CPU. Variants at distance 1 come first, ordered by position and then by
+   * base (ACGT, skipping the base of the k-mer). Variants at distance 2
+   * follow, ordered by the pair of positions and then by the pair of bases.
+   * Must be called after roll(), and does not change the current k-mer or its
+   * hash values.
+   * @param hashes Output array with room for get_max_variants(\p max_distance)
+   * * \p stride hash values
+   * @param stride Distance between the hash values of consecutive variants, at
+   * least get_hash_num()
+   * @param max_distance Maximum Hamming distance of the variants, 1 or 2
+   * @param variants Optional output array for the substitutions of the
+   * variants
+   * @return Number of variants, 0 if no k-mer has been hashed
+   */
+  size_t hash_variants(uint64_t* hashes,
+                       size_t stride,
+                       unsigned max_distance = 1,
+                       KmerVariant* variants = nullptr)
+  {
+    check_error(max_distance == 0 || max_distance > 2,
+                "NtHash: maximum Hamming distance must be 1 or 2.");
+    if (!initialized) {
+      return 0;
+    }
+    static const char BASES[4] = { 'A', 'C', 'G', 'T' };
+    const char* const kmer = seq + pos;
+    uint64_t fwd_hashes[BATCH_SIZE];
+    uint64_t rev_hashes[BATCH_SIZE];
+    size_t batch = 0;
+    size_t count = 0;
+    // The hash value of a strand that is not hashed stays 0
+    constexpr uint64_t fwd_mask =
+      MODE != NtHashMode::REVERSE ? ~uint64_t(0) : 0;
+    constexpr uint64_t rev_mask =
+      MODE != NtHashMode::FORWARD ? ~uint64_t(0) : 0;
+    const auto add = [&](const uint64_t fwd_delta, const uint64_t rev_delta) {
+      fwd_hashes[batch] = (fwd_hash ^ fwd_delta) & fwd_mask;
+      rev_hashes[batch] = (rev_hash ^ rev_delta) & rev_mask;
+      ++batch;
+      ++count;
+      if (batch == BATCH_SIZE) {
+        uint64_t* const batch_hashes = hashes + (count - batch) * stride;
+        hashing_internals::extend_hashes_batch(
+          fwd_hashes, rev_hashes, batch, k, num_hashes, batch_hashes, stride);
+        batch = 0;
+      }
+    };
+    for (unsigned p = 0; p < k; p++) {
+      const unsigned char char_out = kmer[p];
+      for (const char base : BASES) {
+        if (SEED_TAB[(unsigned char)base] == SEED_TAB[char_out]) {
+          continue;
+        }
+        if (variants != nullptr) {
+          variants[count] = { 1, { p, 0 }, { base, 0 } };
+        }
+        add(hashing_internals::sub_forward_delta(char_out, base, p, k),
+            hashing_internals::sub_reverse_delta(char_out, base, p));
+      }
+    }
+    for (unsigned p1 = 0; max_distance == 2 && p1 < k; p1++) {
+      const unsigned char char_out1 = kmer[p1];
+      for (const char base1 : BASES) {
+        if (SEED_TAB[(unsigned char)base1] == SEED_TAB[char_out1]) {
+          continue;
+        }
+        const uint64_t fwd_delta1 =
+          hashing_internals::sub_forward_delta(char_out1, base1, p1, k);
+        const uint64_t rev_delta1 =
+          hashing_internals::sub_reverse_delta(char_out1, base1, p1);
+        for (unsigned p2 = p1 + 1; p2 < k; p2++) {
+          const unsigned char char_out2 = kmer[p2];
+          for (const char base2 : BASES) {
+            if (SEED_TAB[(unsigned char)base2] == SEED_TAB[char_out2]) {
+              continue;
+            }
+            if (variants != nullptr) {
+              variants[count] = { 2, { p1, p2 }, { base1, base2 } };
+            }
+            add(fwd_delta1 ^ hashing_internals::sub_forward_delta(
+                               char_out2, base2, p2, k),
+                rev_delta1 ^ hashing_internals::sub_reverse_delta(
+                               char_out2, base2, p2));
+          }
+        }
+      }
+    }
+    hashing_internals::extend_hashes_batch(fwd_hashes,
+                                           rev_hashes,
+                                           batch,
+                                           k,
+                                           num_hashes,
+                                           hashes + (count - batch) * stride,
+                                           stride);
+    return count;
+  }
+
+  /**
+   * Get the number of variants hash_variants() produces for a k-mer.
+   * @param max_distance Maximum Hamming distance of the variants, 1 or 2
+   * @return Number of variants
+   */
+  size_t get_max_variants(unsigned max_distance = 1) const
+  {
+    const size_t single = size_t(3) * k;
+    return max_distance < 2 ? single : single + single * (single - 3) / 2;
   }
 
   /**
@@ -463,19 +791,25 @@ public:
 
   /**
    * Get the hash value of the forward strand.
-   * @return Forward hash value
+   * @return Forward hash value, 0 in the REVERSE mode
    */
   uint64_t get_forward_hash() const { return fwd_hash; }
 
   /**
    * Get the hash value of the reverse strand.
-   * @return Reverse-complement hash value
+   * @return Reverse-complement hash value, 0 in the FORWARD mode
    */
   uint64_t get_reverse_hash() const { return rev_hash; }
 
+  /**
+   * Get the strands that are hashed.
+   * @return Hashing mode
+   */
+  static constexpr NtHashMode get_mode() { return MODE; }
+
 private:
   const char* seq;
-  const size_t seq_len;
+  size_t seq_len;
   hashing_internals::NUM_HASHES_TYPE num_hashes;
   hashing_internals::K_TYPE k;
   size_t pos;
@@ -484,11 +818,54 @@ private:
   uint64_t rev_hash = 0;
   std::unique_ptr<uint64_t[]> hash_arr;
 
+  // Number of k-mers whose hash values roll_batch() extends at once
+  static const size_t BATCH_SIZE = 64;
+
+  /**
+   * Like roll(), but only update the forward and reverse hash values.
+   * @return \p true on success and \p false otherwise
+   */
+  bool roll_base()
+  {
+    if (!initialized) {
+      return init_base();
+    }
+    if (pos >= seq_len - k) {
+      return false;
+    }
+    if (hashing_internals::SEED_TAB[(unsigned char)seq[pos + k]] ==
+        hashing_internals::SEED_N) {
+      pos += k;
+      return init_base();
+    }
+    if constexpr (MODE != NtHashMode::REVERSE) {
+      fwd_hash = next_forward_hash(fwd_hash, k, seq[pos], seq[pos + k]);
+    }
+    if constexpr (MODE != NtHashMode::FORWARD) {
+      rev_hash = next_reverse_hash(rev_hash, k, seq[pos], seq[pos + k]);
+    }
+    ++pos;
+    return true;
+  }
+
   /**
    * Initialize the internal state of the iterator
    * @return \p true if successful, \p false otherwise
    */
   bool init()
+  {
+    if (!init_base()) {
+      return false;
+    }
+    extend_hashes(fwd_hash, rev_hash, k, num_hashes, hash_arr.get());
+    return true;
+  }
+
+  /**
+   * Like init(), but only compute the forward and reverse hash values.
+   * @return \p true if successful, \p false otherwise
+   */
+  bool init_base()
   {
     bool has_n = true;
     while (pos <= seq_len - k + 1 && has_n) {
@@ -503,14 +880,26 @@ private:
     if (pos > seq_len - k) {
       return false;
     }
-    fwd_hash = base_forward_hash(seq + pos, k);
-    rev_hash = base_reverse_hash(seq + pos, k);
-    extend_hashes(fwd_hash, rev_hash, k, num_hashes, hash_arr.get());
+    if constexpr (MODE != NtHashMode::REVERSE) {
+      fwd_hash = base_forward_hash(seq + pos, k);
+    }
+    if constexpr (MODE != NtHashMode::FORWARD) {
+      rev_hash = base_reverse_hash(seq + pos, k);
+    }
     initialized = true;
     return true;
   }
 };
 
+/** Canonical k-mer hashing. */
+using NtHash = BasicNtHash<NtHashMode::CANONICAL>;
+
+/** Hashing of the forward strand of k-mers only. */
+using ForwardNtHash = BasicNtHash<NtHashMode::FORWARD>;
+
+/** Hashing of the reverse-complement strand of k-mers only. */
+using ReverseNtHash = BasicNtHash<NtHashMode::REVERSE>;
+
 /**
  * Similar to the NtHash class, but instead of rolling on a predefined sequence,
  * BlindNtHash needs to be fed the new character on each roll. This is useful
@@ -521,6 +910,12 @@ class BlindNtHash
 {
 
 public:
+  /**
+   * Bases of the extensions hashed by peek_all_successors() and
+   * peek_all_predecessors(), in order.
+   */
+  static constexpr char EXTENSION_BASES[4] = { 'A', 'C', 'G', 'T' };
+
   /**
    * Construct an ntHash object for hashing k-mers on-the-fly.
    * @param seq Sequence data. Only the first \p k characters will be
@@ -609,6 +1004,49 @@ public:
     extend_hashes(fwd, rev, seq.size(), num_hashes, hash_arr.get());
   }
 
+  /**
+   * Compute the hash values of the four k-mers that follow the current one,
+   * i.e. what peek(char char_in) gives for each of EXTENSION_BASES, without
+   * changing the object. The hash values of all four k-mers are extended at
+   * once with the widest SIMD instructions supported by the CPU.
+   * @param hashes Output array with room for 4 * get_hash_num() hash values.
+   * The hash values of the k-mer ending with EXTENSION_BASES[i] start at
+   * hashes[i * get_hash_num()].
+   */
+  void peek_all_successors(uint64_t* hashes) const
+  {
+    const hashing_internals::K_TYPE k = seq.size();
+    uint64_t fwd[4];
+    uint64_t rev[4];
+    for (unsigned i = 0; i < 4; i++) {
+      fwd[i] = next_forward_hash(fwd_hash, k, seq.front(), EXTENSION_BASES[i]);
+      rev[i] = next_reverse_hash(rev_hash, k, seq.front(), EXTENSION_BASES[i]);
+    }
+    hashing_internals::extend_hashes_batch(
+      fwd, rev, 4, k, num_hashes, hashes, num_hashes);
+  }
+
+  /**
+   * Like peek_all_successors(), but for the four k-mers that precede the
+   * current one, i.e. what peek_back(char char_in) gives for each of
+   * EXTENSION_BASES.
+   * @param hashes Output array with room for 4 * get_hash_num() hash values.
+   * The hash values of the k-mer starting with EXTENSION_BASES[i] start at
+   * hashes[i * get_hash_num()].
+   */
+  void peek_all_predecessors(uint64_t* hashes) const
+  {
+    const hashing_internals::K_TYPE k = seq.size();
+    uint64_t fwd[4];
+    uint64_t rev[4];
+    for (unsigned i = 0; i < 4; i++) {
+      fwd[i] = prev_forward_hash(fwd_hash, k, seq.back(), EXTENSION_BASES[i]);
+      rev[i] = prev_reverse_hash(rev_hash, k, seq.back(), EXTENSION_BASES[i]);
+    }
+    hashing_internals::extend_hashes_batch(
+      fwd, rev, 4, k, num_hashes, hashes, num_hashes);
+  }
+
   /**
    * Get the array of current hash values (length = \p get_hash_num())
    * @return Pointer to the hash array
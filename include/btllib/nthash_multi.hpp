@@ -0,0 +1,440 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <btllib/hashing_internals.hpp>
+#include <btllib/nthash_kmer.hpp>
+#include <btllib/status.hpp>
+
+namespace btllib::hashing_internals {
+
+/**
+ * Per-character rolling terms for a fixed k, laid out as four tables of
+ * ASCII_SIZE entries: the terms added to the forward and reverse hashes by
+ * an incoming character, followed by those removed for an outgoing one.
+ * Invalid characters have all-zero terms, so rolling over them leaves the
+ * hash of the valid characters in the window unchanged.
+ */
+using RollTables = std::array<uint64_t, 4 * ASCII_SIZE>;
+
+const unsigned ROLL_FWD_IN = 0;
+const unsigned ROLL_FWD_OUT = ASCII_SIZE;
+const unsigned ROLL_REV_IN = 2 * ASCII_SIZE;
+const unsigned ROLL_REV_OUT = 3 * ASCII_SIZE;
+
+inline void
+fill_roll_tables(RollTables& tables, unsigned k)
+{
+  for (unsigned c = 0; c < ASCII_SIZE; c++) {
+    const bool valid = SEED_TAB[c] != SEED_N;
+    const auto rc = (unsigned char)(c & CP_OFF);
+    tables[ROLL_FWD_IN + c] = valid ? SEED_TAB[c] : 0;
+    tables[ROLL_FWD_OUT + c] = valid ? srol_table((unsigned char)c, k) : 0;
+    tables[ROLL_REV_IN + c] = valid ? srol_table(rc, k) : 0;
+    tables[ROLL_REV_OUT + c] = valid ? SEED_TAB[rc] : 0;
+  }
+}
+
+/**
+ * Roll the forward and reverse hashes of several independent streams by one
+ * character each.
+ * @param fwd_hashes Forward hash of each stream
+ * @param rev_hashes Reverse hash of each stream
+ * @param chars_in Incoming character of each stream
+ * @param chars_out Outgoing character of each stream
+ * @param n Number of streams
+ * @param tables Rolling terms from fill_roll_tables()
+ */
+inline void
+roll_streams_scalar(uint64_t* fwd_hashes,
+                    uint64_t* rev_hashes,
+                    const uint8_t* chars_in,
+                    const uint8_t* chars_out,
+                    unsigned n,
+                    const uint64_t* tables)
+{
+  for (unsigned l = 0; l < n; l++) {
+    fwd_hashes[l] = srol(fwd_hashes[l]) ^ tables[ROLL_FWD_IN + chars_in[l]] ^
+                    tables[ROLL_FWD_OUT + chars_out[l]];
+    rev_hashes[l] = sror(rev_hashes[l] ^ tables[ROLL_REV_IN + chars_in[l]] ^
+                         tables[ROLL_REV_OUT + chars_out[l]]);
+  }
+}
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(SWIG)
+/// @cond HIDDEN_SYMBOLS
+// Vector versions of srol() and sror() on one hash per lane; the rolling
+// terms are gathered from the tables with the characters as indices.
+
+__attribute__((target("avx2"))) inline void
+roll_streams_avx2(uint64_t* fwd_hashes,
+                  uint64_t* rev_hashes,
+                  const uint8_t* chars_in,
+                  const uint8_t* chars_out,
+                  unsigned n,
+                  const uint64_t* tables)
+{
+  const unsigned lanes = 4;
+  // NOLINTNEXTLINE(google-runtime-int)
+  const auto* const table = reinterpret_cast<const long long*>(tables);
+  const __m256i bit_63 = _mm256_set1_epi64x(int64_t(0x8000000000000000ULL));
+  const __m256i bit_32 = _mm256_set1_epi64x(int64_t(0x100000000ULL));
+  const __m256i bit_33 = _mm256_set1_epi64x(int64_t(0x200000000ULL));
+  const __m256i bit_0 = _mm256_set1_epi64x(1);
+  const __m256i srol_mask = _mm256_set1_epi64x(int64_t(0xFFFFFFFDFFFFFFFFULL));
+  const __m256i sror_mask = _mm256_set1_epi64x(int64_t(0xFFFFFFFEFFFFFFFFULL));
+  unsigned l = 0;
+  for (; l + lanes <= n; l += lanes) {
+    int32_t in_bytes, out_bytes;
+    std::memcpy(&in_bytes, chars_in + l, sizeof(in_bytes));
+    std::memcpy(&out_bytes, chars_out + l, sizeof(out_bytes));
+    const __m256i in = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(in_bytes));
+    const __m256i out = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(out_bytes));
+
+    auto* const fwd_ptr = reinterpret_cast<__m256i*>(fwd_hashes + l);
+    const __m256i fwd = _mm256_loadu_si256(fwd_ptr);
+    const __m256i fwd_carry =
+      _mm256_or_si256(_mm256_srli_epi64(_mm256_and_si256(fwd, bit_63), 30),
+                      _mm256_srli_epi64(_mm256_and_si256(fwd, bit_32), 32));
+    __m256i fwd_next = _mm256_or_si256(
+      _mm256_and_si256(_mm256_slli_epi64(fwd, 1), srol_mask), fwd_carry);
+    fwd_next = _mm256_xor_si256(
+      fwd_next, _mm256_i64gather_epi64(table + ROLL_FWD_IN, in, 8));
+    fwd_next = _mm256_xor_si256(
+      fwd_next, _mm256_i64gather_epi64(table + ROLL_FWD_OUT, out, 8));
+    _mm256_storeu_si256(fwd_ptr, fwd_next);
+
+    auto* const rev_ptr = reinterpret_cast<__m256i*>(rev_hashes + l);
+    __m256i rev = _mm256_loadu_si256(rev_ptr);
+    rev = _mm256_xor_si256(
+      rev, _mm256_i64gather_epi64(table + ROLL_REV_IN, in, 8));
+    rev = _mm256_xor_si256(
+      rev, _mm256_i64gather_epi64(table + ROLL_REV_OUT, out, 8));
+    const __m256i rev_carry =
+      _mm256_or_si256(_mm256_slli_epi64(_mm256_and_si256(rev, bit_33), 30),
+                      _mm256_slli_epi64(_mm256_and_si256(rev, bit_0), 32));
+    _mm256_storeu_si256(
+      rev_ptr,
+      _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi64(rev, 1), sror_mask),
+                      rev_carry));
+  }
+  roll_streams_scalar(fwd_hashes + l,
+                      rev_hashes + l,
+                      chars_in + l,
+                      chars_out + l,
+                      n - l,
+                      tables);
+}
+
+__attribute__((target("avx512f"))) inline __m512i
+gather_terms_avx512(const uint64_t* table, const __m512i chars)
+{
+  // The merge-masked form avoids a spurious uninitialized warning in GCC
+  return _mm512_mask_i64gather_epi64(
+    _mm512_setzero_si512(), __mmask8(0xFF), chars, table, 8);
+}
+
+__attribute__((target("avx512f"))) inline void
+roll_streams_avx512(uint64_t* fwd_hashes,
+                    uint64_t* rev_hashes,
+                    const uint8_t* chars_in,
+                    const uint8_t* chars_out,
+                    unsigned n,
+                    const uint64_t* tables)
+{
+  const unsigned lanes = 8;
+  const __m512i bit_63 = _mm512_set1_epi64(int64_t(0x8000000000000000ULL));
+  const __m512i bit_32 = _mm512_set1_epi64(int64_t(0x100000000ULL));
+  const __m512i bit_33 = _mm512_set1_epi64(int64_t(0x200000000ULL));
+  const __m512i bit_0 = _mm512_set1_epi64(1);
+  const __m512i srol_mask = _mm512_set1_epi64(int64_t(0xFFFFFFFDFFFFFFFFULL));
+  const __m512i sror_mask = _mm512_set1_epi64(int64_t(0xFFFFFFFEFFFFFFFFULL));
+  // Zero-masked forms avoid spurious uninitialized warnings in GCC
+  const auto all = __mmask8(0xFF);
+  unsigned l = 0;
+  for (; l + lanes <= n; l += lanes) {
+    const __m512i in = _mm512_maskz_cvtepu8_epi64(
+      all, _mm_loadl_epi64(reinterpret_cast<const __m128i*>(chars_in + l)));
+    const __m512i out = _mm512_maskz_cvtepu8_epi64(
+      all, _mm_loadl_epi64(reinterpret_cast<const __m128i*>(chars_out + l)));
+
+    const __m512i fwd = _mm512_loadu_si512(fwd_hashes + l);
+    const __m512i fwd_carry = _mm512_or_si512(
+      _mm512_maskz_srli_epi64(all, _mm512_and_si512(fwd, bit_63), 30),
+      _mm512_maskz_srli_epi64(all, _mm512_and_si512(fwd, bit_32), 32));
+    __m512i fwd_next = _mm512_or_si512(
+      _mm512_and_si512(_mm512_maskz_slli_epi64(all, fwd, 1), srol_mask),
+      fwd_carry);
+    fwd_next = _mm512_xor_si512(
+      fwd_next, gather_terms_avx512(tables + ROLL_FWD_IN, in));
+    fwd_next = _mm512_xor_si512(
+      fwd_next, gather_terms_avx512(tables + ROLL_FWD_OUT, out));
+    _mm512_storeu_si512(fwd_hashes + l, fwd_next);
+
+    __m512i rev = _mm512_loadu_si512(rev_hashes + l);
+    rev =
+      _mm512_xor_si512(rev, gather_terms_avx512(tables + ROLL_REV_IN, in));
+    rev =
+      _mm512_xor_si512(rev, gather_terms_avx512(tables + ROLL_REV_OUT, out));
+    const __m512i rev_carry = _mm512_or_si512(
+      _mm512_maskz_slli_epi64(all, _mm512_and_si512(rev, bit_33), 30),
+      _mm512_maskz_slli_epi64(all, _mm512_and_si512(rev, bit_0), 32));
+    _mm512_storeu_si512(
+      rev_hashes + l,
+      _mm512_or_si512(
+        _mm512_and_si512(_mm512_maskz_srli_epi64(all, rev, 1), sror_mask),
+        rev_carry));
+  }
+  roll_streams_scalar(fwd_hashes + l,
+                      rev_hashes + l,
+                      chars_in + l,
+                      chars_out + l,
+                      n - l,
+                      tables);
+}
+/// @endcond
+#endif
+
+/**
+ * Roll several independent streams by one character each, using the widest
+ * SIMD instructions supported by the CPU. Same result as
+ * roll_streams_scalar().
+ * @param level Instruction set to use, must be supported by the CPU
+ */
+inline void
+roll_streams(uint64_t* fwd_hashes,
+             uint64_t* rev_hashes,
+             const uint8_t* chars_in,
+             const uint8_t* chars_out,
+             unsigned n,
+             const uint64_t* tables,
+             SimdLevel level = get_simd_level())
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+  switch (level) {
+    case SimdLevel::AVX512:
+      roll_streams_avx512(
+        fwd_hashes, rev_hashes, chars_in, chars_out, n, tables);
+      return;
+    case SimdLevel::AVX2:
+      roll_streams_avx2(fwd_hashes, rev_hashes, chars_in, chars_out, n, tables);
+      return;
+    default:
+      break;
+  }
+#else
+  (void)level;
+#endif
+  roll_streams_scalar(fwd_hashes, rev_hashes, chars_in, chars_out, n, tables);
+}
+
+} // namespace btllib::hashing_internals
+
+namespace btllib {
+
+/**
+ * Hash the k-mers of several sequences at once, e.g. a batch of short reads.
+ * Each of the \p LANES lanes holds its own sequence, and roll() advances all
+ * lanes by one base in lockstep using SIMD instructions where available.
+ * Rather than re-initializing after invalid characters, like NtHash, lanes
+ * roll over them and report a k-mer once its window is free of them again,
+ * so all lanes always do the same work. A lane whose sequence is exhausted
+ * can be given a new one with set() while the others keep rolling:
+ *
+ *   MultiNtHash<8> hasher(num_hashes, k);
+ *   // set() each lane, then:
+ *   while (hasher.get_active() != 0) {
+ *     const auto ready = hasher.roll();
+ *     // use hashes(lane) of each lane set in ready, then set() new
+ *     // sequences into lanes that are no longer active
+ *   }
+ *
+ * The k-mers of each sequence and their hashes are the same as those of
+ * NtHash::roll().
+ * @tparam LANES Number of sequences hashed together, a multiple of 4 up to 64
+ */
+template<unsigned LANES = 8>
+class MultiNtHash
+{
+  static_assert(LANES % 4 == 0 && LANES > 0 && LANES <= 64,
+                "MultiNtHash: LANES must be a multiple of 4 up to 64.");
+
+public:
+  /**
+   * Construct a hasher with all lanes empty.
+   * @param num_hashes Number of hashes to generate per k-mer
+   * @param k K-mer size
+   */
+  MultiNtHash(hashing_internals::NUM_HASHES_TYPE num_hashes,
+              hashing_internals::K_TYPE k)
+    : num_hashes(num_hashes)
+    , k(k)
+    , hash_arr(new uint64_t[LANES * num_hashes])
+  {
+    check_error(k == 0, "MultiNtHash: k must be greater than 0");
+    hashing_internals::fill_roll_tables(tables, k);
+    for (unsigned l = 0; l < LANES; l++) {
+      clear(l);
+    }
+  }
+
+  MultiNtHash(const MultiNtHash&) = delete;
+  MultiNtHash(MultiNtHash&&) = default;
+
+  /**
+   * Start hashing a sequence in a lane, discarding the lane's previous
+   * sequence. The sequence is not copied and must outlive its use.
+   * @param lane Lane index
+   * @param seq C-string containing sequence data
+   * @param seq_len Length of the sequence. Sequences shorter than k have no
+   * k-mers and leave the lane inactive.
+   */
+  void set(unsigned lane, const char* seq, size_t seq_len)
+  {
+    clear(lane);
+    seqs[lane] = seq;
+    seq_lens[lane] = seq_len;
+    if (seq_len >= k) {
+      active |= uint64_t(1) << lane;
+    }
+  }
+
+  /**
+   * Start hashing a sequence in a lane. The string must outlive its use.
+   * @param lane Lane index
+   * @param seq Sequence string
+   */
+  void set(unsigned lane, const std::string& seq)
+  {
+    set(lane, seq.data(), seq.size());
+  }
+
+  /**
+   * Advance every active lane by one base.
+   * @return Bit mask of the lanes whose current window is a valid k-mer,
+   * whose hash values are then available through hashes(lane)
+   */
+  uint64_t roll()
+  {
+    uint64_t ready = 0;
+    for (unsigned l = 0; l < LANES; l++) {
+      chars_in[l] = 0;
+      chars_out[l] = 0;
+      if (((active >> l) & 1) == 0) {
+        continue;
+      }
+      const size_t pos = ends[l];
+      chars_in[l] = (unsigned char)seqs[l][pos];
+      if (pos >= k) {
+        chars_out[l] = (unsigned char)seqs[l][pos - k];
+      }
+      valid_run[l] = tables[hashing_internals::ROLL_FWD_IN + chars_in[l]] != 0
+                       ? valid_run[l] + 1
+                       : 0;
+      ends[l] = pos + 1;
+      if (valid_run[l] >= k) {
+        ready |= uint64_t(1) << l;
+      }
+      if (ends[l] == seq_lens[l]) {
+        active &= ~(uint64_t(1) << l);
+      }
+    }
+    hashing_internals::roll_streams(
+      fwd_hash, rev_hash, chars_in, chars_out, LANES, tables.data());
+    if (ready != 0) {
+      hashing_internals::extend_hashes_batch(
+        fwd_hash, rev_hash, LANES, k, num_hashes, hash_arr.get(), num_hashes);
+    }
+    return ready;
+  }
+
+  /**
+   * Get the lanes that still have bases to roll.
+   * @return Bit mask of the active lanes
+   */
+  uint64_t get_active() const { return active; }
+
+  /**
+   * Get the hash values of a lane's current k-mer (length = \p
+   * get_hash_num()). Only valid if the lane was set in the last roll() result.
+   * @param lane Lane index
+   * @return Pointer to the hash array
+   */
+  const uint64_t* hashes(unsigned lane) const
+  {
+    return hash_arr.get() + lane * num_hashes;
+  }
+
+  /**
+   * Get the position of a lane's current k-mer in its sequence.
+   * @param lane Lane index
+   * @return Position of the k-mer's first base-pair
+   */
+  size_t get_pos(unsigned lane) const { return ends[lane] - k; }
+
+  /**
+   * Get the forward hash value of a lane's current k-mer.
+   * @param lane Lane index
+   * @return Forward hash value
+   */
+  uint64_t get_forward_hash(unsigned lane) const { return fwd_hash[lane]; }
+
+  /**
+   * Get the reverse-complement hash value of a lane's current k-mer.
+   * @param lane Lane index
+   * @return Reverse-complement hash value
+   */
+  uint64_t get_reverse_hash(unsigned lane) const { return rev_hash[lane]; }
+
+  /**
+   * Get the number of hashes generated per k-mer.
+   * @return Number of hashes per k-mer
+   */
+  hashing_internals::NUM_HASHES_TYPE get_hash_num() const { return num_hashes; }
+
+  /**
+   * Get the length of the k-mers.
+   * @return \p k
+   */
+  hashing_internals::K_TYPE get_k() const { return k; }
+
+  /**
+   * Get the number of lanes.
+   * @return \p LANES
+   */
+  static constexpr unsigned get_lanes() { return LANES; }
+
+private:
+  hashing_internals::NUM_HASHES_TYPE num_hashes;
+  hashing_internals::K_TYPE k;
+  hashing_internals::RollTables tables;
+  std::array<const char*, LANES> seqs;
+  std::array<size_t, LANES> seq_lens;
+  // Number of bases rolled into each lane so far
+  std::array<size_t, LANES> ends;
+  // Number of valid bases at the end of each lane's window
+  std::array<size_t, LANES> valid_run;
+  uint64_t active = 0;
+  alignas(64) uint64_t fwd_hash[LANES];
+  alignas(64) uint64_t rev_hash[LANES];
+  alignas(64) uint8_t chars_in[LANES];
+  alignas(64) uint8_t chars_out[LANES];
+  std::unique_ptr<uint64_t[]> hash_arr;
+
+  void clear(unsigned lane)
+  {
+    seqs[lane] = nullptr;
+    seq_lens[lane] = 0;
+    ends[lane] = 0;
+    valid_run[lane] = 0;
+    fwd_hash[lane] = 0;
+    rev_hash[lane] = 0;
+    active &= ~(uint64_t(1) << lane);
+  }
+};
+
+} // namespace btllib
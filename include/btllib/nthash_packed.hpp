@@ -0,0 +1,461 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <btllib/hashing_internals.hpp>
+#include <btllib/nthash_kmer.hpp>
+#include <btllib/packed_seq.hpp>
+#include <btllib/status.hpp>
+
+namespace btllib {
+
+/**
+ * Like BasicNtHash, but for k-mers of a PackedSeq. The bases are read as
+ * 2-bit codes, which index the seed tables directly, so the sequence is never
+ * unpacked. Produces the same k-mers and hash values as BasicNtHash over the
+ * unpacked sequence. Usually used through the PackedNtHash alias.
+ * @tparam MODE Strands to hash, as in BasicNtHash
+ */
+template<NtHashMode MODE = NtHashMode::CANONICAL>
+class BasicPackedNtHash
+{
+
+public:
+  /**
+   * Construct an ntHash object for k-mers of a packed sequence.
+   * @param seq Packed sequence, which must outlive the object
+   * @param num_hashes Number of hashes to produce per k-mer
+   * @param k K-mer size
+   * @param pos Position in sequence to start hashing from
+   */
+  BasicPackedNtHash(const PackedSeq& seq,
+                    hashing_internals::NUM_HASHES_TYPE num_hashes,
+                    hashing_internals::K_TYPE k,
+                    size_t pos = 0)
+    : num_hashes(num_hashes)
+    , k(k)
+    , hash_arr(new uint64_t[num_hashes])
+  {
+    check_error(k == 0, "PackedNtHash: k must be greater than 0");
+    for (unsigned code = 0; code < 4; code++) {
+      fwd_out[code] = hashing_internals::srol_table(BASES[code], k);
+      rev_in[code] = hashing_internals::srol_table(BASES[code ^ 2], k);
+    }
+    reset(seq, pos);
+  }
+
+  BasicPackedNtHash(const BasicPackedNtHash& obj)
+    : seq(obj.seq)
+    , seq_len(obj.seq_len)
+    , num_hashes(obj.num_hashes)
+    , k(obj.k)
+    , pos(obj.pos)
+    , initialized(obj.initialized)
+    , fwd_hash(obj.fwd_hash)
+    , rev_hash(obj.rev_hash)
+    , hash_arr(new uint64_t[obj.num_hashes])
+  {
+    std::memcpy(fwd_out, obj.fwd_out, sizeof(fwd_out));
+    std::memcpy(rev_in, obj.rev_in, sizeof(rev_in));
+    std::memcpy(
+      hash_arr.get(), obj.hash_arr.get(), num_hashes * sizeof(uint64_t));
+  }
+
+  BasicPackedNtHash(BasicPackedNtHash&&) = default;
+
+  /**
+   * Start hashing a new packed sequence, reusing this object and its hash
+   * buffer. Refer to \ref BasicNtHash::reset() for more information.
+   * @param seq Packed sequence, which must outlive the object
+   * @param pos Position in the sequence to start hashing from
+   */
+  void reset(const PackedSeq& seq, size_t pos = 0)
+  {
+    check_error(seq.size() < k,
+                "PackedNtHash: sequence length (" + std::to_string(seq.size()) +
+                  ") is smaller than k (" + std::to_string(k) + ")");
+    check_error(pos > seq.size() - k,
+                "PackedNtHash: passed position (" + std::to_string(pos) +
+                  ") is larger than sequence length (" +
+                  std::to_string(seq.size()) + ")");
+    this->seq = &seq;
+    this->seq_len = seq.size();
+    this->pos = pos;
+    initialized = false;
+  }
+
+  /**
+   * Calculate the hash values of current k-mer and advance to the next k-mer.
+   * Refer to \ref BasicNtHash::roll() for more information.
+   * @return \p true on success and \p false otherwise
+   */
+  bool roll()
+  {
+    if (!roll_base()) {
+      return false;
+    }
+    hashing_internals::extend_hashes(
+      fwd_hash, rev_hash, k, num_hashes, hash_arr.get());
+    return true;
+  }
+
+  /**
+   * Like calling roll() up to \p n times. Refer to
+   * \ref BasicNtHash::roll_batch() for more information.
+   * @param n Maximum number of k-mers to hash
+   * @param hashes Output array with room for \p n * \p stride hash values
+   * @param stride Distance between the hash values of consecutive k-mers, at
+   * least get_hash_num()
+   * @param positions Optional output array for the positions of the k-mers
+   * @return Number of hashed k-mers, less than \p n only when the end of the
+   * sequence was reached
+   */
+  size_t roll_batch(size_t n,
+                    uint64_t* hashes,
+                    size_t stride,
+                    size_t* positions = nullptr)
+  {
+    uint64_t fwd_hashes[BATCH_SIZE];
+    uint64_t rev_hashes[BATCH_SIZE];
+    size_t hashed = 0;
+    bool more = true;
+    while (more && hashed < n) {
+      size_t batch = 0;
+      while (batch < BATCH_SIZE && hashed + batch < n) {
+        if (!roll_base()) {
+          more = false;
+          break;
+        }
+        fwd_hashes[batch] = fwd_hash;
+        rev_hashes[batch] = rev_hash;
+        if (positions != nullptr) {
+          positions[hashed + batch] = pos;
+        }
+        ++batch;
+      }
+      hashing_internals::extend_hashes_batch(fwd_hashes,
+                                             rev_hashes,
+                                             batch,
+                                             k,
+                                             num_hashes,
+                                             hashes + hashed * stride,
+                                             stride);
+      hashed += batch;
+    }
+    if (hashed > 0) {
+      std::memcpy(hash_arr.get(),
+                  hashes + (hashed - 1) * stride,
+                  num_hashes * sizeof(uint64_t));
+    }
+    return hashed;
+  }
+
+  /**
+   * Hash all remaining k-mers of the sequence, like roll_batch() with an
+   * unlimited batch size.
+   * @param hashes Output array with room for the hash values of
+   * get_max_kmers() k-mers, \p stride apart
+   * @param stride Distance between the hash values of consecutive k-mers, at
+   * least get_hash_num()
+   * @param positions Optional output array for the positions of the k-mers
+   * @return Number of hashed k-mers
+   */
+  size_t hash_all(uint64_t* hashes, size_t stride, size_t* positions = nullptr)
+  {
+    return roll_batch(get_max_kmers(), hashes, stride, positions);
+  }
+
+  /**
+   * Get an upper bound on the number of k-mers left to hash.
+   * @return Maximum number of remaining k-mers
+   */
+  size_t get_max_kmers() const
+  {
+    const size_t next = initialized ? pos + 1 : pos;
+    return next > seq_len - k ? 0 : seq_len - k + 1 - next;
+  }
+
+  /**
+   * Like the roll() function, but advance backwards.
+   * @return \p true on success and \p false otherwise
+   */
+  bool roll_back()
+  {
+    if (!initialized) {
+      return init();
+    }
+    if (pos == 0) {
+      return false;
+    }
+    if (seq->is_n(pos - 1) && pos >= k) {
+      pos -= k;
+      return init();
+    }
+    if (seq->is_n(pos - 1)) {
+      return false;
+    }
+    --pos;
+    fwd_hash = prev_fwd(fwd_hash, seq->code(pos + k), seq->code(pos));
+    rev_hash = prev_rev(rev_hash, seq->code(pos + k), seq->code(pos));
+    hashing_internals::extend_hashes(
+      fwd_hash, rev_hash, k, num_hashes, hash_arr.get());
+    return true;
+  }
+
+  /**
+   * Peeks the hash values as if roll() was called, without advancing the
+   * object. The peeked hash values can be obtained through hashes().
+   * @return \p true on success and \p false otherwise
+   */
+  bool peek()
+  {
+    if (pos >= seq_len - k) {
+      return false;
+    }
+    if (!initialized) {
+      return init();
+    }
+    if (seq->is_n(pos + k)) {
+      return false;
+    }
+    const unsigned code_out = seq->code(pos), code_in = seq->code(pos + k);
+    hashing_internals::extend_hashes(next_fwd(fwd_hash, code_out, code_in),
+                                     next_rev(rev_hash, code_out, code_in),
+                                     k,
+                                     num_hashes,
+                                     hash_arr.get());
+    return true;
+  }
+
+  /**
+   * Like peek(), but as if roll_back() was called.
+   * @return \p true on success and \p false otherwise
+   */
+  bool peek_back()
+  {
+    if (pos == 0) {
+      return false;
+    }
+    if (!initialized) {
+      return init();
+    }
+    if (seq->is_n(pos - 1)) {
+      return false;
+    }
+    const unsigned code_out = seq->code(pos + k - 1);
+    const unsigned code_in = seq->code(pos - 1);
+    hashing_internals::extend_hashes(prev_fwd(fwd_hash, code_out, code_in),
+                                     prev_rev(rev_hash, code_out, code_in),
+                                     k,
+                                     num_hashes,
+                                     hash_arr.get());
+    return true;
+  }
+
+  /**
+   * Compute the hash values of the current k-mer with some of its bases
+   * substituted, without changing the current k-mer. Refer to
+   * \ref BasicNtHash::sub() for more information.
+   * @param positions Positions in the k-mer to substitute
+   * @param new_bases Characters placed at the positions
+   */
+  void sub(const std::vector<unsigned>& positions,
+           const std::vector<unsigned char>& new_bases)
+  {
+    uint64_t fwd = fwd_hash, rev = rev_hash;
+    for (size_t i = 0; i < positions.size(); i++) {
+      const unsigned char char_out = BASES[seq->code(pos + positions[i])];
+      if constexpr (MODE != NtHashMode::REVERSE) {
+        fwd ^= hashing_internals::sub_forward_delta(
+          char_out, new_bases[i], positions[i], k);
+      }
+      if constexpr (MODE != NtHashMode::FORWARD) {
+        rev ^= hashing_internals::sub_reverse_delta(
+          char_out, new_bases[i], positions[i]);
+      }
+    }
+    hashing_internals::extend_hashes(fwd, rev, k, num_hashes, hash_arr.get());
+  }
+
+  /**
+   * Get the array of current hash values (length = \p get_hash_num())
+   * @return Pointer to the hash array
+   */
+  const uint64_t* hashes() const { return hash_arr.get(); }
+
+  /**
+   * Get the position of last hashed k-mer or the k-mer to be hashed if roll()
+   * has never been called on this object.
+   * @return Position of the most recently hashed k-mer's first base-pair
+   */
+  size_t get_pos() const { return pos; }
+
+  /**
+   * Get the number of hashes generated per k-mer.
+   * @return Number of hashes per k-mer
+   */
+  hashing_internals::NUM_HASHES_TYPE get_hash_num() const { return num_hashes; }
+
+  /**
+   * Get the length of the k-mers.
+   * @return \p k
+   */
+  hashing_internals::K_TYPE get_k() const { return k; }
+
+  /**
+   * Get the hash value of the forward strand.
+   * @return Forward hash value, 0 in the REVERSE mode
+   */
+  uint64_t get_forward_hash() const { return fwd_hash; }
+
+  /**
+   * Get the hash value of the reverse strand.
+   * @return Reverse-complement hash value, 0 in the FORWARD mode
+   */
+  uint64_t get_reverse_hash() const { return rev_hash; }
+
+  /**
+   * Get the strands that are hashed.
+   * @return Hashing mode
+   */
+  static constexpr NtHashMode get_mode() { return MODE; }
+
+private:
+  // Bases in the order of their 2-bit codes in PackedSeq
+  static constexpr char BASES[4] = { 'A', 'C', 'T', 'G' };
+  // Seeds by 2-bit code. The complement of a code is the code XOR 2.
+  static constexpr uint64_t SEEDS[4] = { hashing_internals::SEED_A,
+                                         hashing_internals::SEED_C,
+                                         hashing_internals::SEED_T,
+                                         hashing_internals::SEED_G };
+
+  // Number of k-mers whose hash values roll_batch() extends at once
+  static const size_t BATCH_SIZE = 64;
+
+  const PackedSeq* seq = nullptr;
+  size_t seq_len = 0;
+  hashing_internals::NUM_HASHES_TYPE num_hashes;
+  hashing_internals::K_TYPE k;
+  size_t pos = 0;
+  bool initialized = false;
+  uint64_t fwd_hash = 0;
+  uint64_t rev_hash = 0;
+  // Seeds rotated by k, of the base leaving the forward strand and of the
+  // complement of the base entering the reverse strand
+  uint64_t fwd_out[4];
+  uint64_t rev_in[4];
+  std::unique_ptr<uint64_t[]> hash_arr;
+
+  uint64_t next_fwd(uint64_t h, unsigned code_out, unsigned code_in) const
+  {
+    if constexpr (MODE == NtHashMode::REVERSE) {
+      return 0;
+    }
+    return hashing_internals::srol(h) ^ SEEDS[code_in] ^ fwd_out[code_out];
+  }
+
+  uint64_t next_rev(uint64_t h, unsigned code_out, unsigned code_in) const
+  {
+    if constexpr (MODE == NtHashMode::FORWARD) {
+      return 0;
+    }
+    return hashing_internals::sror(h ^ rev_in[code_in] ^ SEEDS[code_out ^ 2]);
+  }
+
+  uint64_t prev_fwd(uint64_t h, unsigned code_out, unsigned code_in) const
+  {
+    if constexpr (MODE == NtHashMode::REVERSE) {
+      return 0;
+    }
+    return hashing_internals::sror(h ^ fwd_out[code_in] ^ SEEDS[code_out]);
+  }
+
+  uint64_t prev_rev(uint64_t h, unsigned code_out, unsigned code_in) const
+  {
+    if constexpr (MODE == NtHashMode::FORWARD) {
+      return 0;
+    }
+    return hashing_internals::srol(h) ^ SEEDS[code_in ^ 2] ^ rev_in[code_out];
+  }
+
+  /**
+   * Like roll(), but only update the forward and reverse hash values.
+   * @return \p true on success and \p false otherwise
+   */
+  bool roll_base()
+  {
+    if (!initialized) {
+      return init_base();
+    }
+    if (pos >= seq_len - k) {
+      return false;
+    }
+    if (seq->is_n(pos + k)) {
+      pos += k;
+      return init_base();
+    }
+    const unsigned code_out = seq->code(pos), code_in = seq->code(pos + k);
+    fwd_hash = next_fwd(fwd_hash, code_out, code_in);
+    rev_hash = next_rev(rev_hash, code_out, code_in);
+    ++pos;
+    return true;
+  }
+
+  /**
+   * Initialize the internal state of the iterator
+   * @return \p true if successful, \p false otherwise
+   */
+  bool init()
+  {
+    if (!init_base()) {
+      return false;
+    }
+    hashing_internals::extend_hashes(
+      fwd_hash, rev_hash, k, num_hashes, hash_arr.get());
+    return true;
+  }
+
+  /**
+   * Like init(), but only compute the forward and reverse hash values.
+   * @return \p true if successful, \p false otherwise
+   */
+  bool init_base()
+  {
+    bool has_n = true;
+    while (pos <= seq_len - k + 1 && has_n) {
+      has_n = false;
+      for (unsigned i = 0; i < k && pos <= seq_len - k + 1; i++) {
+        if (seq->is_n(pos + k - i - 1)) {
+          pos += k - i;
+          has_n = true;
+        }
+      }
+    }
+    if (pos > seq_len - k) {
+      return false;
+    }
+    fwd_hash = 0;
+    rev_hash = 0;
+    for (unsigned i = 0; i < k; i++) {
+      if constexpr (MODE != NtHashMode::REVERSE) {
+        fwd_hash =
+          hashing_internals::srol(fwd_hash) ^ SEEDS[seq->code(pos + i)];
+      }
+      if constexpr (MODE != NtHashMode::FORWARD) {
+        rev_hash = hashing_internals::srol(rev_hash) ^
+                   SEEDS[seq->code(pos + k - 1 - i) ^ 2];
+      }
+    }
+    initialized = true;
+    return true;
+  }
+};
+
+/** Canonical hashing of the k-mers of a packed sequence. */
+using PackedNtHash = BasicPackedNtHash<NtHashMode::CANONICAL>;
+
+} // namespace btllib
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <btllib/hashing_internals.hpp>
+#include <btllib/nthash_kmer.hpp>
+#include <btllib/status.hpp>
+
+namespace btllib {
+
+/** Default number of k-mer positions hashed by each parallel task. */
+const size_t PARALLEL_HASH_CHUNK_SIZE = size_t(1) << 20;
+
+/**
+ * Hash the k-mers of a long sequence using all OpenMP threads. The k-mer
+ * positions are split into chunks of \p chunk_size, and each chunk is hashed
+ * by its own NtHash over the chunk and the k - 1 characters that follow it.
+ * Every k-mer is therefore hashed exactly once, from all of its characters,
+ * and k-mers with invalid characters (e.g. N) are skipped exactly as a single
+ * NtHash over the whole sequence skips them, including at chunk boundaries.
+ * The k-mers and hash values are the same as those of a single NtHash, but
+ * the chunks are processed in no particular order.
+ * @param seq C-string containing sequence data
+ * @param seq_len Length of the sequence
+ * @param num_hashes Number of hashes to generate per k-mer
+ * @param k K-mer size
+ * @param f Function called as f(pos, hashes) for each k-mer, where pos is the
+ * position of the k-mer in seq. Called concurrently from multiple threads.
+ * @param chunk_size Number of k-mer positions hashed by each task
+ * @tparam MODE Strands to hash, canonical by default
+ */
+template<NtHashMode MODE = NtHashMode::CANONICAL, typename F>
+inline void
+hash_parallel(const char* seq,
+              size_t seq_len,
+              hashing_internals::NUM_HASHES_TYPE num_hashes,
+              hashing_internals::K_TYPE k,
+              F f,
+              size_t chunk_size = PARALLEL_HASH_CHUNK_SIZE)
+{
+  check_error(k == 0, "hash_parallel: k must be greater than 0.");
+  check_error(chunk_size == 0,
+              "hash_parallel: chunk size must be greater than 0.");
+  if (seq_len < k) {
+    return;
+  }
+  const size_t kmers = seq_len - k + 1;
+  const size_t chunks = (kmers + chunk_size - 1) / chunk_size;
+#pragma omp parallel for schedule(dynamic)
+  for (size_t chunk = 0; chunk < chunks; chunk++) {
+    const size_t start = chunk * chunk_size;
+    const size_t end = std::min(start + chunk_size, kmers);
+    BasicNtHash<MODE> nthash(seq + start, end - start + k - 1, num_hashes, k);
+    while (nthash.roll()) {
+      f(start + nthash.get_pos(), nthash.hashes());
+    }
+  }
+}
+
+/**
+ * Hash the k-mers of a long sequence using all OpenMP threads. See
+ * hash_parallel().
+ * @param seq Sequence string
+ * @param num_hashes Number of hashes to generate per k-mer
+ * @param k K-mer size
+ * @param f Function called as f(pos, hashes) for each k-mer. Called
+ * concurrently from multiple threads.
+ * @param chunk_size Number of k-mer positions hashed by each task
+ * @tparam MODE Strands to hash, canonical by default
+ */
+template<NtHashMode MODE = NtHashMode::CANONICAL, typename F>
+inline void
+hash_parallel(const std::string& seq,
+              hashing_internals::NUM_HASHES_TYPE num_hashes,
+              hashing_internals::K_TYPE k,
+              F f,
+              size_t chunk_size = PARALLEL_HASH_CHUNK_SIZE)
+{
+  hash_parallel<MODE>(seq.data(), seq.size(), num_hashes, k, f, chunk_size);
+}
+
+/**
+ * Hash all k-mers of a long sequence using all OpenMP threads and store them
+ * in order. The output is the same as that of NtHash::hash_all() on a new
+ * NtHash over the sequence.
+ * @param seq C-string containing sequence data
+ * @param seq_len Length of the sequence
+ * @param num_hashes Number of hashes to generate per k-mer
+ * @param k K-mer size
+ * @param hashes Output array with room for the hash values of seq_len - k + 1
+ * k-mers, \p stride apart
+ * @param stride Distance between the hash values of consecutive k-mers, at
+ * least \p num_hashes
+ * @param positions Optional output array for the positions of the k-mers, with
+ * room for seq_len - k + 1 positions
+ * @param chunk_size Number of k-mer positions hashed by each task
+ * @tparam MODE Strands to hash, canonical by default
+ * @return Number of hashed k-mers
+ */
+template<NtHashMode MODE = NtHashMode::CANONICAL>
+inline size_t
+hash_all_parallel(const char* seq,
+                  size_t seq_len,
+                  hashing_internals::NUM_HASHES_TYPE num_hashes,
+                  hashing_internals::K_TYPE k,
+                  uint64_t* hashes,
+                  size_t stride,
+                  size_t* positions = nullptr,
+                  size_t chunk_size = PARALLEL_HASH_CHUNK_SIZE)
+{
+  check_error(k == 0, "hash_all_parallel: k must be greater than 0.");
+  check_error(chunk_size == 0,
+              "hash_all_parallel: chunk size must be greater than 0.");
+  check_error(stride < num_hashes,
+              "hash_all_parallel: stride must be at least the number of "
+              "hashes.");
+  if (seq_len < k) {
+    return 0;
+  }
+  const size_t kmers = seq_len - k + 1;
+  const size_t chunks = (kmers + chunk_size - 1) / chunk_size;
+  // Each chunk is hashed into the part of the output starting at its first
+  // position, and the chunks are then moved next to each other
+  std::vector<size_t> counts(chunks);
+#pragma omp parallel for schedule(dynamic)
+  for (size_t chunk = 0; chunk < chunks; chunk++) {
+    const size_t start = chunk * chunk_size;
+    const size_t end = std::min(start + chunk_size, kmers);
+    BasicNtHash<MODE> nthash(seq + start, end - start + k - 1, num_hashes, k);
+    size_t* const chunk_positions =
+      positions == nullptr ? nullptr : positions + start;
+    counts[chunk] =
+      nthash.hash_all(hashes + start * stride, stride, chunk_positions);
+    for (size_t i = 0; chunk_positions != nullptr && i < counts[chunk]; i++) {
+      chunk_positions[i] += start;
+    }
+  }
+  size_t total = 0;
+  for (size_t chunk = 0; chunk < chunks; chunk++) {
+    const size_t start = chunk * chunk_size;
+    if (total != start && counts[chunk] > 0) {
+      std::memmove(hashes + total * stride,
+                   hashes + start * stride,
+                   counts[chunk] * stride * sizeof(uint64_t));
+      if (positions != nullptr) {
+        std::memmove(positions + total,
+                     positions + start,
+                     counts[chunk] * sizeof(size_t));
+      }
+    }
+    total += counts[chunk];
+  }
+  return total;
+}
+
+} // namespace btllib
@@ -77,6 +77,10 @@ parsed_seeds_to_blocks(const std::vector<std::vector<unsigned>>& seeds,
   for (const auto& seed : seeds) {
     std::string seed_string(k, '1');
     for (const auto& i : seed) {
+      btllib::check_error(i >= k,
+                          "SeedNtHash: Spaced seed don't care position (" +
+                            std::to_string(i) + ") not less than k=" +
+                            std::to_string(k));
       seed_string[i] = '0';
     }
     seed_strings.push_back(seed_string);
@@ -476,6 +480,348 @@ ntmsm64l(const char* kmer_seq,
     , fh_seed = sror(fh_seed);)
 }
 
+/**
+ * Strand codes of each character used by the SIMD spaced seed kernels: the
+ * forward code in the low byte and the code of the complement (c & CP_OFF) in
+ * the second byte. A, C, G and T are 0 to 3, and every other character is 4,
+ * which contributes nothing to the hashes, like SEED_N.
+ */
+constexpr std::array<uint16_t, ASCII_SIZE> SEED_CODE_TAB = []() {
+  const auto code = [](const uint64_t seed) -> uint16_t {
+    if (seed == SEED_A) {
+      return 0;
+    }
+    if (seed == SEED_C) {
+      return 1;
+    }
+    if (seed == SEED_G) {
+      return 2;
+    }
+    if (seed == SEED_T) {
+      return 3;
+    }
+    return 4;
+  };
+  std::array<uint16_t, ASCII_SIZE> table{};
+  for (unsigned c = 0; c < ASCII_SIZE; c++) {
+    table[c] = code(SEED_TAB[c]) | (code(SEED_TAB[c & CP_OFF]) << 8);
+  }
+  return table;
+}();
+
+/// @cond HIDDEN_SYMBOLS
+const unsigned SEED_CODES = 8;
+const unsigned SEED_SIMD_LANES = 8;
+/// @endcond
+
+/**
+ * Spaced seeds laid out for the SIMD kernels, which roll groups of 8 seeds in
+ * the lanes of a vector. Rolling a seed XORs a rotated seed value for each
+ * block boundary and size-one block into its hashes, and the rotations only
+ * depend on the position in the window of k + 1 characters (the previous
+ * k-mer and the incoming character). The seeds are therefore stored as one
+ * bit mask per group and window position, telling which seeds use that
+ * position.
+ */
+struct SeedRollMasks
+{
+  /** Number of groups of SEED_SIMD_LANES seeds. */
+  unsigned groups = 0;
+  /**
+   * Bit i of entry g * (k + 1) + p is set if seed g * 8 + i has an odd number
+   * of block boundaries at window position p.
+   */
+  std::vector<uint8_t> block_masks;
+  /** Same as block_masks, for the size-one blocks at position p - 1. */
+  std::vector<uint8_t> monomer_masks;
+  /** srol_table() of each strand code for rotations 0 to k. */
+  std::vector<uint64_t> table;
+};
+
+inline SeedRollMasks
+make_seed_roll_masks(const std::vector<SpacedSeedBlocks>& seeds_blocks,
+                     const std::vector<SpacedSeedMonomers>& seeds_monomers,
+                     unsigned k)
+{
+  SeedRollMasks masks;
+  const unsigned m = seeds_blocks.size();
+  masks.groups = (m + SEED_SIMD_LANES - 1) / SEED_SIMD_LANES;
+  masks.block_masks.assign(size_t(masks.groups) * (k + 1), 0);
+  masks.monomer_masks.assign(size_t(masks.groups) * (k + 1), 0);
+  for (unsigned i_seed = 0; i_seed < m; i_seed++) {
+    const size_t row = size_t(i_seed / SEED_SIMD_LANES) * (k + 1);
+    const auto bit = uint8_t(1U << (i_seed % SEED_SIMD_LANES));
+    for (const auto& block : seeds_blocks[i_seed]) {
+      masks.block_masks[row + block[0]] ^= bit;
+      masks.block_masks[row + block[1]] ^= bit;
+    }
+    for (const unsigned pos : seeds_monomers[i_seed]) {
+      masks.monomer_masks[row + pos + 1] ^= bit;
+    }
+  }
+  const unsigned char representatives[] = { 'A', 'C', 'G', 'T' };
+  masks.table.assign(size_t(k + 1) * SEED_CODES, 0);
+  for (unsigned d = 0; d <= k; d++) {
+    for (unsigned code = 0; code < 4; code++) {
+      masks.table[d * SEED_CODES + code] = srol_table(representatives[code], d);
+    }
+  }
+  return masks;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(SWIG)
+/// @cond HIDDEN_SYMBOLS
+// For each window position, the kernels look up the rotated seed values of
+// the character once and XOR them into the lanes of the seeds that use the
+// position. The reverse values of size-one blocks are rotated once, after
+// they are combined.
+__attribute__((target("avx512f"))) inline __m512i
+srol_avx512(const __m512i x)
+{
+  const __m512i m = _mm512_or_si512(
+    _mm512_maskz_srli_epi64(
+      __mmask8(0xFF),
+      _mm512_and_si512(x, _mm512_set1_epi64(int64_t(0x8000000000000000ULL))),
+      30),
+    _mm512_maskz_srli_epi64(
+      __mmask8(0xFF), _mm512_and_si512(x, _mm512_set1_epi64(0x100000000)), 32));
+  return _mm512_or_si512(
+    _mm512_and_si512(_mm512_maskz_slli_epi64(__mmask8(0xFF), x, 1),
+                     _mm512_set1_epi64(int64_t(0xFFFFFFFDFFFFFFFFULL))),
+    m);
+}
+
+__attribute__((target("avx512f"))) inline __m512i
+sror_avx512(const __m512i x)
+{
+  const __m512i m = _mm512_or_si512(
+    _mm512_maskz_slli_epi64(
+      __mmask8(0xFF), _mm512_and_si512(x, _mm512_set1_epi64(0x200000000)), 30),
+    _mm512_maskz_slli_epi64(
+      __mmask8(0xFF), _mm512_and_si512(x, _mm512_set1_epi64(1)), 32));
+  return _mm512_or_si512(
+    _mm512_and_si512(_mm512_maskz_srli_epi64(__mmask8(0xFF), x, 1),
+                     _mm512_set1_epi64(int64_t(0xFFFFFFFEFFFFFFFFULL))),
+    m);
+}
+
+__attribute__((target("avx512f"))) inline void
+ntmsm64_avx512(const char* kmer_seq,
+               const SeedRollMasks& masks,
+               unsigned k,
+               unsigned m,
+               uint64_t* fh_nomonos,
+               uint64_t* rh_nomonos,
+               uint64_t* fh_val,
+               uint64_t* rh_val)
+{
+  const uint64_t* const table = masks.table.data();
+  for (unsigned g = 0; g < masks.groups; g++) {
+    const uint8_t* const block_masks = masks.block_masks.data() + g * (k + 1);
+    const uint8_t* const monomer_masks =
+      masks.monomer_masks.data() + g * (k + 1);
+    __m512i fh_blocks = _mm512_setzero_si512();
+    __m512i rh_blocks = _mm512_setzero_si512();
+    __m512i fh_monos = _mm512_setzero_si512();
+    __m512i rh_monos = _mm512_setzero_si512();
+    for (unsigned p = 0; p <= k; p++) {
+      const uint16_t code = SEED_CODE_TAB[(unsigned char)kmer_seq[p]];
+      const __m512i fwd =
+        _mm512_set1_epi64(int64_t(table[(k - p) * SEED_CODES + (code & 0xFF)]));
+      const __m512i rev =
+        _mm512_set1_epi64(int64_t(table[p * SEED_CODES + (code >> 8)]));
+      const __mmask8 block_mask = block_masks[p];
+      const __mmask8 monomer_mask = monomer_masks[p];
+      fh_blocks = _mm512_mask_xor_epi64(fh_blocks, block_mask, fh_blocks, fwd);
+      rh_blocks = _mm512_mask_xor_epi64(rh_blocks, block_mask, rh_blocks, rev);
+      fh_monos = _mm512_mask_xor_epi64(fh_monos, monomer_mask, fh_monos, fwd);
+      rh_monos = _mm512_mask_xor_epi64(rh_monos, monomer_mask, rh_monos, rev);
+    }
+    const unsigned s = g * SEED_SIMD_LANES;
+    const unsigned left = m - s;
+    const __mmask8 mask =
+      left >= SEED_SIMD_LANES ? 0xFF : (1U << left) - 1;
+    __m512i fh = _mm512_xor_si512(
+      srol_avx512(_mm512_maskz_loadu_epi64(mask, fh_nomonos + s)), fh_blocks);
+    __m512i rh = sror_avx512(_mm512_xor_si512(
+      _mm512_maskz_loadu_epi64(mask, rh_nomonos + s), rh_blocks));
+    _mm512_mask_storeu_epi64(fh_nomonos + s, mask, fh);
+    _mm512_mask_storeu_epi64(rh_nomonos + s, mask, rh);
+    fh = _mm512_xor_si512(fh, fh_monos);
+    rh = _mm512_xor_si512(rh, sror_avx512(rh_monos));
+    _mm512_mask_storeu_epi64(fh_val + s, mask, fh);
+    _mm512_mask_storeu_epi64(rh_val + s, mask, rh);
+  }
+}
+
+__attribute__((target("avx2"))) inline __m256i
+srol_avx2(const __m256i x)
+{
+  const __m256i m = _mm256_or_si256(
+    _mm256_srli_epi64(
+      _mm256_and_si256(x, _mm256_set1_epi64x(int64_t(0x8000000000000000ULL))),
+      30),
+    _mm256_srli_epi64(_mm256_and_si256(x, _mm256_set1_epi64x(0x100000000)),
+                      32));
+  return _mm256_or_si256(
+    _mm256_and_si256(_mm256_slli_epi64(x, 1),
+                     _mm256_set1_epi64x(int64_t(0xFFFFFFFDFFFFFFFFULL))),
+    m);
+}
+
+__attribute__((target("avx2"))) inline __m256i
+sror_avx2(const __m256i x)
+{
+  const __m256i m = _mm256_or_si256(
+    _mm256_slli_epi64(_mm256_and_si256(x, _mm256_set1_epi64x(0x200000000)),
+                      30),
+    _mm256_slli_epi64(_mm256_and_si256(x, _mm256_set1_epi64x(1)), 32));
+  return _mm256_or_si256(
+    _mm256_and_si256(_mm256_srli_epi64(x, 1),
+                     _mm256_set1_epi64x(int64_t(0xFFFFFFFEFFFFFFFFULL))),
+    m);
+}
+
+// Expand the bits of a seed mask selected by bits into all-ones lanes
+__attribute__((target("avx2"))) inline __m256i
+expand_mask_avx2(const uint8_t mask, const __m256i bits)
+{
+  return _mm256_cmpeq_epi64(
+    _mm256_and_si256(_mm256_set1_epi64x(mask), bits), bits);
+}
+
+__attribute__((target("avx2"))) inline void
+ntmsm64_avx2(const char* kmer_seq,
+             const SeedRollMasks& masks,
+             unsigned k,
+             unsigned m,
+             uint64_t* fh_nomonos,
+             uint64_t* rh_nomonos,
+             uint64_t* fh_val,
+             uint64_t* rh_val)
+{
+  const unsigned lanes = 4;
+  const __m256i index = _mm256_set_epi64x(3, 2, 1, 0);
+  const uint64_t* const table = masks.table.data();
+  for (unsigned s = 0; s < m; s += lanes) {
+    const unsigned g = s / SEED_SIMD_LANES;
+    const uint8_t* const block_masks = masks.block_masks.data() + g * (k + 1);
+    const uint8_t* const monomer_masks =
+      masks.monomer_masks.data() + g * (k + 1);
+    const __m256i bits = _mm256_sllv_epi64(
+      _mm256_set1_epi64x(1),
+      _mm256_add_epi64(index, _mm256_set1_epi64x(s % SEED_SIMD_LANES)));
+    __m256i fh_blocks = _mm256_setzero_si256();
+    __m256i rh_blocks = _mm256_setzero_si256();
+    __m256i fh_monos = _mm256_setzero_si256();
+    __m256i rh_monos = _mm256_setzero_si256();
+    for (unsigned p = 0; p <= k; p++) {
+      const uint16_t code = SEED_CODE_TAB[(unsigned char)kmer_seq[p]];
+      const __m256i fwd = _mm256_set1_epi64x(
+        int64_t(table[(k - p) * SEED_CODES + (code & 0xFF)]));
+      const __m256i rev =
+        _mm256_set1_epi64x(int64_t(table[p * SEED_CODES + (code >> 8)]));
+      const __m256i block_mask = expand_mask_avx2(block_masks[p], bits);
+      const __m256i monomer_mask = expand_mask_avx2(monomer_masks[p], bits);
+      fh_blocks =
+        _mm256_xor_si256(fh_blocks, _mm256_and_si256(block_mask, fwd));
+      rh_blocks =
+        _mm256_xor_si256(rh_blocks, _mm256_and_si256(block_mask, rev));
+      fh_monos =
+        _mm256_xor_si256(fh_monos, _mm256_and_si256(monomer_mask, fwd));
+      rh_monos =
+        _mm256_xor_si256(rh_monos, _mm256_and_si256(monomer_mask, rev));
+    }
+    const __m256i mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(m - s), index);
+    auto* const fh_nomonos_s =
+      reinterpret_cast<long long*>(fh_nomonos + s); // NOLINT
+    auto* const rh_nomonos_s =
+      reinterpret_cast<long long*>(rh_nomonos + s); // NOLINT
+    __m256i fh = _mm256_xor_si256(
+      srol_avx2(_mm256_maskload_epi64(fh_nomonos_s, mask)), fh_blocks);
+    __m256i rh = sror_avx2(
+      _mm256_xor_si256(_mm256_maskload_epi64(rh_nomonos_s, mask), rh_blocks));
+    _mm256_maskstore_epi64(fh_nomonos_s, mask, fh);
+    _mm256_maskstore_epi64(rh_nomonos_s, mask, rh);
+    fh = _mm256_xor_si256(fh, fh_monos);
+    rh = _mm256_xor_si256(rh, sror_avx2(rh_monos));
+    _mm256_maskstore_epi64(
+      reinterpret_cast<long long*>(fh_val + s), mask, fh); // NOLINT
+    _mm256_maskstore_epi64(
+      reinterpret_cast<long long*>(rh_val + s), mask, rh); // NOLINT
+  }
+}
+/// @endcond
+#endif
+
+/**
+ * Smallest number of seeds for which SeedNtHash rolls with the SIMD kernels.
+ */
+const unsigned SEED_SIMD_MIN_SEEDS = 4;
+
+/**
+ * Get the instruction set SeedNtHash uses to roll the given number of seeds.
+ * @param m Number of spaced seeds.
+ * @return Instruction set used by ntmsm64_simd()
+ */
+inline SimdLevel
+get_seed_simd_level(unsigned m)
+{
+  return m >= SEED_SIMD_MIN_SEEDS ? get_simd_level() : SimdLevel::SCALAR;
+}
+
+/**
+ * Same as the forward rolling ntmsm64(), but rolls groups of seeds at once
+ * with SIMD instructions.
+ *
+ * @param kmer_seq Array of characters representing the previous k-mer.
+ * @param masks Seeds laid out by make_seed_roll_masks().
+ * @param k k-mer size.
+ * @param m Number of spaced seeds.
+ * @param m2 Number of hashes per seed.
+ * @param fh_nomonos Previous forward hash values before including the size-one
+ * blocks.
+ * @param rh_nomonos Previous reverse hash values before including the size-one
+ * blocks.
+ * @param fh_val Container for the forward hash values after including the
+ * size-one blocks.
+ * @param rh_val Container for the reverse hash values after including the
+ * size-one blocks.
+ * @param h_val Array of size m * m2 for storing the output hash values.
+ * @param level Instruction set to use, AVX2 or AVX512.
+ */
+inline void
+ntmsm64_simd(const char* kmer_seq,
+             const SeedRollMasks& masks,
+             unsigned k,
+             unsigned m,
+             unsigned m2,
+             uint64_t* fh_nomonos,
+             uint64_t* rh_nomonos,
+             uint64_t* fh_val,
+             uint64_t* rh_val,
+             uint64_t* h_val,
+             SimdLevel level)
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+  if (level == SimdLevel::AVX512) {
+    ntmsm64_avx512(
+      kmer_seq, masks, k, m, fh_nomonos, rh_nomonos, fh_val, rh_val);
+  } else {
+    ntmsm64_avx2(kmer_seq, masks, k, m, fh_nomonos, rh_nomonos, fh_val, rh_val);
+  }
+#else
+  (void)kmer_seq;
+  (void)masks;
+  (void)fh_nomonos;
+  (void)rh_nomonos;
+  (void)level;
+#endif
+  for (unsigned i_seed = 0; i_seed < m; i_seed++) {
+    extend_hashes(fh_val[i_seed], rh_val[i_seed], k, m2, h_val + i_seed * m2);
+  }
+}
+
 } // namespace btllib::hashing_internals
 
 namespace btllib {
@@ -510,6 +856,95 @@ parse_seeds(const std::vector<std::string>& seed_strings)
   return seed_set;
 }
 
+/**
+ * Spaced seed patterns parsed into the blocks that SeedNtHash hashes. The
+ * seeds are parsed once on construction, and the object can be shared by any
+ * number of SeedNtHash objects, e.g. one per worker thread.
+ */
+class ParsedSeeds
+{
+
+public:
+  /**
+   * Parse spaced seeds.
+   * @param seeds Vector of spaced seed patterns as strings (1s as cares, 0s
+   * as don't cares, must be of size \p k)
+   * @param k K-mer size
+   */
+  ParsedSeeds(const std::vector<std::string>& seeds,
+              hashing_internals::K_TYPE k)
+    : k(k)
+  {
+    check_error(seeds.empty(), "SeedNtHash: no spaced seeds passed");
+    check_seeds(seeds, k);
+    hashing_internals::get_blocks(seeds, blocks, monomers);
+    roll_masks = hashing_internals::make_seed_roll_masks(blocks, monomers, k);
+  }
+
+  /**
+   * Parse spaced seeds.
+   * @param seeds Vector of parsed spaced seed patterns (vectors of don't care
+   * positions)
+   * @param k K-mer size
+   */
+  ParsedSeeds(const std::vector<std::vector<unsigned>>& seeds,
+              hashing_internals::K_TYPE k)
+    : k(k)
+  {
+    check_error(seeds.empty(), "SeedNtHash: no spaced seeds passed");
+    parsed_seeds_to_blocks(seeds, k, blocks, monomers);
+    roll_masks = hashing_internals::make_seed_roll_masks(blocks, monomers, k);
+  }
+
+  /**
+   * Get the number of seeds.
+   * @return Number of seeds
+   */
+  size_t size() const { return blocks.size(); }
+
+  /**
+   * Get the length of the seeds.
+   * @return \p k
+   */
+  hashing_internals::K_TYPE get_k() const { return k; }
+
+  /**
+   * Get the blocks of care or don't care positions of each seed.
+   * @return Blocks of each seed
+   */
+  const std::vector<hashing_internals::SpacedSeedBlocks>& get_seed_blocks()
+    const
+  {
+    return blocks;
+  }
+
+  /**
+   * Get the positions of size-one blocks of each seed.
+   * @return Monomers of each seed
+   */
+  const std::vector<hashing_internals::SpacedSeedMonomers>& get_seed_monomers()
+    const
+  {
+    return monomers;
+  }
+
+  /**
+   * Get the seeds laid out for rolling groups of seeds at once with SIMD
+   * instructions.
+   * @return Roll masks of the seeds
+   */
+  const hashing_internals::SeedRollMasks& get_roll_masks() const
+  {
+    return roll_masks;
+  }
+
+private:
+  hashing_internals::K_TYPE k;
+  std::vector<hashing_internals::SpacedSeedBlocks> blocks;
+  std::vector<hashing_internals::SpacedSeedMonomers> monomers;
+  hashing_internals::SeedRollMasks roll_masks;
+};
+
 /**
  * Spaced seed hashing.
  */
@@ -533,22 +968,12 @@ public:
              hashing_internals::NUM_HASHES_TYPE num_hashes_per_seed,
              hashing_internals::K_TYPE k,
              size_t pos = 0)
-    : seq(seq)
-    , seq_len(seq_len)
-    , num_hashes_per_seed(num_hashes_per_seed)
-    , k(k)
-    , pos(pos)
-    , initialized(false)
-    , fwd_hash_nomonos(new uint64_t[seeds.size()])
-    , rev_hash_nomonos(new uint64_t[seeds.size()])
-    , fwd_hash(new uint64_t[seeds.size()])
-    , rev_hash(new uint64_t[seeds.size()])
-    , hash_arr(new uint64_t[num_hashes_per_seed * seeds.size()])
+    : SeedNtHash(seq,
+                 seq_len,
+                 std::make_shared<const ParsedSeeds>(seeds, k),
+                 num_hashes_per_seed,
+                 pos)
   {
-    check_seeds(seeds, k);
-    check_error(seeds[0].size() != k,
-                "SeedNtHash: k should be equal to seed string lengths");
-    get_blocks(seeds, blocks, monomers);
   }
 
   /**
@@ -585,19 +1010,12 @@ public:
              hashing_internals::NUM_HASHES_TYPE num_hashes_per_seed,
              hashing_internals::K_TYPE k,
              size_t pos = 0)
-    : seq(seq)
-    , seq_len(seq_len)
-    , num_hashes_per_seed(num_hashes_per_seed)
-    , k(k)
-    , pos(pos)
-    , initialized(false)
-    , fwd_hash_nomonos(new uint64_t[seeds.size()])
-    , rev_hash_nomonos(new uint64_t[seeds.size()])
-    , fwd_hash(new uint64_t[seeds.size()])
-    , rev_hash(new uint64_t[seeds.size()])
-    , hash_arr(new uint64_t[num_hashes_per_seed * seeds.size()])
+    : SeedNtHash(seq,
+                 seq_len,
+                 std::make_shared<const ParsedSeeds>(seeds, k),
+                 num_hashes_per_seed,
+                 pos)
   {
-    parsed_seeds_to_blocks(seeds, k, blocks, monomers);
   }
 
   /**
@@ -618,6 +1036,56 @@ public:
   {
   }
 
+  /**
+   * Construct an ntHash object for spaced seeds that were parsed beforehand.
+   * @param seq C-string of the sequence to be hashed
+   * @param seq_len Length of the sequence
+   * @param seeds Parsed spaced seeds, shared with other objects
+   * @param num_hashes_per_seed Number of hashes to generate per seed
+   * @param pos Position in seq to start hashing from
+   */
+  SeedNtHash(const char* seq,
+             size_t seq_len,
+             std::shared_ptr<const ParsedSeeds> seeds,
+             hashing_internals::NUM_HASHES_TYPE num_hashes_per_seed,
+             size_t pos = 0)
+    : seq(seq)
+    , seq_len(seq_len)
+    , num_hashes_per_seed(num_hashes_per_seed)
+    , k(seeds->get_k())
+    , pos(pos)
+    , initialized(false)
+    , parsed_seeds(std::move(seeds))
+    , blocks(parsed_seeds->get_seed_blocks())
+    , monomers(parsed_seeds->get_seed_monomers())
+    , fwd_hash_nomonos(new uint64_t[blocks.size()])
+    , rev_hash_nomonos(new uint64_t[blocks.size()])
+    , fwd_hash(new uint64_t[blocks.size()])
+    , rev_hash(new uint64_t[blocks.size()])
+    , hash_arr(new uint64_t[num_hashes_per_seed * blocks.size()])
+    , simd_level(hashing_internals::get_seed_simd_level(blocks.size()))
+  {
+  }
+
+  /**
+   * Construct an ntHash object for spaced seeds that were parsed beforehand.
+   * @param seq String of the sequence to be hashed
+   * @param seeds Parsed spaced seeds, shared with other objects
+   * @param num_hashes_per_seed Number of hashes to generate per seed
+   * @param pos Position in seq to start hashing from
+   */
+  SeedNtHash(const std::string& seq,
+             std::shared_ptr<const ParsedSeeds> seeds,
+             hashing_internals::NUM_HASHES_TYPE num_hashes_per_seed,
+             size_t pos = 0)
+    : SeedNtHash(seq.data(),
+                 seq.size(),
+                 std::move(seeds),
+                 num_hashes_per_seed,
+                 pos)
+  {
+  }
+
   SeedNtHash(const SeedNtHash& obj)
     : seq(obj.seq)
     , seq_len(obj.seq_len)
@@ -625,13 +1093,15 @@ public:
     , k(obj.k)
     , pos(obj.pos)
     , initialized(obj.initialized)
-    , blocks(obj.blocks)
-    , monomers(obj.monomers)
+    , parsed_seeds(obj.parsed_seeds)
+    , blocks(parsed_seeds->get_seed_blocks())
+    , monomers(parsed_seeds->get_seed_monomers())
     , fwd_hash_nomonos(new uint64_t[obj.blocks.size()])
     , rev_hash_nomonos(new uint64_t[obj.blocks.size()])
     , fwd_hash(new uint64_t[obj.blocks.size()])
     , rev_hash(new uint64_t[obj.blocks.size()])
     , hash_arr(new uint64_t[obj.num_hashes_per_seed * obj.blocks.size()])
+    , simd_level(obj.simd_level)
   {
     std::memcpy(fwd_hash_nomonos.get(),
                 obj.fwd_hash_nomonos.get(),
@@ -650,6 +1120,39 @@ public:
 
   SeedNtHash(SeedNtHash&&) = default;
 
+  /**
+   * Start hashing a new sequence, reusing the seeds and buffers of this
+   * object. Refer to \ref NtHash::reset() for more information.
+   * @param seq C-string of the sequence to be hashed
+   * @param seq_len Length of the sequence
+   * @param pos Position in seq to start hashing from
+   */
+  void reset(const char* seq, size_t seq_len, size_t pos = 0)
+  {
+    check_error(seq_len < k,
+                "SeedNtHash: sequence length (" + std::to_string(seq_len) +
+                  ") is smaller than k (" + std::to_string(k) + ")");
+    check_error(pos > seq_len - k,
+                "SeedNtHash: passed position (" + std::to_string(pos) +
+                  ") is larger than sequence length (" +
+                  std::to_string(seq_len) + ")");
+    this->seq = seq;
+    this->seq_len = seq_len;
+    this->pos = pos;
+    initialized = false;
+  }
+
+  /**
+   * Start hashing a new sequence, reusing the seeds and buffers of this
+   * object.
+   * @param seq String of the sequence to be hashed
+   * @param pos Position in seq to start hashing from
+   */
+  void reset(const std::string& seq, size_t pos = 0)
+  {
+    reset(seq.data(), seq.size(), pos);
+  }
+
   /**
    * Calculate the next hash value. Refer to \ref NtHash::roll() for more
    * information.
@@ -667,17 +1170,31 @@ public:
       pos += k;
       return init();
     }
-    ntmsm64(seq + pos,
-            blocks,
-            monomers,
-            k,
-            blocks.size(),
-            num_hashes_per_seed,
-            fwd_hash_nomonos.get(),
-            rev_hash_nomonos.get(),
-            fwd_hash.get(),
-            rev_hash.get(),
-            hash_arr.get());
+    if (simd_level != hashing_internals::SimdLevel::SCALAR) {
+      hashing_internals::ntmsm64_simd(seq + pos,
+                                      parsed_seeds->get_roll_masks(),
+                                      k,
+                                      blocks.size(),
+                                      num_hashes_per_seed,
+                                      fwd_hash_nomonos.get(),
+                                      rev_hash_nomonos.get(),
+                                      fwd_hash.get(),
+                                      rev_hash.get(),
+                                      hash_arr.get(),
+                                      simd_level);
+    } else {
+      ntmsm64(seq + pos,
+              blocks,
+              monomers,
+              k,
+              blocks.size(),
+              num_hashes_per_seed,
+              fwd_hash_nomonos.get(),
+              rev_hash_nomonos.get(),
+              fwd_hash.get(),
+              rev_hash.get(),
+              hash_arr.get());
+    }
     ++pos;
     return true;
   }
@@ -869,18 +1386,20 @@ public:
 
 private:
   const char* seq;
-  const size_t seq_len;
+  size_t seq_len;
   hashing_internals::NUM_HASHES_TYPE num_hashes_per_seed;
   hashing_internals::K_TYPE k;
   size_t pos;
   bool initialized;
-  std::vector<hashing_internals::SpacedSeedBlocks> blocks;
-  std::vector<hashing_internals::SpacedSeedMonomers> monomers;
+  std::shared_ptr<const ParsedSeeds> parsed_seeds;
+  const std::vector<hashing_internals::SpacedSeedBlocks>& blocks;
+  const std::vector<hashing_internals::SpacedSeedMonomers>& monomers;
   std::unique_ptr<uint64_t[]> fwd_hash_nomonos;
   std::unique_ptr<uint64_t[]> rev_hash_nomonos;
   std::unique_ptr<uint64_t[]> fwd_hash;
   std::unique_ptr<uint64_t[]> rev_hash;
   std::unique_ptr<uint64_t[]> hash_arr;
+  hashing_internals::SimdLevel simd_level;
 
   /**
    * Initialize the internal state of the iterator
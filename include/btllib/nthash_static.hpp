@@ -0,0 +1,284 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <btllib/hashing_internals.hpp>
+#include <btllib/nthash_kmer.hpp>
+#include <btllib/status.hpp>
+
+namespace btllib::hashing_internals {
+
+/**
+ * Rolling terms and extension multipliers of StaticNtHash, computed at
+ * compile time for a fixed k and number of hashes.
+ */
+template<unsigned K, unsigned H>
+struct StaticNtHashTables
+{
+  /** Term removed from the forward hash for each outgoing character. */
+  static constexpr std::array<uint64_t, ASCII_SIZE> FWD_OUT = []() {
+    std::array<uint64_t, ASCII_SIZE> table{};
+    for (unsigned c = 0; c < ASCII_SIZE; c++) {
+      uint64_t x = SEED_TAB[c];
+      for (unsigned i = 0; i < K; i++) {
+        x = srol(x);
+      }
+      table[c] = x;
+    }
+    return table;
+  }();
+
+  /** Term added to the reverse hash for each incoming character. */
+  static constexpr std::array<uint64_t, ASCII_SIZE> REV_IN = []() {
+    std::array<uint64_t, ASCII_SIZE> table{};
+    for (unsigned c = 0; c < ASCII_SIZE; c++) {
+      uint64_t x = SEED_TAB[c & CP_OFF];
+      for (unsigned i = 0; i < K; i++) {
+        x = srol(x);
+      }
+      table[c] = x;
+    }
+    return table;
+  }();
+
+  /** Multipliers used by extend_hashes() for each extra hash. */
+  static constexpr std::array<uint64_t, H> MULTIPLIERS = []() {
+    std::array<uint64_t, H> multipliers{};
+    for (unsigned i = 0; i < H; i++) {
+      multipliers[i] = i ^ K * MULTISEED;
+    }
+    return multipliers;
+  }();
+};
+
+} // namespace btllib::hashing_internals
+
+namespace btllib {
+
+/**
+ * Like NtHash, but with k and the number of hashes fixed at compile time. The
+ * hash values are stored inline, so construction does not allocate, and the
+ * rolling terms, extension multipliers and loop bounds are constants the
+ * compiler can specialize for. Produces the same k-mers and hash values as
+ * NtHash. Use dispatch_k() to pick the specialization for a runtime k.
+ * @tparam K K-mer size
+ * @tparam H Number of hashes per k-mer
+ * @tparam MODE Strands to hash, as in NtHash
+ */
+template<unsigned K, unsigned H, NtHashMode MODE = NtHashMode::CANONICAL>
+class StaticNtHash
+{
+  static_assert(K > 0, "StaticNtHash: K must be greater than 0.");
+  static_assert(H > 0, "StaticNtHash: H must be greater than 0.");
+
+  using Tables = hashing_internals::StaticNtHashTables<K, H>;
+
+public:
+  /**
+   * Construct an ntHash object for k-mers.
+   * @param seq C-string containing sequence data
+   * @param seq_len Length of the sequence
+   * @param pos Position in the sequence to start hashing from
+   */
+  StaticNtHash(const char* seq, size_t seq_len, size_t pos = 0)
+    : seq(seq)
+    , seq_len(seq_len)
+    , pos(pos)
+  {
+    check_error(seq_len < K,
+                "StaticNtHash: sequence length (" + std::to_string(seq_len) +
+                  ") is smaller than k (" + std::to_string(K) + ")");
+    check_error(pos > seq_len - K,
+                "StaticNtHash: passed position (" + std::to_string(pos) +
+                  ") is larger than sequence length (" +
+                  std::to_string(seq_len) + ")");
+  }
+
+  /**
+   * Construct an ntHash object for k-mers.
+   * @param seq Sequence string
+   * @param pos Position in sequence to start hashing from
+   */
+  StaticNtHash(const std::string& seq, size_t pos = 0)
+    : StaticNtHash(seq.data(), seq.size(), pos)
+  {
+  }
+
+  /**
+   * Calculate the hash values of current k-mer and advance to the next k-mer.
+   * Same as NtHash::roll().
+   * @return \p true on success and \p false otherwise
+   */
+  bool roll()
+  {
+    if (!initialized) {
+      return init();
+    }
+    if (pos >= seq_len - K) {
+      return false;
+    }
+    const auto char_out = (unsigned char)seq[pos];
+    const auto char_in = (unsigned char)seq[pos + K];
+    if (hashing_internals::SEED_TAB[char_in] == hashing_internals::SEED_N) {
+      pos += K;
+      return init();
+    }
+    if constexpr (MODE != NtHashMode::REVERSE) {
+      fwd_hash = hashing_internals::srol(fwd_hash) ^
+                 hashing_internals::SEED_TAB[char_in] ^
+                 Tables::FWD_OUT[char_out];
+    }
+    if constexpr (MODE != NtHashMode::FORWARD) {
+      rev_hash = hashing_internals::sror(
+        rev_hash ^ Tables::REV_IN[char_in] ^
+        hashing_internals::SEED_TAB[char_out & hashing_internals::CP_OFF]);
+    }
+    extend_hashes(std::make_index_sequence<H - 1>());
+    ++pos;
+    return true;
+  }
+
+  /**
+   * Get the array of current canonical hash values (length = \p H)
+   * @return Pointer to the hash array
+   */
+  const uint64_t* hashes() const { return hash_arr.data(); }
+
+  /**
+   * Get the position of last hashed k-mer or the k-mer to be hashed if roll()
+   * has never been called on this object.
+   * @return Position of the most recently hashed k-mer's first base-pair
+   */
+  size_t get_pos() const { return pos; }
+
+  /**
+   * Get the number of hashes generated per k-mer.
+   * @return \p H
+   */
+  static constexpr unsigned get_hash_num() { return H; }
+
+  /**
+   * Get the length of the k-mers.
+   * @return \p K
+   */
+  static constexpr unsigned get_k() { return K; }
+
+  /**
+   * Get the hash value of the forward strand.
+   * @return Forward hash value
+   */
+  uint64_t get_forward_hash() const { return fwd_hash; }
+
+  /**
+   * Get the hash value of the reverse strand.
+   * @return Reverse-complement hash value
+   */
+  uint64_t get_reverse_hash() const { return rev_hash; }
+
+  /**
+   * Get the strands that are hashed.
+   * @return \p MODE
+   */
+  static constexpr NtHashMode get_mode() { return MODE; }
+
+private:
+  const char* seq;
+  size_t seq_len;
+  size_t pos;
+  bool initialized = false;
+  uint64_t fwd_hash = 0;
+  uint64_t rev_hash = 0;
+  std::array<uint64_t, H> hash_arr{};
+
+  // Same as hashing_internals::extend_hashes(), unrolled over the H - 1
+  // extra hashes
+  template<size_t... I>
+  void extend_hashes(std::index_sequence<I...> /*unused*/)
+  {
+    const uint64_t base = hashing_internals::canonical(fwd_hash, rev_hash);
+    hash_arr[0] = base;
+    (
+      [&]() {
+        uint64_t t_val = base * Tables::MULTIPLIERS[I + 1];
+        t_val ^= t_val >> hashing_internals::MULTISHIFT;
+        hash_arr[I + 1] = t_val;
+      }(),
+      ...);
+  }
+
+  bool init()
+  {
+    bool has_n = true;
+    while (pos <= seq_len - K + 1 && has_n) {
+      has_n = false;
+      for (unsigned i = 0; i < K && pos <= seq_len - K + 1; i++) {
+        const auto c = (unsigned char)seq[pos + K - i - 1];
+        if (hashing_internals::SEED_TAB[c] == hashing_internals::SEED_N) {
+          pos += K - i;
+          has_n = true;
+        }
+      }
+    }
+    if (pos > seq_len - K) {
+      return false;
+    }
+    if constexpr (MODE != NtHashMode::REVERSE) {
+      fwd_hash = base_forward_hash(seq + pos, K);
+    }
+    if constexpr (MODE != NtHashMode::FORWARD) {
+      rev_hash = base_reverse_hash(seq + pos, K);
+    }
+    extend_hashes(std::make_index_sequence<H - 1>());
+    initialized = true;
+    return true;
+  }
+};
+
+/** Smallest k dispatch_k() has a specialization for. */
+const unsigned DISPATCH_MIN_K = 15;
+/** Largest k dispatch_k() has a specialization for. */
+const unsigned DISPATCH_MAX_K = 64;
+
+/// @cond HIDDEN_SYMBOLS
+template<typename F, size_t... I>
+bool
+dispatch_k(unsigned k, F&& f, std::index_sequence<I...> /*unused*/)
+{
+  return ((k == DISPATCH_MIN_K + I
+             ? (f(std::integral_constant<unsigned, DISPATCH_MIN_K + I>()), true)
+             : false) ||
+          ...);
+}
+/// @endcond
+
+/**
+ * Call \p f with k as a compile-time constant, so that it can use
+ * StaticNtHash<decltype(k)::value, H>. Specializations exist for k between
+ * DISPATCH_MIN_K and DISPATCH_MAX_K; for other values, \p f is not called
+ * and the caller should fall back to NtHash:
+ *
+ *   const bool dispatched = dispatch_k(k, [&](auto static_k) {
+ *     StaticNtHash<decltype(static_k)::value, 3> nthash(seq);
+ *     while (nthash.roll()) { ... }
+ *   });
+ *   if (!dispatched) { ... use NtHash ... }
+ *
+ * @param k K-mer size
+ * @param f Callable taking a std::integral_constant<unsigned, k>
+ * @return \p true if \p f was called and \p false otherwise
+ */
+template<typename F>
+bool
+dispatch_k(unsigned k, F&& f)
+{
+  return dispatch_k(
+    k,
+    std::forward<F>(f),
+    std::make_index_sequence<DISPATCH_MAX_K - DISPATCH_MIN_K + 1>());
+}
+
+} // namespace btllib
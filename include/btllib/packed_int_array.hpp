@@ -0,0 +1,158 @@
+#ifndef BTLLIB_PACKED_INT_ARRAY_HPP
+#define BTLLIB_PACKED_INT_ARRAY_HPP
+
+#include "btllib/status.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace btllib {
+
+/**
+ * Array of unsigned integers stored with a fixed number of bits per element.
+ * Elements may straddle word boundaries; an extra padding word lets get()
+ * always read two words without a bounds check. The words are stored
+ * contiguously, so an array can be saved as raw memory and used in place from
+ * a memory-mapped file.
+ */
+class PackedIntArray
+{
+
+public:
+  /** Construct an empty array. */
+  PackedIntArray() = default;
+
+  /**
+   * Construct an array of zeros.
+   *
+   * @param size Number of elements.
+   * @param width Bits per element, from 1 to 64.
+   */
+  PackedIntArray(size_t size, unsigned width);
+
+  PackedIntArray(const PackedIntArray&) = delete;
+  PackedIntArray(PackedIntArray&&) = default;
+
+  PackedIntArray& operator=(const PackedIntArray&) = delete;
+  PackedIntArray& operator=(PackedIntArray&&) = default;
+
+  /**
+   * Construct an array that uses words stored elsewhere, e.g. in a
+   * memory-mapped file, without copying them. The memory must outlive the
+   * returned object.
+   *
+   * @param words Words as returned by data() of the saved array.
+   * @param size Number of elements.
+   * @param width Bits per element.
+   */
+  static PackedIntArray view(const uint64_t* words,
+                             size_t size,
+                             unsigned width);
+
+  /** Number of bytes used by the words of an array. */
+  static size_t bytes(size_t size, unsigned width)
+  {
+    return ((size * width + 63) / 64 + 1) * sizeof(uint64_t);
+  }
+
+  /** Get the minimum width that can store value. */
+  static unsigned width_of(uint64_t value)
+  {
+    unsigned width = 1;
+    while (width < 64 && (value >> width) != 0) {
+      ++width;
+    }
+    return width;
+  }
+
+  /** Get the number of elements. */
+  size_t size() const { return elements; }
+
+  /** Get the number of bits per element. */
+  unsigned get_width() const { return width; }
+
+  /** Get the number of bytes used by the words. */
+  size_t bytes() const { return bytes(elements, width); }
+
+  /** Get the raw words, e.g. for saving. */
+  const uint64_t* data() const { return words; }
+
+  /** Get element i. */
+  uint64_t get(const size_t i) const
+  {
+    const size_t pos = i * width;
+    const size_t word = pos / 64;
+    const unsigned offset = pos % 64;
+    // The high part is shifted in two steps so that offset 0 shifts out all
+    // bits instead of shifting by 64.
+    const uint64_t value =
+      (words[word] >> offset) | ((words[word + 1] << 1) << (63 - offset));
+    return value & mask;
+  }
+
+  /** Set element i. Only valid for arrays that own their storage. */
+  void set(size_t i, uint64_t value);
+
+  /** Prefetch the word holding element i for a following get(). */
+  void prefetch(const size_t i) const
+  {
+    __builtin_prefetch(words + i * width / 64);
+  }
+
+private:
+  std::unique_ptr<uint64_t[]> storage;
+  const uint64_t* words = nullptr;
+  size_t elements = 0;
+  unsigned width = 0;
+  uint64_t mask = 0;
+};
+
+inline PackedIntArray::PackedIntArray(const size_t size, const unsigned width)
+  : storage(new uint64_t[bytes(size, width) / sizeof(uint64_t)]())
+  , words(storage.get())
+  , elements(size)
+  , width(width)
+  , mask(width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1)
+{
+  check_error(width == 0 || width > 64,
+              "PackedIntArray: width must be between 1 and 64.");
+}
+
+inline PackedIntArray
+PackedIntArray::view(const uint64_t* words,
+                     const size_t size,
+                     const unsigned width)
+{
+  check_error(words == nullptr, "PackedIntArray: null word pointer.");
+  check_error(width == 0 || width > 64,
+              "PackedIntArray: width must be between 1 and 64.");
+  PackedIntArray array;
+  array.words = words;
+  array.elements = size;
+  array.width = width;
+  array.mask = width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+  return array;
+}
+
+inline void
+PackedIntArray::set(const size_t i, uint64_t value)
+{
+  check_error(!storage, "PackedIntArray: cannot modify a view.");
+  value &= mask;
+  const size_t pos = i * width;
+  const size_t word = pos / 64;
+  const unsigned offset = pos % 64;
+  storage[word] = (storage[word] & ~(mask << offset)) | (value << offset);
+  if (offset + width > 64) {
+    const unsigned high_bits = offset + width - 64;
+    const uint64_t high_mask = (uint64_t(1) << high_bits) - 1;
+    storage[word + 1] =
+      (storage[word + 1] & ~high_mask) | (value >> (64 - offset));
+  }
+}
+
+} // namespace btllib
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef BTLLIB_PACKED_SEQ_HPP
+#define BTLLIB_PACKED_SEQ_HPP
+
+#include "btllib/hashing_internals.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
+
+namespace btllib {
+
+/**
+ * Nucleotide sequence stored with 2 bits per base and a bitmap marking the
+ * positions of invalid characters (N), 3 bits per base in total instead of 8
+ * for the characters. Base i is stored in bits 2 * (i % 32) of word i / 32,
+ * with the codes A = 0, C = 1, T = 2 and G = 3, i.e. bits 1-2 of the ASCII
+ * code, so that the complement of a code is the code XOR 2. U is stored as T.
+ * Any
+ * character other than ACGTU (in either case) is stored as N, which unpacks to
+ * 'N'. Like the terminator of a string, position size() reads as N. Packing
+ * and unpacking use AVX2 instructions when supported by the CPU.
+ */
+class PackedSeq
+{
+
+public:
+  /** Construct an empty sequence. */
+  PackedSeq() = default;
+
+  /**
+   * Pack a sequence.
+   *
+   * @param seq C-string containing sequence data.
+   * @param seq_len Length of the sequence.
+   */
+  PackedSeq(const char* seq, size_t seq_len);
+
+  /**
+   * Pack a sequence.
+   *
+   * @param seq Sequence string.
+   */
+  explicit PackedSeq(const std::string& seq)
+    : PackedSeq(seq.data(), seq.size())
+  {
+  }
+
+  /** Get the number of bases. */
+  size_t size() const { return length; }
+
+  /** Get the number of bytes used by the bases and the N bitmap. */
+  size_t bytes() const
+  {
+    return (bases.size() + n_mask.size()) * sizeof(uint64_t);
+  }
+
+  /** Get the 2-bit code of base i, 0 for N. */
+  unsigned code(const size_t i) const
+  {
+    return unsigned(bases[i / 32] >> (2 * (i % 32))) & 3;
+  }
+
+  /** Check whether base i is N, i.e. an invalid character. */
+  bool is_n(const size_t i) const { return ((n_mask[i / 64] >> (i % 64)) & 1); }
+
+  /** Get base i as an uppercase character, or 'N'. */
+  char operator[](const size_t i) const
+  {
+    return "ACTGNNNN"[code(i) | (unsigned(is_n(i)) << 2)];
+  }
+
+  /**
+   * Unpack part of the sequence.
+   *
+   * @param pos Position of the first base.
+   * @param len Number of bases.
+   * @param out Output array with room for len characters. No null terminator
+   * is written.
+   */
+  void unpack(size_t pos, size_t len, char* out) const;
+
+  /** Unpack the whole sequence. */
+  std::string unpack() const;
+
+  /** Get the reverse complement of the sequence. */
+  PackedSeq reverse_complement() const;
+
+  /** Get the raw words of the 2-bit codes. */
+  const uint64_t* get_bases() const { return bases.data(); }
+
+  /** Get the raw words of the N bitmap, bit i set for N at position i. */
+  const uint64_t* get_n_mask() const { return n_mask.data(); }
+
+private:
+  std::vector<uint64_t> bases;
+  std::vector<uint64_t> n_mask;
+  size_t length = 0;
+};
+
+/// @cond HIDDEN_SYMBOLS
+namespace packed_seq_internals {
+
+const uint64_t COMPLEMENT_BASES = 0xAAAAAAAAAAAAAAAAULL;
+
+// Code of a character and whether it is valid, like the AVX2 kernels
+inline bool
+pack_char(const unsigned char c, uint64_t& code)
+{
+  const unsigned char upper = c & 0xDF;
+  code = (c >> 1) & 3;
+  return upper == 'A' || upper == 'C' || upper == 'G' || upper == 'T' ||
+         upper == 'U';
+}
+
+// Reverse the order of the 2-bit fields of a word
+inline uint64_t
+reverse_fields(uint64_t x)
+{
+  x = __builtin_bswap64(x);
+  x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+  return ((x >> 2) & 0x3333333333333333ULL) |
+         ((x & 0x3333333333333333ULL) << 2);
+}
+
+// Reverse the order of the bits of a word
+inline uint64_t
+reverse_bits(uint64_t x)
+{
+  x = reverse_fields(x);
+  return ((x >> 1) & 0x5555555555555555ULL) |
+         ((x & 0x5555555555555555ULL) << 1);
+}
+
+// Reverse an array of n items stored in words of per_word fields of the given
+// bit width, transforming the words with f before they are shifted into place.
+// The items past n are ignored.
+template<typename F>
+inline void
+reverse_words(const uint64_t* in,
+              uint64_t* out,
+              const size_t n,
+              const unsigned per_word,
+              const unsigned width,
+              F f)
+{
+  const size_t words = (n + per_word - 1) / per_word;
+  // Reversing the words reverses the sequence padded to a whole number of
+  // words, which starts with the padding and is shifted back by its size
+  const unsigned shift = unsigned(words * per_word - n) * width;
+  for (size_t j = 0; j < words; j++) {
+    const uint64_t lo = f(in[words - 1 - j]);
+    const uint64_t hi = j + 1 < words ? f(in[words - 2 - j]) : 0;
+    out[j] = shift == 0 ? lo : (lo >> shift) | (hi << (64 - shift));
+  }
+}
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(SWIG)
+// Pack the full blocks of 32 characters, returning the number of packed
+// characters
+__attribute__((target("avx2"))) inline size_t
+pack_avx2(const char* seq, const size_t seq_len, uint64_t* bases, uint64_t* ns)
+{
+  const __m256i case_mask = _mm256_set1_epi8(char(0xDF));
+  const __m256i three = _mm256_set1_epi8(3);
+  // Multipliers that combine pairs of bytes and then pairs of 16-bit values
+  const __m256i pair_mult = _mm256_set1_epi16(0x0401);
+  const __m256i quad_mult = _mm256_set1_epi32(0x00100001);
+  // Bytes 0, 4, 8 and 12 of each lane, then the low dwords of the lanes
+  const __m256i gather = _mm256_set_epi64x(
+    -1, int64_t(0xFFFFFFFF0C080400ULL), -1, int64_t(0xFFFFFFFF0C080400ULL));
+  const __m256i lanes = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+  size_t i = 0;
+  for (; i + 32 <= seq_len; i += 32) {
+    const __m256i chars =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(seq + i));
+    const __m256i upper = _mm256_and_si256(chars, case_mask);
+    __m256i valid = _mm256_cmpeq_epi8(upper, _mm256_set1_epi8('A'));
+    for (const char c : { 'C', 'G', 'T', 'U' }) {
+      valid =
+        _mm256_or_si256(valid, _mm256_cmpeq_epi8(upper, _mm256_set1_epi8(c)));
+    }
+    const __m256i codes = _mm256_and_si256(
+      _mm256_and_si256(_mm256_srli_epi16(chars, 1), three), valid);
+    const __m256i pairs = _mm256_maddubs_epi16(codes, pair_mult);
+    const __m256i quads = _mm256_madd_epi16(pairs, quad_mult);
+    const __m256i packed = _mm256_permutevar8x32_epi32(
+      _mm256_shuffle_epi8(quads, gather), lanes);
+    bases[i / 32] = uint64_t(_mm_cvtsi128_si64(_mm256_castsi256_si128(packed)));
+    const uint32_t invalid = ~uint32_t(_mm256_movemask_epi8(valid));
+    ns[i / 64] |= uint64_t(invalid) << (i % 64);
+  }
+  return i;
+}
+
+// Unpack the full blocks of 32 bases starting at a multiple of 32, returning
+// the number of unpacked bases
+__attribute__((target("avx2"))) inline size_t
+unpack_avx2(const uint64_t* bases,
+            const uint64_t* ns,
+            const size_t start,
+            const size_t len,
+            char* out)
+{
+  // Byte j of the output takes the code from byte j / 4 of the word
+  const __m256i spread = _mm256_set_epi64x(int64_t(0x0707070706060606ULL),
+                                           int64_t(0x0505050504040404ULL),
+                                           int64_t(0x0303030302020202ULL),
+                                           int64_t(0x0101010100000000ULL));
+  const __m256i field = _mm256_set1_epi32(int(0x03020100));
+  const __m256i field1 = _mm256_cmpeq_epi8(field, _mm256_set1_epi8(1));
+  const __m256i field2 = _mm256_cmpeq_epi8(field, _mm256_set1_epi8(2));
+  const __m256i field3 = _mm256_cmpeq_epi8(field, _mm256_set1_epi8(3));
+  const __m256i three = _mm256_set1_epi8(3);
+  // "ACTG" in every dword, looked up by the codes
+  const __m256i letters = _mm256_set1_epi32(0x47544341);
+  // Byte j of the output takes its N flag from bit j % 8 of byte j / 8
+  const __m256i spread_ns =
+    _mm256_set_epi64x(int64_t(0x0303030303030303ULL),
+                      int64_t(0x0202020202020202ULL),
+                      int64_t(0x0101010101010101ULL),
+                      0);
+  const __m256i bits = _mm256_set1_epi64x(int64_t(0x8040201008040201ULL));
+  const __m256i n_char = _mm256_set1_epi8('N');
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    const size_t base = start + i;
+    const __m256i bytes = _mm256_shuffle_epi8(
+      _mm256_set1_epi64x(int64_t(bases[base / 32])), spread);
+    __m256i codes = _mm256_and_si256(bytes, three);
+    codes = _mm256_blendv_epi8(
+      codes, _mm256_and_si256(_mm256_srli_epi16(bytes, 2), three), field1);
+    codes = _mm256_blendv_epi8(
+      codes, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), three), field2);
+    codes = _mm256_blendv_epi8(
+      codes, _mm256_and_si256(_mm256_srli_epi16(bytes, 6), three), field3);
+    __m256i chars = _mm256_shuffle_epi8(letters, codes);
+    const uint32_t n_bits = uint32_t(ns[base / 64] >> (base % 64));
+    if (n_bits != 0) {
+      const __m256i flags = _mm256_and_si256(
+        _mm256_shuffle_epi8(_mm256_set1_epi32(int(n_bits)), spread_ns), bits);
+      chars =
+        _mm256_blendv_epi8(chars, n_char, _mm256_cmpeq_epi8(flags, bits));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), chars);
+  }
+  return i;
+}
+#endif
+
+} // namespace packed_seq_internals
+/// @endcond
+
+inline PackedSeq::PackedSeq(const char* seq, const size_t seq_len)
+  : bases(seq_len / 32 + 1, 0)
+  , n_mask(seq_len / 64 + 1, 0)
+  , length(seq_len)
+{
+  n_mask[seq_len / 64] |= uint64_t(1) << (seq_len % 64);
+  size_t i = 0;
+#if defined(__x86_64__) && defined(__GNUC__)
+  if (hashing_internals::get_simd_level() !=
+      hashing_internals::SimdLevel::SCALAR) {
+    i = packed_seq_internals::pack_avx2(
+      seq, seq_len, bases.data(), n_mask.data());
+  }
+#endif
+  for (; i < seq_len; i++) {
+    uint64_t code;
+    if (packed_seq_internals::pack_char(seq[i], code)) {
+      bases[i / 32] |= code << (2 * (i % 32));
+    } else {
+      n_mask[i / 64] |= uint64_t(1) << (i % 64);
+    }
+  }
+}
+
+inline void
+PackedSeq::unpack(const size_t pos, const size_t len, char* out) const
+{
+  size_t i = 0;
+#if defined(__x86_64__) && defined(__GNUC__)
+  // The vectorized part starts at the first whole word
+  for (; i < len && (pos + i) % 32 != 0; i++) {
+    out[i] = (*this)[pos + i];
+  }
+  if (i < len && hashing_internals::get_simd_level() !=
+                   hashing_internals::SimdLevel::SCALAR) {
+    i += packed_seq_internals::unpack_avx2(
+      bases.data(), n_mask.data(), pos + i, len - i, out + i);
+  }
+#endif
+  for (; i < len; i++) {
+    out[i] = (*this)[pos + i];
+  }
+}
+
+inline std::string
+PackedSeq::unpack() const
+{
+  std::string seq(length, 'N');
+  unpack(0, length, &seq[0]);
+  return seq;
+}
+
+inline PackedSeq
+PackedSeq::reverse_complement() const
+{
+  PackedSeq rc;
+  rc.length = length;
+  rc.bases.assign(bases.size(), 0);
+  rc.n_mask.assign(n_mask.size(), 0);
+  packed_seq_internals::reverse_words(
+    bases.data(), rc.bases.data(), length, 32, 2, [](const uint64_t word) {
+      return packed_seq_internals::reverse_fields(word) ^
+             packed_seq_internals::COMPLEMENT_BASES;
+    });
+  packed_seq_internals::reverse_words(n_mask.data(),
+                                      rc.n_mask.data(),
+                                      length,
+                                      64,
+                                      1,
+                                      packed_seq_internals::reverse_bits);
+  rc.n_mask[length / 64] |= uint64_t(1) << (length % 64);
+  // N is stored as 0, which the complement turned into 2
+  for (size_t j = 0; j < rc.n_mask.size(); j++) {
+    for (uint64_t word = rc.n_mask[j]; word != 0; word &= word - 1) {
+      const size_t i = j * 64 + unsigned(__builtin_ctzll(word));
+      rc.bases[i / 32] &= ~(uint64_t(3) << (2 * (i % 32)));
+    }
+  }
+  return rc;
+}
+
+} // namespace btllib
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef BTLLIB_RANK_BIT_VECTOR_HPP
+#define BTLLIB_RANK_BIT_VECTOR_HPP
+
+#include "btllib/status.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace btllib {
+
+/// @cond HIDDEN_SYMBOLS
+inline unsigned
+popcount64(uint64_t x)
+{
+#if defined(__POPCNT__)
+  return unsigned(__builtin_popcountll(x));
+#else
+  // Without hardware POPCNT, the builtin turns into a libgcc call
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return unsigned((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+/// @endcond
+
+/**
+ * Immutable bit vector with constant time rank queries. The bits are stored in
+ * cache line sized blocks of 8 words: a header word followed by 7 words (448
+ * bits) of data. The header packs the number of set bits before the block (38
+ * bits) with the number of set bits before data words 2, 4 and 6 of the block
+ * (8, 9 and 9 bits). A rank query therefore touches a single cache line and
+ * needs at most two population counts. The blocks are stored contiguously, so
+ * a vector can be saved as raw memory and used in place from a memory-mapped
+ * file.
+ */
+class RankBitVector
+{
+
+public:
+  static const size_t BLOCK_WORDS = 8;
+  static const size_t DATA_WORDS = BLOCK_WORDS - 1;
+  static const size_t BLOCK_BITS = DATA_WORDS * 64;
+  static const size_t BLOCK_BYTES = BLOCK_WORDS * sizeof(uint64_t);
+  /** Bits of the header used for the number of set bits before the block. */
+  static const unsigned ABSOLUTE_BITS = 38;
+  /** Maximum number of set bits in a vector. */
+  static const uint64_t MAX_COUNT = (uint64_t(1) << ABSOLUTE_BITS) - 1;
+
+  /** Construct an empty bit vector. */
+  RankBitVector() = default;
+
+  /**
+   * Construct from a plain bit array.
+   *
+   * @param words Bits in little-endian word order, i.e. bit i is
+   * (words[i / 64] >> (i % 64)) & 1.
+   * @param size Number of bits.
+   */
+  RankBitVector(const uint64_t* words, size_t size);
+
+  RankBitVector(const RankBitVector&) = delete;
+  RankBitVector(RankBitVector&&) = default;
+
+  RankBitVector& operator=(const RankBitVector&) = delete;
+  RankBitVector& operator=(RankBitVector&&) = default;
+
+  /**
+   * Construct a bit vector that uses blocks stored elsewhere, e.g. in a
+   * memory-mapped file, without copying them. The memory must outlive the
+   * returned object.
+   *
+   * @param blocks Blocks as returned by data() of the saved vector. Must be
+   * aligned to 8 bytes, preferably to BLOCK_BYTES.
+   * @param size Number of bits.
+   */
+  static RankBitVector view(const uint64_t* blocks, size_t size);
+
+  /** Number of bytes used by the blocks of a vector with size bits. */
+  static size_t bytes(size_t size)
+  {
+    return (size / BLOCK_BITS + 1) * BLOCK_BYTES;
+  }
+
+  /** Get the number of bits. */
+  size_t size() const { return bits; }
+
+  /** Get the number of bytes used by the blocks. */
+  size_t bytes() const { return bytes(bits); }
+
+  /** Get the raw blocks, e.g. for saving. */
+  const uint64_t* data() const { return blocks; }
+
+  /** Get the value of bit i. */
+  bool operator[](const size_t i) const
+  {
+    const uint64_t word =
+      blocks[(i / BLOCK_BITS) * BLOCK_WORDS + 1 + (i % BLOCK_BITS) / 64];
+    return ((word >> (i % 64)) & 1) != 0;
+  }
+
+  /** Get bits [64 * w, 64 * w + 64) as a word, with bit i at (i % 64). */
+  uint64_t get_word(const size_t w) const
+  {
+    return blocks[(w / DATA_WORDS) * BLOCK_WORDS + 1 + w % DATA_WORDS];
+  }
+
+  /** Get the number of set bits in positions [0, i). */
+  uint64_t rank(const size_t i) const
+  {
+    const uint64_t* const block = blocks + (i / BLOCK_BITS) * BLOCK_WORDS;
+    const size_t offset = i % BLOCK_BITS;
+    const size_t word = offset / 64;
+    const uint64_t header = block[0];
+    const unsigned pair = word / 2;
+    uint64_t count = (header & MAX_COUNT) +
+                     ((header >> pair_shift(pair)) & pair_mask(pair));
+    // Words with an odd index also need the preceding word. For word 0 this
+    // reads the header, which the mask discards.
+    count += popcount64(block[word] & (uint64_t(0) - (word & 1)));
+    count += popcount64(block[1 + word] &
+                        ((uint64_t(1) << (offset % 64)) - 1));
+    return count;
+  }
+
+  /** Get the total number of set bits. */
+  uint64_t count() const { return bits == 0 ? 0 : rank(bits); }
+
+  /** Prefetch the cache line holding bit i for a following query. */
+  void prefetch(const size_t i) const
+  {
+    __builtin_prefetch(blocks + (i / BLOCK_BITS) * BLOCK_WORDS);
+  }
+
+private:
+  /// @cond HIDDEN_SYMBOLS
+  struct alignas(BLOCK_BYTES) Block
+  {
+    uint64_t words[BLOCK_WORDS];
+  };
+  /// @endcond
+
+  // Relative counts before data words 2, 4 and 6 are stored in 8, 9 and 9 bits
+  // above the absolute count. Pair 0 (words 0 and 1) has no relative count.
+  // Looked up from packed constants rather than branches, which would be
+  // mispredicted for random queries.
+  static unsigned pair_shift(const unsigned pair)
+  {
+    return unsigned((0x372E2600ULL >> (pair * 8)) & 0xFF);
+  }
+  static uint64_t pair_mask(const unsigned pair)
+  {
+    return (0x01FF01FF00FF0000ULL >> (pair * 16)) & 0xFFFF;
+  }
+
+  std::unique_ptr<Block[]> storage;
+  const uint64_t* blocks = nullptr;
+  size_t bits = 0;
+};
+
+inline RankBitVector::RankBitVector(const uint64_t* words, const size_t size)
+  : bits(size)
+{
+  // One extra block so that rank(size) is valid when size is a multiple of
+  // BLOCK_BITS
+  const size_t block_num = size / BLOCK_BITS + 1;
+  const size_t word_num = (size + 63) / 64;
+  storage = std::unique_ptr<Block[]>(new Block[block_num]);
+  uint64_t count = 0;
+  for (size_t b = 0; b < block_num; ++b) {
+    uint64_t* const block = storage[b].words;
+    uint64_t header = count;
+    uint64_t relative = 0;
+    for (unsigned j = 0; j < DATA_WORDS; ++j) {
+      if (j % 2 == 0 && j > 0) {
+        header |= relative << pair_shift(j / 2);
+      }
+      const size_t w = b * DATA_WORDS + j;
+      uint64_t word = w < word_num ? words[w] : 0;
+      if (w + 1 == word_num && size % 64 != 0) {
+        word &= (uint64_t(1) << (size % 64)) - 1;
+      }
+      block[1 + j] = word;
+      relative += popcount64(word);
+    }
+    block[0] = header;
+    count += relative;
+    check_error(count > MAX_COUNT,
+                "RankBitVector: too many set bits (maximum is " +
+                  std::to_string(MAX_COUNT) + ").");
+  }
+  blocks = storage[0].words;
+}
+
+inline RankBitVector
+RankBitVector::view(const uint64_t* blocks, const size_t size)
+{
+  check_error(blocks == nullptr, "RankBitVector: null block pointer.");
+  RankBitVector vector;
+  vector.blocks = blocks;
+  vector.bits = size;
+  return vector;
+}
+
+} // namespace btllib
+
+#endif
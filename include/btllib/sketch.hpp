@@ -0,0 +1,689 @@
+#ifndef BTLLIB_SKETCH_HPP
+#define BTLLIB_SKETCH_HPP
+
+#include "btllib/nthash.hpp"
+#include "btllib/status.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace btllib {
+
+/**
+ * Minimum of the last w values of a stream, kept in a monotone deque. Every
+ * value enters and leaves the deque at most once, so push() takes O(1)
+ * amortized time independent of w. If several values in the window are equal
+ * to the minimum, the rightmost (most recently pushed) one is reported.
+ * Memory is only allocated by the constructor.
+ */
+class SlidingWindowMin
+{
+public:
+  /**
+   * Construct an empty window.
+   * @param w Window size, i.e. number of most recent values considered
+   */
+  explicit SlidingWindowMin(size_t w)
+    : w(w)
+    , entries(new Entry[w])
+  {
+    check_error(w == 0, "SlidingWindowMin: window size must be at least 1.");
+  }
+
+  SlidingWindowMin(const SlidingWindowMin& window)
+    : w(window.w)
+    , entries(new Entry[window.w])
+    , head(window.head)
+    , size(window.size)
+    , count(window.count)
+  {
+    std::copy_n(window.entries.get(), w, entries.get());
+  }
+
+  SlidingWindowMin(SlidingWindowMin&&) = default;
+
+  /**
+   * Add the next value of the stream. The value pushed w values earlier leaves
+   * the window.
+   * @param value Value to add
+   * @param pos Position of the value, reported by get_min_pos() when the value
+   * is the minimum
+   */
+  void push(uint64_t value, size_t pos)
+  {
+    // At most one value leaves the window per push
+    if (size > 0 && entries[head].index + w <= count) {
+      head = head + 1 == w ? 0 : head + 1;
+      --size;
+    }
+    // Values that are not smaller than the new one can never be the rightmost
+    // minimum again
+    while (size > 0 && entries[slot(size - 1)].value >= value) {
+      --size;
+    }
+    entries[slot(size)] = { value, pos, count };
+    ++size;
+    ++count;
+  }
+
+  /** Remove all values, e.g. before starting a new sequence. */
+  void clear()
+  {
+    head = 0;
+    size = 0;
+    count = 0;
+  }
+
+  /** Whether w values were pushed since construction or the last clear(). */
+  bool is_full() const { return count >= w; }
+
+  /** Minimum value in the window. The window must not be empty. */
+  uint64_t get_min_value() const { return entries[head].value; }
+
+  /** Position of the minimum value, as given to push(). */
+  size_t get_min_pos() const { return entries[head].pos; }
+
+  /**
+   * Index of the minimum value in the stream, i.e. the number of values pushed
+   * before it since construction or the last clear().
+   */
+  size_t get_min_index() const { return entries[head].index; }
+
+  /** Number of values pushed since construction or the last clear(). */
+  size_t get_count() const { return count; }
+
+  size_t get_w() const { return w; }
+
+private:
+  struct Entry
+  {
+    uint64_t value;
+    size_t pos;
+    size_t index;
+  };
+
+  // Slot of the i-th value of the deque in the circular entries array
+  size_t slot(size_t i) const { return head + i < w ? head + i : head + i - w; }
+
+  size_t w;
+  std::unique_ptr<Entry[]> entries;
+  size_t head = 0;
+  size_t size = 0;
+  size_t count = 0;
+};
+
+/**
+ * Selects window minimizers from a stream of k-mer hash values: the k-mer with
+ * the smallest hash value in every window of w consecutive k-mers, the
+ * rightmost one on ties. A k-mer is selected once, even if it is the minimizer
+ * of several windows. The windows span consecutive pushed k-mers, so k-mers
+ * skipped by NtHash (e.g. those with an N) do not break them.
+ */
+class MinimizerSelector
+{
+public:
+  /**
+   * Construct a selector.
+   * @param w Number of k-mers per window
+   */
+  explicit MinimizerSelector(size_t w)
+    : window(w)
+  {
+  }
+
+  /**
+   * Add the hash value of the next k-mer.
+   * @param hash K-mer hash value
+   * @param pos K-mer position
+   * @return true if a new minimizer was selected, in which case get_hash(),
+   * get_pos() and get_index() describe it.
+   */
+  bool push(uint64_t hash, size_t pos)
+  {
+    window.push(hash, pos);
+    if (!window.is_full() ||
+        (selected && window.get_min_index() == selected_index)) {
+      return false;
+    }
+    selected = true;
+    selected_hash = window.get_min_value();
+    selected_pos = window.get_min_pos();
+    selected_index = window.get_min_index();
+    return true;
+  }
+
+  /** Forget all pushed k-mers, e.g. before starting a new sequence. */
+  void reset()
+  {
+    window.clear();
+    selected = false;
+  }
+
+  /** Hash value of the last selected minimizer. */
+  uint64_t get_hash() const { return selected_hash; }
+
+  /** Position of the last selected minimizer. */
+  size_t get_pos() const { return selected_pos; }
+
+  /**
+   * Index of the last selected minimizer among the pushed k-mers. It is one of
+   * the last w indices, so a circular buffer of w entries indexed by
+   * get_index() % w is enough to keep the data of the candidate minimizers.
+   */
+  size_t get_index() const { return selected_index; }
+
+  size_t get_w() const { return window.get_w(); }
+
+private:
+  SlidingWindowMin window;
+  bool selected = false;
+  uint64_t selected_hash = 0;
+  size_t selected_pos = 0;
+  size_t selected_index = 0;
+};
+
+/** Kinds of syncmers selected by SyncmerSelector. */
+enum class SyncmerType
+{
+  /** The smallest s-mer is at a given offset in the k-mer. */
+  OPEN,
+  /** The smallest s-mer is at the start or end of the k-mer. */
+  CLOSED
+};
+
+/**
+ * Selects syncmers from a stream of s-mer hash values: the k-mers whose
+ * smallest s-mer, the rightmost one on ties, is at a fixed offset within the
+ * k-mer. Unlike minimizers, syncmers are chosen based on the k-mer alone, so
+ * the same k-mers are selected regardless of their context. The s-mers of a
+ * k-mer must be at consecutive positions, so a gap in the pushed positions
+ * (e.g. s-mers skipped by NtHash because of an N) starts over.
+ */
+class SyncmerSelector
+{
+public:
+  /**
+   * Construct a selector.
+   * @param k K-mer size
+   * @param s S-mer size, at most k
+   * @param type Syncmer type
+   * @param offset Offset of the smallest s-mer in open syncmers, at most
+   * k - s
+   */
+  SyncmerSelector(size_t k,
+                  size_t s,
+                  SyncmerType type = SyncmerType::CLOSED,
+                  size_t offset = 0)
+    : k(k)
+    , s(s)
+    , type(type)
+    , offset(offset)
+    , window(s > 0 && s <= k ? k - s + 1 : 1)
+  {
+    check_error(s == 0 || s > k,
+                "SyncmerSelector: s must be between 1 and k.");
+    check_error(offset > k - s,
+                "SyncmerSelector: offset must be at most k - s.");
+  }
+
+  /**
+   * Add the hash value of the next s-mer.
+   * @param hash S-mer hash value
+   * @param pos S-mer position
+   * @return true if the k-mer ending with this s-mer is a syncmer, in which
+   * case get_pos() returns its position.
+   */
+  bool push(uint64_t hash, size_t pos)
+  {
+    if (window.get_count() > 0 && pos != next_pos) {
+      window.clear();
+    }
+    next_pos = pos + 1;
+    window.push(hash, pos);
+    if (!window.is_full()) {
+      return false;
+    }
+    const size_t kmer_pos = pos - (k - s);
+    const size_t min_offset = window.get_min_pos() - kmer_pos;
+    if (type == SyncmerType::OPEN ? min_offset == offset
+                                  : min_offset == 0 || min_offset == k - s) {
+      selected_pos = kmer_pos;
+      return true;
+    }
+    return false;
+  }
+
+  /** Forget all pushed s-mers, e.g. before starting a new sequence. */
+  void reset() { window.clear(); }
+
+  /** Position of the last selected syncmer. */
+  size_t get_pos() const { return selected_pos; }
+
+  size_t get_k() const { return k; }
+  size_t get_s() const { return s; }
+
+private:
+  size_t k, s;
+  SyncmerType type;
+  size_t offset;
+  SlidingWindowMin window;
+  size_t next_pos = 0;
+  size_t selected_pos = 0;
+};
+
+/**
+ * Selects mod-minimizers from a stream of t-mer hash values. In every window
+ * of w consecutive k-mers, the smallest of its t-mers is found at some offset
+ * x, and the k-mer at offset x mod w is selected. With t = r + ((k - r) mod
+ * w), mod-minimizers have a lower density than window minimizers when k is
+ * larger than w. The t-mers must be at consecutive positions, so a gap in the
+ * pushed positions starts over.
+ */
+class ModMinimizerSelector
+{
+public:
+  /** Default minimum t-mer size. */
+  static const size_t DEFAULT_R = 4;
+
+  /**
+   * Construct a selector.
+   * @param k K-mer size
+   * @param w Number of k-mers per window
+   * @param r Minimum t-mer size. If k < r, t = k and the selected k-mers are
+   * window minimizers.
+   */
+  ModMinimizerSelector(size_t k, size_t w, size_t r = DEFAULT_R)
+    : k(k)
+    , w(w)
+    , t(k < r || w == 0 ? k : r + (k - r) % w)
+    , window(w + k - t)
+  {
+    check_error(k == 0, "ModMinimizerSelector: k must be at least 1.");
+    check_error(w == 0, "ModMinimizerSelector: w must be at least 1.");
+  }
+
+  /**
+   * Add the hash value of the next t-mer.
+   * @param hash T-mer hash value
+   * @param pos T-mer position
+   * @return true if a new k-mer was selected, in which case get_pos() returns
+   * its position.
+   */
+  bool push(uint64_t hash, size_t pos)
+  {
+    if (window.get_count() > 0 && pos != next_pos) {
+      window.clear();
+    }
+    next_pos = pos + 1;
+    window.push(hash, pos);
+    if (!window.is_full()) {
+      return false;
+    }
+    const size_t window_pos = pos + 1 - window.get_w();
+    const size_t kmer_pos =
+      window_pos + (window.get_min_pos() - window_pos) % w;
+    if (selected && kmer_pos == selected_pos) {
+      return false;
+    }
+    selected = true;
+    selected_pos = kmer_pos;
+    return true;
+  }
+
+  /** Forget all pushed t-mers, e.g. before starting a new sequence. */
+  void reset()
+  {
+    window.clear();
+    selected = false;
+  }
+
+  /** Position of the last selected k-mer. */
+  size_t get_pos() const { return selected_pos; }
+
+  size_t get_k() const { return k; }
+  size_t get_w() const { return w; }
+
+  /** Size of the t-mers whose hash values are to be pushed. */
+  size_t get_t() const { return t; }
+
+private:
+  size_t k, w, t;
+  SlidingWindowMin window;
+  size_t next_pos = 0;
+  bool selected = false;
+  size_t selected_pos = 0;
+};
+
+/**
+ * Builds order 2 randstrobes from a stream of k-mer hash values. Each k-mer is
+ * the first strobe of a randstrobe whose second strobe is the k-mer in the
+ * range of w_min to w_max k-mers after it that minimizes the XOR of the two
+ * hash values, the leftmost one on ties. As with minimizers, the ranges span
+ * consecutive pushed k-mers, so the stream may also consist of previously
+ * selected k-mers such as syncmers. Each randstrobe takes O(w_max - w_min)
+ * time to build.
+ */
+class RandstrobeSelector
+{
+public:
+  /**
+   * Construct a selector.
+   * @param w_min Offset of the first candidate for the second strobe, at least
+   * 1
+   * @param w_max Offset of the last candidate for the second strobe, at least
+   * w_min
+   */
+  RandstrobeSelector(size_t w_min, size_t w_max)
+    : w_min(w_min)
+    , w_max(w_max)
+    , capacity(w_max + 1)
+    , entries(new Entry[w_max + 1])
+  {
+    check_error(w_min == 0, "RandstrobeSelector: w_min must be at least 1.");
+    check_error(w_max < w_min,
+                "RandstrobeSelector: w_max must be at least w_min.");
+  }
+
+  RandstrobeSelector(const RandstrobeSelector& selector)
+    : w_min(selector.w_min)
+    , w_max(selector.w_max)
+    , capacity(selector.capacity)
+    , entries(new Entry[selector.capacity])
+    , head(selector.head)
+    , size(selector.size)
+    , strobe_hash(selector.strobe_hash)
+    , first_pos(selector.first_pos)
+    , second_pos(selector.second_pos)
+  {
+    std::copy_n(selector.entries.get(), capacity, entries.get());
+  }
+
+  RandstrobeSelector(RandstrobeSelector&&) = default;
+
+  /**
+   * Add the hash value of the next k-mer.
+   * @param hash K-mer hash value
+   * @param pos K-mer position
+   * @return true if the randstrobe starting w_max k-mers earlier was built,
+   * in which case get_hash(), get_first_pos() and get_second_pos() describe
+   * it.
+   */
+  bool push(uint64_t hash, size_t pos)
+  {
+    entries[slot(size)] = { hash, pos };
+    ++size;
+    if (size < capacity) {
+      return false;
+    }
+    build();
+    return true;
+  }
+
+  /**
+   * Build the randstrobes of the last k-mers, whose candidate ranges end at
+   * the last pushed k-mer. Call after the last push() until it returns false.
+   * The selector is then empty and may be reused.
+   * @return true if a randstrobe was built.
+   */
+  bool finish()
+  {
+    if (size <= w_min) {
+      reset();
+      return false;
+    }
+    build();
+    return true;
+  }
+
+  /** Forget all pushed k-mers, e.g. before starting a new sequence. */
+  void reset()
+  {
+    head = 0;
+    size = 0;
+  }
+
+  /** Hash value of the last randstrobe, combining both strobes. */
+  uint64_t get_hash() const { return strobe_hash; }
+
+  /** Position of the first strobe of the last randstrobe. */
+  size_t get_first_pos() const { return first_pos; }
+
+  /** Position of the second strobe of the last randstrobe. */
+  size_t get_second_pos() const { return second_pos; }
+
+  size_t get_w_min() const { return w_min; }
+  size_t get_w_max() const { return w_max; }
+
+private:
+  struct Entry
+  {
+    uint64_t hash;
+    size_t pos;
+  };
+
+  size_t slot(size_t i) const
+  {
+    return head + i < capacity ? head + i : head + i - capacity;
+  }
+
+  // Build the randstrobe of the oldest k-mer and drop it
+  void build()
+  {
+    const Entry& first = entries[head];
+    const Entry* second = &entries[slot(w_min)];
+    for (size_t i = w_min + 1; i < size; i++) {
+      const Entry& candidate = entries[slot(i)];
+      if ((first.hash ^ candidate.hash) < (first.hash ^ second->hash)) {
+        second = &candidate;
+      }
+    }
+    // Asymmetric, so that swapping the strobes changes the hash value
+    strobe_hash = first.hash / 2 + second->hash / 3;
+    first_pos = first.pos;
+    second_pos = second->pos;
+    head = head + 1 == capacity ? 0 : head + 1;
+    --size;
+  }
+
+  size_t w_min, w_max, capacity;
+  std::unique_ptr<Entry[]> entries;
+  size_t head = 0;
+  size_t size = 0;
+  uint64_t strobe_hash = 0;
+  size_t first_pos = 0;
+  size_t second_pos = 0;
+};
+
+/// @cond HIDDEN_SYMBOLS
+namespace sketch_internals {
+
+// Hashes the k-mers of a sequence alongside a hasher of shorter s-mers and
+// keeps the hash values of the last n k-mer positions
+class TrailingKmerHashes
+{
+public:
+  TrailingKmerHashes(const char* seq,
+                     size_t seq_len,
+                     hashing_internals::NUM_HASHES_TYPE num_hashes,
+                     hashing_internals::K_TYPE k,
+                     size_t n)
+    : nthash(seq, seq_len, num_hashes, k)
+    , n(n)
+    , hashes_buffer(n * num_hashes)
+  {
+  }
+
+  // Hash the k-mers up to the one at pos
+  void advance(size_t pos)
+  {
+    while (!rolled || nthash.get_pos() < pos) {
+      if (!nthash.roll()) {
+        return;
+      }
+      rolled = true;
+      std::copy_n(nthash.hashes(),
+                  nthash.get_hash_num(),
+                  hashes_buffer.data() +
+                    (nthash.get_pos() % n) * nthash.get_hash_num());
+    }
+  }
+
+  // Hash values of one of the last n k-mers hashed by advance()
+  const uint64_t* hashes(size_t pos) const
+  {
+    return hashes_buffer.data() + (pos % n) * nthash.get_hash_num();
+  }
+
+private:
+  NtHash nthash;
+  size_t n;
+  std::vector<uint64_t> hashes_buffer;
+  bool rolled = false;
+};
+
+} // namespace sketch_internals
+/// @endcond
+
+/**
+ * Find the window minimizers of a sequence, i.e. the k-mers selected by
+ * MinimizerSelector from the first hash values of NtHash.
+ * @param seq C-string containing sequence data
+ * @param seq_len Length of the sequence
+ * @param num_hashes Number of hashes to generate per k-mer
+ * @param k K-mer size
+ * @param w Number of k-mers per window
+ * @param f Function called as f(pos, hashes) for each minimizer, in order of
+ * position
+ */
+template<typename F>
+inline void
+for_each_minimizer(const char* seq,
+                   size_t seq_len,
+                   hashing_internals::NUM_HASHES_TYPE num_hashes,
+                   hashing_internals::K_TYPE k,
+                   size_t w,
+                   F f)
+{
+  MinimizerSelector selector(w);
+  std::vector<uint64_t> window_hashes(w * num_hashes);
+  size_t slot = 0;
+  for (NtHash nthash(seq, seq_len, num_hashes, k); nthash.roll();) {
+    std::copy_n(
+      nthash.hashes(), num_hashes, window_hashes.data() + slot * num_hashes);
+    slot = slot + 1 == w ? 0 : slot + 1;
+    if (selector.push(nthash.hashes()[0], nthash.get_pos())) {
+      f(selector.get_pos(),
+        window_hashes.data() + (selector.get_index() % w) * num_hashes);
+    }
+  }
+}
+
+/**
+ * Find the syncmers of a sequence, i.e. the k-mers selected by SyncmerSelector
+ * from the canonical hash values of their s-mers.
+ * @param seq C-string containing sequence data
+ * @param seq_len Length of the sequence
+ * @param num_hashes Number of hashes to generate per syncmer
+ * @param k K-mer size
+ * @param s S-mer size
+ * @param f Function called as f(pos, hashes) for each syncmer, in order of
+ * position
+ * @param type Syncmer type
+ * @param offset Offset of the smallest s-mer in open syncmers
+ */
+template<typename F>
+inline void
+for_each_syncmer(const char* seq,
+                 size_t seq_len,
+                 hashing_internals::NUM_HASHES_TYPE num_hashes,
+                 hashing_internals::K_TYPE k,
+                 hashing_internals::K_TYPE s,
+                 F f,
+                 SyncmerType type = SyncmerType::CLOSED,
+                 size_t offset = 0)
+{
+  SyncmerSelector selector(k, s, type, offset);
+  sketch_internals::TrailingKmerHashes kmers(seq, seq_len, num_hashes, k, 1);
+  for (NtHash smers(seq, seq_len, 1, s); smers.roll();) {
+    if (selector.push(smers.hashes()[0], smers.get_pos())) {
+      kmers.advance(selector.get_pos());
+      f(selector.get_pos(), kmers.hashes(selector.get_pos()));
+    }
+  }
+}
+
+/**
+ * Find the mod-minimizers of a sequence, i.e. the k-mers selected by
+ * ModMinimizerSelector from the canonical hash values of their t-mers.
+ * @param seq C-string containing sequence data
+ * @param seq_len Length of the sequence
+ * @param num_hashes Number of hashes to generate per mod-minimizer
+ * @param k K-mer size
+ * @param w Number of k-mers per window
+ * @param f Function called as f(pos, hashes) for each mod-minimizer
+ * @param r Minimum t-mer size
+ */
+template<typename F>
+inline void
+for_each_mod_minimizer(const char* seq,
+                       size_t seq_len,
+                       hashing_internals::NUM_HASHES_TYPE num_hashes,
+                       hashing_internals::K_TYPE k,
+                       size_t w,
+                       F f,
+                       size_t r = ModMinimizerSelector::DEFAULT_R)
+{
+  ModMinimizerSelector selector(k, w, r);
+  const auto t = hashing_internals::K_TYPE(selector.get_t());
+  sketch_internals::TrailingKmerHashes kmers(seq, seq_len, num_hashes, k, w);
+  for (NtHash tmers(seq, seq_len, 1, t); tmers.roll();) {
+    // The last k-mer of the window ends with the pushed t-mer
+    if (tmers.get_pos() + t >= k) {
+      kmers.advance(tmers.get_pos() + t - k);
+    }
+    if (selector.push(tmers.hashes()[0], tmers.get_pos())) {
+      f(selector.get_pos(), kmers.hashes(selector.get_pos()));
+    }
+  }
+}
+
+/**
+ * Build the order 2 randstrobes of a sequence from the canonical hash values
+ * of its k-mers. See RandstrobeSelector.
+ * @param seq C-string containing sequence data
+ * @param seq_len Length of the sequence
+ * @param k Strobe size
+ * @param w_min Offset of the first candidate for the second strobe
+ * @param w_max Offset of the last candidate for the second strobe
+ * @param f Function called as f(hash, first_pos, second_pos) for each
+ * randstrobe, in order of first strobe position
+ */
+template<typename F>
+inline void
+for_each_randstrobe(const char* seq,
+                    size_t seq_len,
+                    hashing_internals::K_TYPE k,
+                    size_t w_min,
+                    size_t w_max,
+                    F f)
+{
+  RandstrobeSelector selector(w_min, w_max);
+  for (NtHash nthash(seq, seq_len, 1, k); nthash.roll();) {
+    if (selector.push(nthash.hashes()[0], nthash.get_pos())) {
+      f(selector.get_hash(),
+        selector.get_first_pos(),
+        selector.get_second_pos());
+    }
+  }
+  while (selector.finish()) {
+    f(selector.get_hash(), selector.get_first_pos(), selector.get_second_pos());
+  }
+}
+
+} // namespace btllib
+
+#endif
@@ -0,0 +1,219 @@
+#include "btllib/bloom_filter.hpp"
+#include "btllib/counting_bloom_filter.hpp"
+#include "btllib/status.hpp"
+
+#include "config.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+#include <memory>
+#include <omp.h>
+#include <string>
+#include <vector>
+
+const static std::string PROGNAME = "cbf_merge";
+const static std::string VERSION = btllib::PROJECT_VERSION;
+const static unsigned DEFAULT_THREADS = 5;
+
+static void
+print_error_msg(const std::string& msg)
+{
+  std::cerr << PROGNAME << ' ' << VERSION << ": " << msg << std::endl;
+}
+
+static void
+print_usage()
+{
+  std::cerr
+    << "Usage: " << PROGNAME
+    << " -o OUTPUT [-m add|max] [-H HISTOGRAM] [-t T] FILE...\n\n"
+       "  -o OUTPUT   Write the merged counting Bloom filter to OUTPUT.\n"
+       "  -m MODE     Merge mode: 'add' sums counters (saturating), 'max' "
+       "keeps the\n"
+       "              largest counter. Default is 'add'.\n"
+       "  -H FILE     Write the counter histogram of the merged filter to "
+       "FILE as\n"
+       "              tab-separated count and frequency columns.\n"
+       "  -t T        Use T number of threads (default 5).\n"
+       "  -v          Show verbose output.\n"
+       "  --help      Display this help and exit.\n"
+       "  --version   Display version and exit.\n"
+       "  FILE        Space separated list of (k-mer) counting Bloom filter "
+       "files\n"
+       "              with identical size, hash number and counter size. "
+       "Only the\n"
+       "              first file is loaded into memory, the rest are streamed."
+    << std::endl;
+}
+
+template<typename BF>
+static void
+merge(const std::vector<std::string>& infiles,
+      const std::string& outfile,
+      const bool max_mode,
+      const std::string& histogram_file,
+      const bool verbose)
+{
+  if (verbose) {
+    btllib::log_info("Loading " + infiles.front());
+  }
+  BF merged(infiles.front());
+  for (size_t i = 1; i < infiles.size(); ++i) {
+    if (verbose) {
+      btllib::log_info("Merging " + infiles[i]);
+    }
+    if (max_mode) {
+      merged.max(infiles[i]);
+    } else {
+      merged.add(infiles[i]);
+    }
+  }
+  if (verbose) {
+    btllib::log_info("Saving merged filter to " + outfile);
+  }
+  merged.save(outfile);
+
+  if (!histogram_file.empty()) {
+    const auto histogram = merged.get_histogram();
+    std::ofstream ofs(histogram_file);
+    btllib::check_error(!ofs, "Failed to open " + histogram_file);
+    for (size_t count = 0; count < histogram.size(); ++count) {
+      if (histogram[count] > 0) {
+        ofs << count << '\t' << histogram[count] << '\n';
+      }
+    }
+  }
+}
+
+template<typename T>
+static void
+merge_dispatch_kmer(const bool kmer,
+                    const std::vector<std::string>& infiles,
+                    const std::string& outfile,
+                    const bool max_mode,
+                    const std::string& histogram_file,
+                    const bool verbose)
+{
+  if (kmer) {
+    merge<btllib::KmerCountingBloomFilter<T>>(
+      infiles, outfile, max_mode, histogram_file, verbose);
+  } else {
+    merge<btllib::CountingBloomFilter<T>>(
+      infiles, outfile, max_mode, histogram_file, verbose);
+  }
+}
+
+int
+main(int argc, char* argv[])
+{
+  try {
+    int c;
+    int optindex = 0;
+    int help = 0, version = 0;
+    bool verbose = false;
+    unsigned t = DEFAULT_THREADS;
+    std::string outfile, histogram_file, mode("add");
+    bool failed = false;
+    static const struct option longopts[] = {
+      { "help", no_argument, &help, 1 },
+      { "version", no_argument, &version, 1 },
+      { nullptr, 0, nullptr, 0 }
+    };
+    while ((c = getopt_long(argc, // NOLINT(concurrency-mt-unsafe)
+                            argv,
+                            "o:m:H:t:v",
+                            longopts,
+                            &optindex)) != -1) {
+      switch (c) {
+        case 0:
+          break;
+        case 'o':
+          outfile = optarg;
+          break;
+        case 'm':
+          mode = optarg;
+          break;
+        case 'H':
+          histogram_file = optarg;
+          break;
+        case 't':
+          t = std::stoul(optarg);
+          break;
+        case 'v':
+          verbose = true;
+          break;
+        default:
+          std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+      }
+    }
+    const std::vector<std::string> infiles(&argv[optind], &argv[argc]);
+    if (argc < 2) {
+      print_usage();
+      std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+    }
+    if (help != 0) {
+      print_usage();
+      std::exit(EXIT_SUCCESS); // NOLINT(concurrency-mt-unsafe)
+    } else if (version != 0) {
+      std::cerr << PROGNAME << ' ' << VERSION << std::endl;
+      std::exit(EXIT_SUCCESS); // NOLINT(concurrency-mt-unsafe)
+    }
+    if (outfile.empty()) {
+      print_error_msg("missing option -- 'o'");
+      failed = true;
+    }
+    if (mode != "add" && mode != "max") {
+      print_error_msg("option has incorrect value -- 'm'");
+      failed = true;
+    }
+    if (t == 0) {
+      print_error_msg("option has incorrect value -- 't'");
+      failed = true;
+    }
+    if (infiles.empty()) {
+      print_error_msg("missing file operand");
+      failed = true;
+    }
+    if (failed) {
+      std::cerr << "Try '" << PROGNAME << " --help' for more information.\n";
+      std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+    }
+
+    omp_set_num_threads(int(t));
+
+    const bool kmer = btllib::BloomFilter::check_file_signature(
+      infiles.front(), btllib::KMER_COUNTING_BLOOM_FILTER_SIGNATURE);
+    const auto bfi = std::make_shared<btllib::BloomFilterInitializer>(
+      infiles.front(),
+      kmer ? btllib::KMER_COUNTING_BLOOM_FILTER_SIGNATURE
+           : btllib::COUNTING_BLOOM_FILTER_SIGNATURE);
+    const auto counter_bits = *(bfi->table->get_as<size_t>("counter_bits"));
+    const bool max_mode = mode == "max";
+    switch (counter_bits) {
+      case 8:
+        merge_dispatch_kmer<uint8_t>(
+          kmer, infiles, outfile, max_mode, histogram_file, verbose);
+        break;
+      case 16:
+        merge_dispatch_kmer<uint16_t>(
+          kmer, infiles, outfile, max_mode, histogram_file, verbose);
+        break;
+      case 32:
+        merge_dispatch_kmer<uint32_t>(
+          kmer, infiles, outfile, max_mode, histogram_file, verbose);
+        break;
+      default:
+        btllib::log_error("Unsupported counter size: " +
+                          std::to_string(counter_bits));
+        std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << '\n';
+    std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
+  }
+
+  return 0;
+}
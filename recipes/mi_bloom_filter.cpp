@@ -1,4 +1,5 @@
 #include "btllib/mi_bloom_filter.hpp"
+#include "btllib/mi_bloom_filter_builder.hpp"
 #include "btllib/nthash.hpp" //parse_seeds
 #include "btllib/seq_reader.hpp"
 #include "btllib/status.hpp"
@@ -8,6 +9,7 @@
 #include <omp.h>
 
 #include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -17,6 +19,7 @@ const static size_t DEFAULT_THREADS = 5;
 const static size_t DEFAULT_SIZE = 1000000000;
 const static double DEFAULT_OCCUPANCY = 0.5;
 const static size_t DEFAULT_SEQ_READER_THREADS = 6;
+const static size_t DEFAULT_CACHE_MB = 1024;
 
 using ID_type = uint16_t;
 using SpacedSeed = std::vector<unsigned>;
@@ -46,6 +49,16 @@ print_usage()
        "                     required if '-m' is not given.\n"
        "--------------------------------------------------------------\n"
        "  -f by_file         assign IDs by file rather than by fasta header.\n"
+       "  -c cache_mb        memory budget in MiB for cached k-mer hashes,\n"
+       "                     beyond which they are spilled to disk. Default is\n"
+       "                     1024.\n"
+       "  -d spill_dir       directory for spilled k-mer hashes, default is\n"
+       "                     $TMPDIR or /tmp.\n"
+       "  --single-file      store the filter in a single memory-mappable file\n"
+       "                     instead of a filter and an .sdsl file.\n"
+       "  --compact          pack the ID array into the minimum number of "
+       "bits.\n"
+       "                     Requires '--single-file'.\n"
        "  -t threads         number of threads (default 5, max 32)\n"
        "  -v verbose         show verbose output.\n"
        "  --help             display this help and exit.\n"
@@ -67,60 +80,6 @@ split_string_by_space(const std::string& input_string)
   return current_string;
 }
 
-static unsigned
-assert_id_size_and_count_kmers(const std::vector<std::string>& read_paths,
-                               const bool& by_file,
-                               const unsigned& kmer_size)
-{
-  unsigned total_id = 0;
-  unsigned expected_elements = 0;
-
-  for (const auto& read_path : read_paths) {
-    btllib::SeqReader reader(read_path, btllib::SeqReader::Flag::SHORT_MODE);
-    for (const auto& record : reader) {
-      if (!by_file && !record.seq.empty()) {
-        total_id++;
-      }
-    }
-  }
-
-  for (const auto& read_path : read_paths) {
-    btllib::SeqReader reader(read_path, btllib::SeqReader::Flag::SHORT_MODE);
-    if (by_file) {
-      total_id++;
-    }
-    for (const auto& record : reader) {
-      if (!by_file) {
-        total_id++;
-      }
-      expected_elements +=
-        record.seq.size() > kmer_size ? record.seq.size() - kmer_size : 0;
-    }
-  }
-  btllib::check_error(
-    !(total_id < static_cast<unsigned>(std::numeric_limits<ID_type>::max())),
-    "Total ID number overflows ID type.");
-  return expected_elements;
-}
-
-template<typename T>
-inline void
-insert_to_bv(btllib::MIBloomFilter<ID_type>& mi_bf,
-             T& nthash,
-             int& mi_bf_stage,
-             ID_type& id)
-{
-  while (nthash.roll()) {
-    if (mi_bf_stage == 0) {
-      mi_bf.insert_bv(nthash.hashes());
-    } else if (mi_bf_stage == 1) {
-      mi_bf.insert_id(nthash.hashes(), id);
-    } else if (mi_bf_stage == 2) {
-      mi_bf.insert_saturation(nthash.hashes(), id);
-    }
-  }
-}
-
 int
 main(int argc, char* argv[])
 {
@@ -129,19 +88,20 @@ main(int argc, char* argv[])
     bool failed = false;
     int optindex = 0;
     // static int version = 0;
-    static int help = 0, version = 0;
+    static int help = 0, version = 0, single_file = 0, compact = 0;
     bool verbose = false;
     int thread_count = DEFAULT_THREADS;
     double occupancy = DEFAULT_OCCUPANCY;
-    unsigned mi_bf_size = DEFAULT_SIZE, kmer_size = 0, hash_num = 0,
-             expected_elements = 0;
+    size_t mi_bf_size = DEFAULT_SIZE, expected_elements = 0,
+           cache_mb = DEFAULT_CACHE_MB;
+    unsigned kmer_size = 0, hash_num = 0;
 
     bool spaced_seed_set = false;
     bool output_path_set = false;
     bool by_file = false;
     bool occupancy_set = false;
 
-    std::string output_path;
+    std::string output_path, spill_dir;
 
     std::vector<std::string> spaced_seeds_string;
     std::vector<SpacedSeed> spaced_seeds;
@@ -149,12 +109,14 @@ main(int argc, char* argv[])
     static const struct option longopts[] = {
       { "help", no_argument, &help, 1 },
       { "version", no_argument, &version, 1 },
+      { "single-file", no_argument, &single_file, 1 },
+      { "compact", no_argument, &compact, 1 },
       { nullptr, 0, nullptr, 0 }
     };
 
     while ((c = getopt_long(argc, // NOLINT(concurrency-mt-unsafe)
                             argv,
-                            "p:k:g:s:m:n:b:ft:v",
+                            "p:k:g:s:m:n:b:fc:d:t:v",
                             longopts,
                             &optindex)) != -1) {
       switch (c) {
@@ -184,6 +146,12 @@ main(int argc, char* argv[])
         case 'f':
           by_file = true;
           break;
+        case 'c':
+          cache_mb = std::stoul(optarg);
+          break;
+        case 'd':
+          spill_dir = optarg;
+          break;
         case 'm':
           mi_bf_size = std::stoul(optarg);
           break;
@@ -212,6 +180,10 @@ main(int argc, char* argv[])
       btllib::log_error("missing option -- 'p'");
       failed = true;
     }
+    if (!failed && compact != 0 && single_file == 0) {
+      btllib::log_error("option '--compact' requires '--single-file'");
+      failed = true;
+    }
     if (verbose) {
       std::cout << "verbose" << std::endl;
     }
@@ -222,15 +194,14 @@ main(int argc, char* argv[])
       print_usage();
       std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
     }
-    const std::map<std::string, ID_type> read_ids;
-    const unsigned kmer_count =
-      assert_id_size_and_count_kmers(read_paths, by_file, kmer_size);
-
-    if (expected_elements > 0 || occupancy_set) {
+    if (expected_elements > 0) {
       mi_bf_size = btllib::MIBloomFilter<ID_type>::calc_optimal_size(
-        kmer_count, hash_num, occupancy);
+        expected_elements, hash_num, occupancy);
       btllib::log_info("Optimal size is calculated: " +
                        std::to_string(mi_bf_size));
+    } else if (occupancy_set) {
+      // Calculated by the builder from the number of k-mers read
+      mi_bf_size = 0;
     }
 
     // set thread number configuration
@@ -240,66 +211,43 @@ main(int argc, char* argv[])
     }
 #endif
 
-    btllib::MIBloomFilter<ID_type> mi_bf(mi_bf_size, hash_num);
-    const char* stages[3] = { "BV Insertion", "ID Insertion", "Saturation" };
-    ID_type id_counter = 0;
-    std::map<std::string, ID_type> ids;
-    for (int mi_bf_stage = 0; mi_bf_stage < 3; mi_bf_stage++) {
-      btllib::log_info(stages[mi_bf_stage] + std::string(" stage started"));
-
-      for (const auto& read_path : read_paths) {
-        btllib::SeqReader reader(read_path,
-                                 btllib::SeqReader::Flag::SHORT_MODE,
-                                 DEFAULT_SEQ_READER_THREADS);
-#pragma omp parallel default(none) shared(ids,                                 \
-                                            id_counter,                        \
-                                            mi_bf,                             \
-                                            mi_bf_stage,                       \
-                                            hash_num,                          \
-                                            kmer_size,                         \
-                                            by_file,                           \
-                                            spaced_seed_set,                   \
-                                            spaced_seeds,                      \
-                                            reader)
-        try {
-          for (const auto record : reader) {
-#pragma omp critical
-            {
-              if (ids.find(record.id) == ids.end()) {
-                ids[record.id] = !by_file ? id_counter++ : id_counter;
-              }
-            }
-            if (spaced_seed_set) {
-              btllib::SeedNtHash nthash(record.seq, spaced_seeds, 1, kmer_size);
-              insert_to_bv<btllib::SeedNtHash>(
-                mi_bf, nthash, mi_bf_stage, ids[record.id]);
-            } else {
-              btllib::NtHash nthash(record.seq, hash_num, kmer_size);
-              insert_to_bv<btllib::NtHash>(
-                mi_bf, nthash, mi_bf_stage, ids[record.id]);
-            }
-          }
-          if (by_file) {
-            id_counter++;
-          }
-        } catch (const std::exception& e) {
-          btllib::log_error(e.what());
-          std::exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
-        }
-      }
-      if (mi_bf_stage == 0) {
-        mi_bf.complete_bv_insertion();
-      }
-      if (mi_bf_stage == 1) {
-        mi_bf.complete_id_insertion();
-      }
+    const unsigned flags =
+      by_file ? btllib::MIBloomFilterBuilder<ID_type>::Flag::BY_FILE : 0;
+    std::unique_ptr<btllib::MIBloomFilterBuilder<ID_type>> builder;
+    if (spaced_seed_set) {
+      builder = std::unique_ptr< // NOLINT(modernize-make-unique)
+        btllib::MIBloomFilterBuilder<ID_type>>(
+        new btllib::MIBloomFilterBuilder<ID_type>(read_paths,
+                                                  spaced_seeds_string,
+                                                  flags,
+                                                  cache_mb * 1024 * 1024,
+                                                  spill_dir,
+                                                  DEFAULT_SEQ_READER_THREADS));
+    } else {
+      builder = std::unique_ptr< // NOLINT(modernize-make-unique)
+        btllib::MIBloomFilterBuilder<ID_type>>(
+        new btllib::MIBloomFilterBuilder<ID_type>(read_paths,
+                                                  hash_num,
+                                                  kmer_size,
+                                                  flags,
+                                                  cache_mb * 1024 * 1024,
+                                                  spill_dir,
+                                                  DEFAULT_SEQ_READER_THREADS));
+    }
+    const auto mi_bf = builder->build(mi_bf_size, occupancy);
+    if (compact != 0) {
+      mi_bf->compact(true);
+      btllib::log_info("ID array packed to " +
+                       std::to_string(mi_bf->get_id_width()) +
+                       " bits per entry");
     }
-    mi_bf.save(output_path);
+    mi_bf->save(output_path, bool(single_file));
 
     std::ofstream ids_file;
     ids_file.open(output_path + ".ids");
-    for (auto& elem : ids) {
-      ids_file << elem.first << "\t" << elem.second << std::endl;
+    const auto& id_names = builder->get_id_names();
+    for (size_t id = 0; id < id_names.size(); ++id) {
+      ids_file << id_names[id] << "\t" << id << std::endl;
     }
     ids_file.close();
     return 0;
@@ -34,21 +34,45 @@ roll_hash(uint64_t hash_value,
   return hash_value;
 }
 
+// Term of an amino acid in the hash value of a seed, 0 for level 0
 inline uint64_t
-modify_base_with_seed(uint64_t hash_value,
-                      const btllib::SpacedSeed& seed,
-                      const char* kmer_seq,
-                      const unsigned k)
+seed_term(unsigned char c, unsigned level, unsigned rot)
 {
+  return level == 0 ? 0 : AA_ROLL_TABLE(c, level, rot);
+}
+
+// Hash value of a k-mer with each amino acid hashed at the level given by the
+// seed, leaving out those at level 0
+inline uint64_t
+seed_hash(const btllib::SpacedSeed& seed, const char* kmer_seq, unsigned k)
+{
+  uint64_t hash_value = 0;
   for (unsigned i = 0; i < k; i++) {
-    if (seed[i] != 1) {
-      hash_value ^= AA_ROLL_TABLE((unsigned char)kmer_seq[i], 1, k - 1 - i);
-      if (seed[i] != 0) {
-        const unsigned level = seed[i];
-        hash_value ^=
-          AA_ROLL_TABLE((unsigned char)kmer_seq[i], level, k - 1 - i);
-      }
-    }
+    hash_value ^= seed_term(kmer_seq[i], seed[i], k - 1 - i);
+  }
+  return hash_value;
+}
+
+// Roll the hash value of a seed to the next k-mer, with the tables made by
+// SeedAAHash::init(). Every amino acid moves one position to the left, so
+// only those that land on a position with a different level than the one
+// they came from need their terms corrected.
+inline uint64_t
+roll_seed_hash(uint64_t hash_value,
+               const uint64_t* roll_table,
+               const std::vector<unsigned>& level_changes,
+               const char* kmer_seq,
+               unsigned char char_out,
+               unsigned k)
+{
+  const unsigned ascii_size = btllib::hashing_internals::ASCII_SIZE;
+  hash_value = srol(hash_value);
+  hash_value ^= roll_table[char_out];
+  hash_value ^= roll_table[ascii_size + (unsigned char)kmer_seq[k - 1]];
+  roll_table += 2 * ascii_size;
+  for (const unsigned i : level_changes) {
+    hash_value ^= roll_table[(unsigned char)kmer_seq[i]];
+    roll_table += ascii_size;
   }
   return hash_value;
 }
@@ -58,9 +82,20 @@ modify_base_with_seed(uint64_t hash_value,
 namespace btllib {
 
 using hashing_internals::extend_hashes;
+using hashing_internals::extend_hashes_batch;
 
 bool
 AAHash::init()
+{
+  if (!init_base()) {
+    return false;
+  }
+  extend_hashes(hash_value, k, hash_num, hashes_array.get());
+  return true;
+}
+
+bool
+AAHash::init_base()
 {
   if (k > seq_len) {
     pos = std::numeric_limits<std::size_t>::max();
@@ -70,17 +105,26 @@ AAHash::init()
     pos = std::numeric_limits<std::size_t>::max();
     return false;
   }
-  const uint64_t hash_value = base_hash(seq + pos, k, level);
-  extend_hashes(hash_value, k, hash_num, hashes_array.get());
+  hash_value = base_hash(seq + pos, k, level);
   initialized = true;
   return true;
 }
 
 bool
 AAHash::roll()
+{
+  if (!roll_base()) {
+    return false;
+  }
+  extend_hashes(hash_value, k, hash_num, hashes_array.get());
+  return true;
+}
+
+bool
+AAHash::roll_base()
 {
   if (!initialized) {
-    return init();
+    return init_base();
   }
   if (pos >= seq_len - k) {
     pos = std::numeric_limits<std::size_t>::max();
@@ -89,26 +133,85 @@ AAHash::roll()
   if (hashing_internals::AA_SEED_TABLE[(unsigned char)(seq[pos + k])] ==
       hashing_internals::AA_SEED__) {
     pos += k;
-    return init();
+    return init_base();
   }
-  const uint64_t hash_value =
-    roll_hash(hashes_array[0], k, seq[pos], seq[pos + k], level);
-  extend_hashes(hash_value, k, hash_num, hashes_array.get());
+  hash_value = roll_hash(hash_value, k, seq[pos], seq[pos + k], level);
   ++pos;
   return true;
 }
 
+size_t
+AAHash::roll_batch(const size_t n,
+                   uint64_t* hashes,
+                   const size_t stride,
+                   size_t* positions)
+{
+  // AAHash has a single strand, so the hash values are extended as forward
+  // hash values with reverse hash values of 0
+  uint64_t base_hashes[BATCH_SIZE];
+  const uint64_t zeros[BATCH_SIZE] = {};
+  size_t hashed = 0;
+  bool more = true;
+  while (more && hashed < n) {
+    size_t batch = 0;
+    while (batch < BATCH_SIZE && hashed + batch < n) {
+      if (!roll_base()) {
+        more = false;
+        break;
+      }
+      base_hashes[batch] = hash_value;
+      if (positions != nullptr) {
+        positions[hashed + batch] = pos;
+      }
+      ++batch;
+    }
+    extend_hashes_batch(
+      base_hashes, zeros, batch, k, hash_num, hashes + hashed * stride, stride);
+    hashed += batch;
+  }
+  if (hashed > 0) {
+    std::memcpy(hashes_array.get(),
+                hashes + (hashed - 1) * stride,
+                hash_num * sizeof(uint64_t));
+  }
+  return hashed;
+}
+
+bool
+SeedAAHash::roll_base()
+{
+  const bool was_initialized = aahash.initialized;
+  const size_t prev_pos = aahash.pos;
+  if (!aahash.roll_base()) {
+    return false;
+  }
+  const char* const kmer_seq = aahash.seq + aahash.pos;
+  if (was_initialized && aahash.pos == prev_pos + 1) {
+    for (size_t i = 0; i < seeds.size(); ++i) {
+      seed_hashes[i] = roll_seed_hash(seed_hashes[i],
+                                      roll_tables[i].data(),
+                                      level_changes[i],
+                                      kmer_seq,
+                                      aahash.seq[prev_pos],
+                                      aahash.k);
+    }
+  } else {
+    for (size_t i = 0; i < seeds.size(); ++i) {
+      seed_hashes[i] = seed_hash(seeds[i], kmer_seq, aahash.k);
+    }
+  }
+  return true;
+}
+
 bool
 SeedAAHash::roll()
 {
-  if (!aahash.roll()) {
+  if (!roll_base()) {
     return false;
   }
 
   for (size_t i = 0; i < seeds.size(); ++i) {
-    hashes_array[i * hash_num_per_seed] = modify_base_with_seed(
-      aahash.hashes_array[0], seeds[i], aahash.seq + aahash.pos, aahash.k);
-    extend_hashes(hashes_array[i * hash_num_per_seed],
+    extend_hashes(seed_hashes[i],
                   aahash.k,
                   hash_num_per_seed,
                   hashes_array.get() + i * hash_num_per_seed);
@@ -117,6 +220,50 @@ SeedAAHash::roll()
   return true;
 }
 
+size_t
+SeedAAHash::roll_batch(const size_t n,
+                       uint64_t* hashes,
+                       const size_t stride,
+                       size_t* positions)
+{
+  const size_t batch_size = AAHash::BATCH_SIZE;
+  const uint64_t zeros[AAHash::BATCH_SIZE] = {};
+  size_t hashed = 0;
+  bool more = true;
+  while (more && hashed < n) {
+    size_t batch = 0;
+    while (batch < batch_size && hashed + batch < n) {
+      if (!roll_base()) {
+        more = false;
+        break;
+      }
+      for (size_t i = 0; i < seeds.size(); ++i) {
+        batch_hashes[i * batch_size + batch] = seed_hashes[i];
+      }
+      if (positions != nullptr) {
+        positions[hashed + batch] = aahash.pos;
+      }
+      ++batch;
+    }
+    for (size_t i = 0; i < seeds.size(); ++i) {
+      extend_hashes_batch(batch_hashes.data() + i * batch_size,
+                          zeros,
+                          batch,
+                          aahash.k,
+                          hash_num_per_seed,
+                          hashes + hashed * stride + i * hash_num_per_seed,
+                          stride);
+    }
+    hashed += batch;
+  }
+  if (hashed > 0) {
+    std::memcpy(hashes_array.get(),
+                hashes + (hashed - 1) * stride,
+                seeds.size() * hash_num_per_seed * sizeof(uint64_t));
+  }
+  return hashed;
+}
+
 bool
 SeedAAHash::verify_seed()
 {
@@ -142,5 +289,144 @@ SeedAAHash::init()
     throw std::runtime_error(
       "Invalid seed. Seed values must be 0, 1, 2, or 3.");
   }
+  const unsigned k = aahash.k;
+  const unsigned ascii_size = hashing_internals::ASCII_SIZE;
+  seed_hashes.resize(seeds.size());
+  level_changes.resize(seeds.size());
+  roll_tables.resize(seeds.size());
+  for (size_t i = 0; i < seeds.size(); ++i) {
+    const SpacedSeed& seed = seeds[i];
+    for (unsigned j = 0; j + 1 < k; ++j) {
+      if (seed[j] != seed[j + 1]) {
+        level_changes[i].push_back(j);
+      }
+    }
+    auto& table = roll_tables[i];
+    table.resize((2 + level_changes[i].size()) * ascii_size);
+    for (unsigned c = 0; c < ascii_size; ++c) {
+      table[c] = seed_term(c, seed[0], k);
+      table[ascii_size + c] = seed_term(c, seed[k - 1], 0);
+      for (size_t j = 0; j < level_changes[i].size(); ++j) {
+        const unsigned pos = level_changes[i][j];
+        const unsigned rot = k - 1 - pos;
+        table[(2 + j) * ascii_size + c] =
+          seed_term(c, seed[pos], rot) ^ seed_term(c, seed[pos + 1], rot);
+      }
+    }
+  }
+  batch_hashes.resize(seeds.size() * AAHash::BATCH_SIZE);
 }
+
+bool
+MultiLevelAAHash::init_base()
+{
+  if (aahash.k > aahash.seq_len || aahash.pos > aahash.seq_len - aahash.k) {
+    aahash.pos = std::numeric_limits<std::size_t>::max();
+    return false;
+  }
+  const char* const kmer_seq = aahash.seq + aahash.pos;
+  uint64_t hash_values[NUM_LEVELS] = {};
+  for (unsigned i = 0; i < aahash.k; i++) {
+    const auto c = (unsigned char)kmer_seq[i];
+    for (unsigned level = 0; level < NUM_LEVELS; ++level) {
+      hash_values[level] = srol(hash_values[level]);
+      hash_values[level] ^= LEVEL_X_AA_SEED_TABLE[level + 1][c];
+    }
+  }
+  std::memcpy(level_hashes, hash_values, sizeof(level_hashes));
+  aahash.initialized = true;
+  return true;
+}
+
+bool
+MultiLevelAAHash::roll_base()
+{
+  if (!aahash.initialized) {
+    return init_base();
+  }
+  const size_t pos = aahash.pos;
+  if (pos >= aahash.seq_len - aahash.k) {
+    aahash.pos = std::numeric_limits<std::size_t>::max();
+    return false;
+  }
+  const auto char_out = (unsigned char)aahash.seq[pos];
+  const auto char_in = (unsigned char)aahash.seq[pos + aahash.k];
+  if (hashing_internals::AA_SEED_TABLE[char_in] ==
+      hashing_internals::AA_SEED__) {
+    aahash.pos += aahash.k;
+    return init_base();
+  }
+  // All levels roll the same characters by the same rotation, which is
+  // reduced modulo the table sizes once in the constructor
+  for (unsigned level = 0; level < NUM_LEVELS; ++level) {
+    const uint64_t out_term =
+      LEVEL_X_AA_SEED_LEFT_31BITS_ROLL_TABLE[level + 1][char_out][rot_31] |
+      LEVEL_X_AA_SEED_RIGHT_33BITS_ROLL_TABLE[level + 1][char_out][rot_33];
+    level_hashes[level] = srol(level_hashes[level]) ^
+                          LEVEL_X_AA_SEED_TABLE[level + 1][char_in] ^ out_term;
+  }
+  aahash.pos = pos + 1;
+  return true;
+}
+
+bool
+MultiLevelAAHash::roll()
+{
+  if (!roll_base()) {
+    return false;
+  }
+  for (unsigned level = 0; level < NUM_LEVELS; ++level) {
+    extend_hashes(level_hashes[level],
+                  aahash.k,
+                  aahash.hash_num,
+                  hashes_array.get() + level * aahash.hash_num);
+  }
+  return true;
+}
+
+size_t
+MultiLevelAAHash::roll_batch(const size_t n,
+                             uint64_t* hashes,
+                             const size_t stride,
+                             size_t* positions)
+{
+  const size_t batch_size = AAHash::BATCH_SIZE;
+  uint64_t batch_hashes[NUM_LEVELS][AAHash::BATCH_SIZE];
+  const uint64_t zeros[AAHash::BATCH_SIZE] = {};
+  size_t hashed = 0;
+  bool more = true;
+  while (more && hashed < n) {
+    size_t batch = 0;
+    while (batch < batch_size && hashed + batch < n) {
+      if (!roll_base()) {
+        more = false;
+        break;
+      }
+      for (unsigned level = 0; level < NUM_LEVELS; ++level) {
+        batch_hashes[level][batch] = level_hashes[level];
+      }
+      if (positions != nullptr) {
+        positions[hashed + batch] = aahash.pos;
+      }
+      ++batch;
+    }
+    for (unsigned level = 0; level < NUM_LEVELS; ++level) {
+      extend_hashes_batch(batch_hashes[level],
+                          zeros,
+                          batch,
+                          aahash.k,
+                          aahash.hash_num,
+                          hashes + hashed * stride + level * aahash.hash_num,
+                          stride);
+    }
+    hashed += batch;
+  }
+  if (hashed > 0) {
+    std::memcpy(hashes_array.get(),
+                hashes + (hashed - 1) * stride,
+                NUM_LEVELS * aahash.hash_num * sizeof(uint64_t));
+  }
+  return hashed;
+}
+
 } // namespace btllib
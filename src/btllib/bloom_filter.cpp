@@ -67,6 +67,24 @@ BloomFilter::contains(const uint64_t* hashes) const
   return true;
 }
 
+unsigned
+BloomFilter::contains_batch(const uint64_t* hashes, const unsigned n) const
+{
+  check_error(n > CHAR_BIT * sizeof(unsigned),
+              "BloomFilter: contains_batch() can check at most 32 elements "
+              "at once.");
+  for (unsigned i = 0; i < n * hash_num; ++i) {
+    __builtin_prefetch(&array[(hashes[i] % array_bits) / CHAR_BIT]);
+  }
+  unsigned found = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    if (contains(hashes + i * hash_num)) {
+      found |= 1U << i;
+    }
+  }
+  return found;
+}
+
 bool
 BloomFilter::contains_insert(const uint64_t* hashes)
 {
@@ -253,6 +271,18 @@ KmerBloomFilter::insert(const char* seq, size_t seq_len)
   }
 }
 
+void
+KmerBloomFilter::insert_parallel(const char* seq, size_t seq_len)
+{
+  hash_parallel(seq,
+                seq_len,
+                get_hash_num(),
+                get_k(),
+                [&](size_t /*pos*/, const uint64_t* hashes) {
+                  bloom_filter.insert(hashes);
+                });
+}
+
 unsigned
 KmerBloomFilter::contains(const char* seq, size_t seq_len) const
 {
@@ -266,6 +296,32 @@ KmerBloomFilter::contains(const char* seq, size_t seq_len) const
   return count;
 }
 
+unsigned
+KmerBloomFilter::contains_successors(const BlindNtHash& nthash) const
+{
+  check_error(nthash.get_k() != get_k(),
+              "KmerBloomFilter: BlindNtHash k does not match the filter.");
+  check_error(nthash.get_hash_num() != get_hash_num(),
+              "KmerBloomFilter: BlindNtHash hash number does not match the "
+              "filter.");
+  uint64_t hashes[4 * MAX_HASH_VALUES];
+  nthash.peek_all_successors(hashes);
+  return bloom_filter.contains_batch(hashes, 4);
+}
+
+unsigned
+KmerBloomFilter::contains_predecessors(const BlindNtHash& nthash) const
+{
+  check_error(nthash.get_k() != get_k(),
+              "KmerBloomFilter: BlindNtHash k does not match the filter.");
+  check_error(nthash.get_hash_num() != get_hash_num(),
+              "KmerBloomFilter: BlindNtHash hash number does not match the "
+              "filter.");
+  uint64_t hashes[4 * MAX_HASH_VALUES];
+  nthash.peek_all_predecessors(hashes);
+  return bloom_filter.contains_batch(hashes, 4);
+}
+
 unsigned
 KmerBloomFilter::contains_insert(const char* seq, size_t seq_len)
 {
@@ -324,6 +380,18 @@ KmerBloomFilter::save(const std::string& path)
                     bloom_filter.array_size * sizeof(bloom_filter.array[0]));
 }
 
+static void
+check_seed_sizes(const std::vector<std::string>& seeds, unsigned k)
+{
+  check_error(seeds.empty(), "SeedBloomFilter: no spaced seeds passed");
+  for (const auto& seed : seeds) {
+    check_error(k != seed.size(),
+                "SeedBloomFilter: passed k (" + std::to_string(k) +
+                  ") not equal to passed spaced seed size (" +
+                  std::to_string(seed.size()) + ")");
+  }
+}
+
 SeedBloomFilter::SeedBloomFilter(size_t bytes,
                                  unsigned k,
                                  const std::vector<std::string>& seeds,
@@ -332,19 +400,14 @@ SeedBloomFilter::SeedBloomFilter(size_t bytes,
   , parsed_seeds(parse_seeds(seeds))
   , kmer_bloom_filter(bytes, hash_num_per_seed, k)
 {
-  for (const auto& seed : seeds) {
-    check_error(k != seed.size(),
-                "SeedBloomFilter: passed k (" + std::to_string(k) +
-                  ") not equal to passed spaced seed size (" +
-                  std::to_string(seed.size()) + ")");
-  }
+  check_seed_sizes(seeds, k);
+  seed_blocks = std::make_shared<const ParsedSeeds>(parsed_seeds, k);
 }
 
 void
 SeedBloomFilter::insert(const char* seq, size_t seq_len)
 {
-  SeedNtHash nthash(
-    seq, seq_len, parsed_seeds, get_hash_num_per_seed(), get_k());
+  SeedNtHash nthash(seq, seq_len, seed_blocks, get_hash_num_per_seed());
   while (nthash.roll()) {
     for (size_t s = 0; s < seeds.size(); s++) {
       kmer_bloom_filter.bloom_filter.insert(nthash.hashes() +
@@ -357,8 +420,7 @@ std::vector<std::vector<unsigned>>
 SeedBloomFilter::contains(const char* seq, size_t seq_len) const
 {
   std::vector<std::vector<unsigned>> hit_seeds;
-  SeedNtHash nthash(
-    seq, seq_len, parsed_seeds, get_hash_num_per_seed(), get_k());
+  SeedNtHash nthash(seq, seq_len, seed_blocks, get_hash_num_per_seed());
   while (nthash.roll()) {
     hit_seeds.emplace_back();
     for (size_t s = 0; s < seeds.size(); s++) {
@@ -375,8 +437,7 @@ std::vector<std::vector<unsigned>>
 SeedBloomFilter::contains_insert(const char* seq, size_t seq_len)
 {
   std::vector<std::vector<unsigned>> hit_seeds;
-  SeedNtHash nthash(
-    seq, seq_len, parsed_seeds, get_hash_num_per_seed(), get_k());
+  SeedNtHash nthash(seq, seq_len, seed_blocks, get_hash_num_per_seed());
   while (nthash.roll()) {
     hit_seeds.emplace_back();
     for (size_t s = 0; s < seeds.size(); s++) {
@@ -410,6 +471,9 @@ SeedBloomFilter::SeedBloomFilter(
   , parsed_seeds(parse_seeds(seeds))
   , kmer_bloom_filter(bfi)
 {
+  check_seed_sizes(seeds, kmer_bloom_filter.get_k());
+  seed_blocks =
+    std::make_shared<const ParsedSeeds>(parsed_seeds, kmer_bloom_filter.get_k());
 }
 
 void
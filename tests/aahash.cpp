@@ -295,5 +295,135 @@ main()
       seedaahashmultilvlACDEFGHIKLMNPQRSTVWYCGASNEKIFHPCGTDKIFHP.hashes()[i]);
   }
 
+  PRINT_TEST_NAME("incremental seed rolling")
+  const std::string long_seq =
+    "MKTAYIAKQRQISFVKSHFSRQLEERLGLIEVQAPILSRVGDGTQDNLSGAEKAVQVKVKALPDAQ";
+  const std::vector<std::string> long_seeds = { "1111011111102222",
+                                                "3300112233001122",
+                                                "1111111111111111",
+                                                "0000000000000003" };
+  const unsigned long_k = long_seeds[0].size();
+  btllib::SeedAAHash rolled(long_seq, long_seeds, h, long_k);
+  while (rolled.roll()) {
+    btllib::SeedAAHash fresh(
+      long_seq, long_seeds, h, long_k, rolled.get_pos());
+    TEST_ASSERT(fresh.roll());
+    for (size_t i = 0; i < long_seeds.size() * h; ++i) {
+      TEST_ASSERT_EQ(rolled.hashes()[i], fresh.hashes()[i]);
+    }
+  }
+
+  PRINT_TEST_NAME("batch rolling")
+  std::string batch_seq;
+  for (unsigned i = 0; i < 5; ++i) {
+    batch_seq += long_seq;
+  }
+  batch_seq[100] = 'X';
+  batch_seq[200] = '*';
+  {
+    btllib::AAHash single(batch_seq, h, long_k, 2);
+    btllib::AAHash batched(batch_seq, h, long_k, 2);
+    const size_t stride = h + 1;
+    std::vector<uint64_t> batch_hashes(100 * stride);
+    std::vector<size_t> positions(100);
+    size_t hashed = 0;
+    while ((hashed = batched.roll_batch(
+              100, batch_hashes.data(), stride, positions.data())) > 0) {
+      for (size_t j = 0; j < hashed; ++j) {
+        TEST_ASSERT(single.roll());
+        TEST_ASSERT_EQ(positions[j], single.get_pos());
+        for (unsigned i = 0; i < h; ++i) {
+          TEST_ASSERT_EQ(batch_hashes[j * stride + i], single.hashes()[i]);
+        }
+      }
+      // A short batch ends with a failed roll
+      if (hashed < 100) {
+        TEST_ASSERT(!single.roll());
+      }
+      TEST_ASSERT_EQ(batched.get_pos(), single.get_pos());
+      TEST_ASSERT_EQ(batched.hashes()[0], single.hashes()[0]);
+    }
+    TEST_ASSERT(!single.roll());
+  }
+  {
+    btllib::SeedAAHash single(batch_seq, long_seeds, h, long_k);
+    btllib::SeedAAHash batched(batch_seq, long_seeds, h, long_k);
+    const size_t num_hashes = long_seeds.size() * h;
+    std::vector<uint64_t> batch_hashes(70 * num_hashes);
+    size_t hashed = 0;
+    while ((hashed = batched.roll_batch(
+              70, batch_hashes.data(), num_hashes)) > 0) {
+      for (size_t j = 0; j < hashed; ++j) {
+        TEST_ASSERT(single.roll());
+        for (size_t i = 0; i < num_hashes; ++i) {
+          TEST_ASSERT_EQ(batch_hashes[j * num_hashes + i], single.hashes()[i]);
+        }
+      }
+      if (hashed < 70) {
+        TEST_ASSERT(!single.roll());
+      }
+      TEST_ASSERT_EQ(batched.get_pos(), single.get_pos());
+      for (size_t i = 0; i < num_hashes; ++i) {
+        TEST_ASSERT_EQ(batched.hashes()[i], single.hashes()[i]);
+      }
+    }
+    TEST_ASSERT(!single.roll());
+  }
+
+  PRINT_TEST_NAME("single-pass multi-level hashing")
+  {
+    btllib::MultiLevelAAHash multi(batch_seq, h, long_k);
+    std::vector<btllib::AAHash> levels;
+    for (unsigned level = 1; level <= 3; ++level) {
+      levels.emplace_back(batch_seq, h, long_k, level);
+    }
+    while (multi.roll()) {
+      for (unsigned level = 1; level <= 3; ++level) {
+        auto& aahash = levels[level - 1];
+        TEST_ASSERT(aahash.roll());
+        TEST_ASSERT_EQ(multi.get_pos(), aahash.get_pos());
+        for (unsigned i = 0; i < h; ++i) {
+          TEST_ASSERT_EQ(multi.hashes(level)[i], aahash.hashes()[i]);
+          TEST_ASSERT_EQ(multi.hashes()[(level - 1) * h + i],
+                         aahash.hashes()[i]);
+        }
+      }
+    }
+    for (auto& aahash : levels) {
+      TEST_ASSERT(!aahash.roll());
+    }
+
+    btllib::MultiLevelAAHash single(batch_seq, h, long_k);
+    btllib::MultiLevelAAHash batched(batch_seq, h, long_k);
+    const size_t num_hashes = btllib::MultiLevelAAHash::NUM_LEVELS * h;
+    std::vector<uint64_t> batch_hashes(90 * num_hashes);
+    std::vector<size_t> positions(90);
+    size_t hashed = 0;
+    while ((hashed = batched.roll_batch(
+              90, batch_hashes.data(), num_hashes, positions.data())) > 0) {
+      for (size_t j = 0; j < hashed; ++j) {
+        TEST_ASSERT(single.roll());
+        TEST_ASSERT_EQ(positions[j], single.get_pos());
+        for (size_t i = 0; i < num_hashes; ++i) {
+          TEST_ASSERT_EQ(batch_hashes[j * num_hashes + i], single.hashes()[i]);
+        }
+      }
+      if (hashed < 90) {
+        TEST_ASSERT(!single.roll());
+      }
+      TEST_ASSERT_EQ(batched.get_pos(), single.get_pos());
+    }
+    TEST_ASSERT(!single.roll());
+
+    btllib::MultiLevelAAHash copy(batch_seq, h, long_k);
+    copy.roll();
+    btllib::MultiLevelAAHash copied(copy);
+    TEST_ASSERT(copy.roll());
+    TEST_ASSERT(copied.roll());
+    for (size_t i = 0; i < num_hashes; ++i) {
+      TEST_ASSERT_EQ(copy.hashes()[i], copied.hashes()[i]);
+    }
+  }
+
   return 0;
 }
\ No newline at end of file
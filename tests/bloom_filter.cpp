@@ -46,6 +46,42 @@ main()
   TEST_ASSERT_EQ(kmer_bf.contains(seq), (seq.size() - seq.size() / 2 + 1));
   TEST_ASSERT_LE(kmer_bf.contains(seq2), 1);
 
+  std::cerr << "Testing KmerBloomFilter parallel insertion" << std::endl;
+  std::string long_seq = get_random_seq(3000000);
+  for (size_t i = (1 << 20) - 10; i < (1 << 20) + 10; i++) {
+    long_seq[i] = 'N';
+  }
+  btllib::KmerBloomFilter sequential_bf(16 * 1024 * 1024, 3, 31);
+  btllib::KmerBloomFilter parallel_bf(16 * 1024 * 1024, 3, 31);
+  sequential_bf.insert(long_seq);
+  parallel_bf.insert_parallel(long_seq);
+  TEST_ASSERT_EQ(parallel_bf.get_pop_cnt(), sequential_bf.get_pop_cnt());
+  TEST_ASSERT_EQ(parallel_bf.contains(long_seq),
+                 sequential_bf.contains(long_seq));
+
+  std::cerr << "Testing KmerBloomFilter de Bruijn graph neighbour queries"
+            << std::endl;
+  const std::string path_seq = get_random_seq(200);
+  btllib::KmerBloomFilter path_bf(1024 * 1024, 4, 31);
+  path_bf.insert(path_seq);
+  btllib::BlindNtHash walker(path_seq, 4, 31);
+  const std::string bases(btllib::BlindNtHash::EXTENSION_BASES, 4);
+  for (size_t i = 31; i < path_seq.size(); i++) {
+    // Other neighbours can only be false positives or repeats
+    const unsigned successors = path_bf.contains_successors(walker);
+    TEST_ASSERT(bool(successors & (1U << bases.find(path_seq[i]))));
+    walker.roll(path_seq[i]);
+    const unsigned predecessors = path_bf.contains_predecessors(walker);
+    TEST_ASSERT(bool(predecessors & (1U << bases.find(path_seq[i - 31]))));
+  }
+  std::vector<uint64_t> candidates(4 * 4);
+  walker.peek_all_successors(candidates.data());
+  unsigned batch_found = path_bf.contains_batch(candidates.data(), 4);
+  for (unsigned b = 0; b < 4; b++) {
+    const bool found = path_bf.contains(candidates.data() + b * 4);
+    TEST_ASSERT_EQ(bool(batch_found & (1U << b)), found);
+  }
+
   std::cerr << "Testing SeedBloomFilter" << std::endl;
   std::string seed1 = "000001111111111111111111111111111";
   std::string seed2 = "111111111111111111111111111100000";
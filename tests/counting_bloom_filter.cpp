@@ -229,5 +229,106 @@ main()
     TEST_ASSERT_EQ(cbf.contains(hashes), 8);
   }
 
+  {
+    std::cerr << "Testing CBF add, subtract and max" << std::endl;
+    std::vector<uint64_t> hashes = { 0x47c80ef7eab,
+                                     0x8b4a469ef6,
+                                     0x32e7ab5203 };
+    std::vector<uint64_t> other_hashes = { 0x1234567, 0x7654321, 0xabcdef };
+    btllib::CountingBloomFilter8 cbf1(1024, hashes.size());
+    btllib::CountingBloomFilter8 cbf2(1024, hashes.size());
+    cbf1.insert(hashes, 200);
+    cbf2.insert(hashes, 100);
+    cbf2.insert(other_hashes, 3);
+
+    cbf1.max(cbf2);
+    TEST_ASSERT_EQ(cbf1.contains(hashes), 200);
+    TEST_ASSERT_EQ(cbf1.contains(other_hashes), 3);
+
+    cbf1.add(cbf2);
+    TEST_ASSERT_EQ(cbf1.contains(hashes), 255);
+    TEST_ASSERT_EQ(cbf1.contains(other_hashes), 6);
+
+    cbf1.subtract(cbf2);
+    TEST_ASSERT_EQ(cbf1.contains(hashes), 155);
+    TEST_ASSERT_EQ(cbf1.contains(other_hashes), 3);
+    cbf1.subtract(cbf2);
+    cbf1.subtract(cbf2);
+    TEST_ASSERT_EQ(cbf1.contains(hashes), 0);
+    TEST_ASSERT_EQ(cbf1.contains(other_hashes), 0);
+
+    std::cerr << "Testing CBF histogram" << std::endl;
+    const auto histogram = cbf2.get_histogram();
+    TEST_ASSERT_EQ(histogram.size(), 256);
+    uint64_t total = 0;
+    for (const auto count : histogram) {
+      total += count;
+    }
+    TEST_ASSERT_EQ(total, 1024);
+    TEST_ASSERT_EQ(histogram[100], hashes.size());
+    TEST_ASSERT_EQ(histogram[3], other_hashes.size());
+    const auto capped = cbf2.get_histogram(10);
+    TEST_ASSERT_EQ(capped.size(), 11);
+    TEST_ASSERT_EQ(capped[10], hashes.size());
+
+    std::cerr << "Testing CBF merging from file" << std::endl;
+    const auto path = get_random_name(64);
+    cbf2.save(path);
+    btllib::CountingBloomFilter8 cbf3(1024, hashes.size());
+    cbf3.insert(hashes, 1);
+    cbf3.add(path);
+    TEST_ASSERT_EQ(cbf3.contains(hashes), 101);
+    TEST_ASSERT_EQ(cbf3.contains(other_hashes), 3);
+    cbf3.subtract(path);
+    TEST_ASSERT_EQ(cbf3.contains(hashes), 1);
+    TEST_ASSERT_EQ(cbf3.contains(other_hashes), 0);
+    cbf3.max(path);
+    TEST_ASSERT_EQ(cbf3.contains(hashes), 100);
+    std::remove(path.c_str());
+
+    btllib::KmerCountingBloomFilter16 kcbf1(1024, 3, 11);
+    btllib::KmerCountingBloomFilter16 kcbf2(1024, 3, 11);
+    const std::string seq = "AGTCATCGACTGATGC";
+    kcbf1.insert(seq);
+    kcbf2.insert(seq);
+    kcbf2.insert(seq);
+    kcbf2.save(path);
+    kcbf1.add(path);
+    TEST_ASSERT_EQ(kcbf1.contains(seq), 3 * (seq.size() - 11 + 1));
+    kcbf1.subtract(kcbf2);
+    TEST_ASSERT_EQ(kcbf1.contains(seq), seq.size() - 11 + 1);
+    std::remove(path.c_str());
+  }
+
+  {
+    std::cerr << "Testing CBF to BF conversion" << std::endl;
+    btllib::KmerCountingBloomFilter8 kcbf(1024 * 1024, 3, 21);
+    std::vector<std::string> solid_seqs, weak_seqs;
+    for (size_t i = 0; i < 50; i++) {
+      solid_seqs.push_back(get_random_seq(100));
+      weak_seqs.push_back(get_random_seq(100));
+      kcbf.insert(solid_seqs.back());
+      kcbf.insert(solid_seqs.back());
+      kcbf.insert(solid_seqs.back());
+      kcbf.insert(weak_seqs.back());
+    }
+    const auto same_size = kcbf.to_bloom_filter(3);
+    TEST_ASSERT_EQ(same_size->get_bytes(), kcbf.get_bytes() / CHAR_BIT);
+    const auto folded = kcbf.to_bloom_filter(3, kcbf.get_bytes() / 32);
+    TEST_ASSERT_EQ(folded->get_bytes(), kcbf.get_bytes() / 32);
+    btllib::KmerBloomFilter reinserted(kcbf.get_bytes() / 32, 3, 21);
+    for (const auto& seq : solid_seqs) {
+      TEST_ASSERT_EQ(same_size->contains(seq), seq.size() - 21 + 1);
+      TEST_ASSERT_EQ(folded->contains(seq), seq.size() - 21 + 1);
+      reinserted.insert(seq);
+    }
+    size_t false_positives = 0;
+    for (const auto& seq : weak_seqs) {
+      false_positives += same_size->contains(seq);
+    }
+    TEST_ASSERT_LE(false_positives, 5);
+    TEST_ASSERT_EQ(folded->get_pop_cnt(), reinserted.get_pop_cnt());
+  }
+
   return 0;
 }
\ No newline at end of file
@@ -92,4 +92,18 @@ get_random_name(const size_t size)
   return name;
 }
 
+// Path of a randomly named file in TMPDIR or /tmp, so that tests do not leave
+// files behind in the source tree if they fail before cleaning up
+inline std::string
+get_tmp_path(const std::string& suffix = "")
+{
+  const char* const tmpdir =
+    std::getenv("TMPDIR"); // NOLINT(concurrency-mt-unsafe)
+  std::string dir = tmpdir != nullptr ? tmpdir : "/tmp";
+  if (!dir.empty() && dir.back() != '/') {
+    dir += '/';
+  }
+  return dir + get_random_name(64) + suffix;
+}
+
 #endif
\ No newline at end of file
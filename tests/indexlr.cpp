@@ -3,6 +3,8 @@
 #include "btllib/util.hpp"
 #include "helpers.hpp"
 
+#include <chrono>
+#include <cstdio>
 #include <fstream>
 #include <sstream>
 
@@ -257,5 +259,71 @@ main()
   }
   TEST_ASSERT_GE(mins_found, filter_in_hashes.size());
 
+  std::cerr << "Testing sequence and quality output" << std::endl;
+  const size_t quality_k = 50, quality_q = 25;
+  btllib::SeqReader quality_reader(btllib::get_dirname(__FILE__) +
+                                     "/indexlr.quality.fq",
+                                   btllib::SeqReader::Flag::SHORT_MODE);
+  btllib::Indexlr indexlr8(btllib::get_dirname(__FILE__) +
+                             "/indexlr.quality.fq",
+                           quality_k,
+                           20,
+                           quality_q,
+                           btllib::Indexlr::Flag::SEQ |
+                             btllib::Indexlr::Flag::QUAL |
+                             btllib::Indexlr::Flag::SHORT_MODE);
+  mins_found = 0;
+  for (const auto& read : quality_reader) {
+    record = indexlr8.read();
+    TEST_ASSERT_EQ(record.id, read.id);
+    for (const auto& min : record.minimizers) {
+      TEST_ASSERT_EQ(min.seq, read.seq.substr(min.pos, quality_k));
+      TEST_ASSERT_EQ(min.qual, read.qual.substr(min.pos, quality_k));
+      size_t qual_sum = 0;
+      for (const auto c : min.qual) {
+        qual_sum += c - 33;
+      }
+      TEST_ASSERT_GE(qual_sum / quality_k, quality_q);
+      mins_found++;
+    }
+  }
+  TEST_ASSERT(!indexlr8.read());
+  TEST_ASSERT_GT(mins_found, 0);
+
+  std::cerr << "Testing minimizer speed for different window sizes"
+            << std::endl;
+  const auto long_reads_path = get_tmp_path(".fa");
+  const size_t num_long_reads = 20, long_read_len = 50000;
+  std::ofstream long_reads_file(long_reads_path);
+  for (size_t i = 0; i < num_long_reads; i++) {
+    long_reads_file << ">read" << i << '\n'
+                    << get_random_seq(long_read_len) << '\n';
+  }
+  long_reads_file.close();
+  std::cerr << "ns/base for w = 10, 100, 1000:";
+  for (const size_t w : { 10, 100, 1000 }) {
+    const auto start = std::chrono::steady_clock::now();
+    btllib::Indexlr indexlr_long(
+      long_reads_path, 31, w, btllib::Indexlr::Flag::LONG_MODE, 1);
+    size_t num_minimizers = 0;
+    while ((record = indexlr_long.read())) {
+      // Every window has a minimizer
+      for (size_t j = 1; j < record.minimizers.size(); j++) {
+        TEST_ASSERT_GT(record.minimizers[j].pos,
+                       record.minimizers[j - 1].pos);
+        TEST_ASSERT_LE(record.minimizers[j].pos,
+                       record.minimizers[j - 1].pos + w);
+      }
+      num_minimizers += record.minimizers.size();
+    }
+    const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+    TEST_ASSERT_GT(num_minimizers, 0);
+    std::cerr << ' '
+              << elapsed.count() * 1e9 / (num_long_reads * long_read_len);
+  }
+  std::cerr << std::endl;
+  std::remove(long_reads_path.c_str());
+
   return 0;
 }
\ No newline at end of file
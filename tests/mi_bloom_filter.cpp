@@ -1,4 +1,7 @@
 #include "btllib/mi_bloom_filter.hpp"
+#include "btllib/mi_bloom_filter_builder.hpp"
+#include "btllib/mi_bloom_filter_classifier.hpp"
+#include "btllib/mi_bloom_filter_segments.hpp"
 
 #include "helpers.hpp"
 
@@ -6,6 +9,7 @@
 #include <cmath>
 #include <algorithm>
 #include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <stdlib.h>     /* srand, rand */
@@ -73,10 +77,13 @@ main()
  
 
   std::cerr << "Testing multi-indexed BloomFilter saving." << std::endl; 
-  mi_bf_2.save("test.mibf");
+  const auto mi_bf_path = get_tmp_path(".mibf");
+  mi_bf_2.save(mi_bf_path);
 
   std::cerr << "Testing multi-indexed BloomFilter reading." << std::endl;
-  btllib::MIBloomFilter<uint8_t> mi_bf_3("test.mibf");
+  btllib::MIBloomFilter<uint8_t> mi_bf_3(mi_bf_path);
+  std::remove(mi_bf_path.c_str());
+  std::remove((mi_bf_path + ".sdsl").c_str());
   
   std::vector<uint32_t> total_counter_2(4, 0);
   for(btllib::NtHash nthash(random_dna, 1, 15); nthash.roll(); counter++){
@@ -152,5 +159,346 @@ main()
   // get pop saturated count should return positive integer.
   TEST_ASSERT(mi_bf_4.get_pop_saturated_cnt() > 0);
 
+  std::cerr << "Testing multi-indexed BloomFilter builder" << std::endl;
+  const auto builder_fasta = get_tmp_path(".fa");
+  std::vector<std::string> builder_seqs;
+  {
+    std::ofstream ofs(builder_fasta);
+    for (unsigned i = 0; i < 8; i++) {
+      builder_seqs.push_back(get_random_seq(500));
+      ofs << ">seq" << i << '\n' << builder_seqs.back() << '\n';
+    }
+  }
+  for (const size_t max_cache_bytes :
+       { btllib::MIBloomFilterBuilder<uint16_t>::DEFAULT_MAX_CACHE_BYTES,
+         size_t(0) }) {
+    btllib::MIBloomFilterBuilder<uint16_t> builder(
+      { builder_fasta }, 3, 25, 0, max_cache_bytes);
+    const auto mi_bf_5 = builder.build();
+    TEST_ASSERT_EQ(builder.get_kmer_count(), 8 * (500 - 25 + 1));
+    if (max_cache_bytes > 0) {
+      TEST_ASSERT_EQ(builder.get_spilled_kmer_count(), 0);
+    } else {
+      const uint64_t kmer_count = builder.get_kmer_count();
+      TEST_ASSERT_EQ(builder.get_spilled_kmer_count(), kmer_count);
+    }
+    TEST_ASSERT_EQ(mi_bf_5->get_k(), 25);
+    TEST_ASSERT_EQ(builder.get_id_names().size(), 8);
+    for (uint16_t id = 0; id < 8; id++) {
+      TEST_ASSERT_EQ(builder.get_id_names()[id], "seq" + std::to_string(id));
+      size_t found = 0, total = 0;
+      for (btllib::NtHash nthash(builder_seqs[id], 3, 25); nthash.roll();
+           total++) {
+        for (const auto& res : mi_bf_5->get_id(nthash.hashes())) {
+          if ((res & mi_bf_5->ID_MASK) == id) {
+            found++;
+            break;
+          }
+        }
+      }
+      // Saturation can replace a few IDs, but most k-mers keep theirs
+      TEST_ASSERT_GT(found, total * 9 / 10);
+    }
+  }
+  {
+    const std::vector<std::string> seeds = { "1111100000111110000011111",
+                                             "1010101010101010101010101",
+                                             "1110111011100011101110111",
+                                             "1101110111011101110111011" };
+    btllib::MIBloomFilterBuilder<uint16_t> builder(
+      { builder_fasta }, seeds, 0, 0);
+    // With one hash per seed, a sparser filter keeps the ID loss well below
+    // the 10% allowed below (under 1% observed)
+    const auto mi_bf_5 = builder.build(0, 0.25);
+    TEST_ASSERT_EQ(builder.get_spilled_kmer_count(), 8 * (500 - 25 + 1));
+    TEST_ASSERT_EQ(mi_bf_5->get_hash_num(), seeds.size());
+    for (uint16_t id = 0; id < 8; id++) {
+      size_t found = 0, total = 0;
+      for (btllib::SeedNtHash nthash(builder_seqs[id], seeds, 1, 25);
+           nthash.roll();
+           total++) {
+        for (const auto& res : mi_bf_5->get_id(nthash.hashes())) {
+          if ((res & mi_bf_5->ID_MASK) == id) {
+            found++;
+            break;
+          }
+        }
+      }
+      TEST_ASSERT_GT(found, total * 9 / 10);
+    }
+  }
+
+  std::cerr << "Testing multi-indexed BloomFilter classifier" << std::endl;
+  {
+    btllib::MIBloomFilterBuilder<uint16_t> builder({ builder_fasta }, 3, 25);
+    const auto mi_bf_6 = builder.build();
+    const auto reads_fasta = get_tmp_path(".fa");
+    {
+      std::ofstream ofs(reads_fasta);
+      for (unsigned i = 0; i < 8; i++) {
+        ofs << ">read" << i << '\n' << builder_seqs[i].substr(i * 40, 150)
+            << '\n';
+      }
+      ofs << ">random\n" << get_random_seq(150) << '\n';
+      ofs << ">short\nACGT\n";
+    }
+    using Classifier = btllib::MIBloomFilterClassifier<uint16_t>;
+    for (const unsigned threads : { 1U, 3U }) {
+      Classifier classifier(
+        reads_fasta, *mi_bf_6, Classifier::Flag::SHORT_MODE, 10, 0.5, threads);
+      size_t num = 0;
+      for (const auto record : classifier) {
+        TEST_ASSERT_EQ(record.num, num);
+        if (num < 8) {
+          TEST_ASSERT_EQ(record.id, "read" + std::to_string(num));
+          TEST_ASSERT_EQ(record.kmers, 150 - 25 + 1);
+          TEST_ASSERT_EQ(record.ids.size(), 1);
+          TEST_ASSERT_EQ(record.ids[0], num);
+          TEST_ASSERT_LE(record.hits, record.matched_kmers);
+          TEST_ASSERT_GT(record.confidence, 0.5);
+        } else {
+          TEST_ASSERT(record.ids.empty());
+        }
+        num++;
+      }
+      TEST_ASSERT_EQ(num, 10);
+    }
+    std::remove(reads_fasta.c_str());
+  }
+
+  std::cerr << "Testing multi-indexed BloomFilter incremental updates"
+            << std::endl;
+  {
+    const auto base_fasta = get_tmp_path(".fa");
+    {
+      std::ofstream ofs(base_fasta);
+      for (unsigned i = 0; i < 4; i++) {
+        ofs << ">seq" << i << '\n' << builder_seqs[i] << '\n';
+      }
+    }
+    btllib::MIBloomFilterBuilder<uint16_t> builder({ base_fasta }, 3, 25);
+    // Sparse filters keep the false positives of one filter from replacing
+    // the IDs of another in the combined results
+    std::shared_ptr<const btllib::MIBloomFilter<uint16_t>> base =
+      builder.build(0, 0.25);
+    std::remove(base_fasta.c_str());
+
+    const auto count_found = [](btllib::MIBloomFilterSegments<uint16_t>& mi_bf,
+                                const std::string& seq,
+                                const uint16_t id) {
+      size_t found = 0;
+      std::vector<uint16_t> ids;
+      for (btllib::NtHash nthash(seq, 3, 25); nthash.roll();) {
+        mi_bf.get_id(nthash.hashes(), ids);
+        for (const auto res : ids) {
+          if ((res & btllib::MIBloomFilter<uint16_t>::ID_MASK) == id) {
+            found++;
+            break;
+          }
+        }
+      }
+      return found;
+    };
+
+    btllib::MIBloomFilterSegments<uint16_t> segments(base, 0.25);
+    const size_t kmers = 500 - 25 + 1;
+    for (uint16_t id = 4; id < 6; id++) {
+      segments.insert(builder_seqs[id], id);
+    }
+    TEST_ASSERT_EQ(segments.get_staged_kmer_count(), 2 * kmers);
+    TEST_ASSERT(segments.get_deltas().empty());
+    TEST_ASSERT_LT(count_found(segments, builder_seqs[4], 4), kmers / 10);
+    segments.commit();
+    segments.wait();
+    TEST_ASSERT_EQ(segments.get_staged_kmer_count(), 0);
+    TEST_ASSERT_EQ(segments.get_delta_kmer_count(), 2 * kmers);
+    TEST_ASSERT_EQ(segments.get_deltas().size(), 1);
+
+    // Smaller commits get their own delta until they are merged
+    segments.insert(builder_seqs[6], 6);
+    segments.commit();
+    segments.wait();
+    TEST_ASSERT_EQ(segments.get_deltas().size(), 2);
+    segments.insert(builder_seqs[7], 7);
+    segments.commit();
+    segments.wait();
+    TEST_ASSERT_EQ(segments.get_deltas().size(), 1);
+    TEST_ASSERT_EQ(segments.get_delta_kmer_count(), 4 * kmers);
+    for (uint16_t id = 0; id < 8; id++) {
+      TEST_ASSERT_GT(count_found(segments, builder_seqs[id], id),
+                     kmers * 9 / 10);
+    }
+
+    const auto delta_path = get_tmp_path();
+    segments.save_delta(delta_path);
+    btllib::MIBloomFilterSegments<uint16_t> segments_loaded(base, 0.25);
+    segments_loaded.load_delta(delta_path);
+    TEST_ASSERT_EQ(segments_loaded.get_delta_kmer_count(), 4 * kmers);
+    for (uint16_t id = 4; id < 8; id++) {
+      TEST_ASSERT_GT(count_found(segments_loaded, builder_seqs[id], id),
+                     kmers * 9 / 10);
+    }
+
+    // IDs are combined into one per hash value, as for a single filter
+    for (btllib::NtHash nthash(builder_seqs[5], 3, 25); nthash.roll();) {
+      TEST_ASSERT_EQ(segments.get_id(nthash.hashes()).size(), 3);
+    }
+
+    // Commits over the cap are refused and the k-mers stay staged
+    btllib::MIBloomFilterSegments<uint16_t> segments_capped(
+      base,
+      btllib::MIBloomFilterSegments<uint16_t>::DEFAULT_OCCUPANCY,
+      2 * kmers);
+    TEST_ASSERT(!segments_capped.load_delta(delta_path));
+    segments_capped.insert(builder_seqs[4], 4);
+    TEST_ASSERT(segments_capped.commit());
+    segments_capped.insert(builder_seqs[5], 5);
+    segments_capped.insert(builder_seqs[6], 6);
+    TEST_ASSERT(!segments_capped.commit());
+    TEST_ASSERT_EQ(segments_capped.get_staged_kmer_count(), 2 * kmers);
+    segments_capped.wait();
+    TEST_ASSERT_EQ(segments_capped.get_delta_kmer_count(), kmers);
+    std::remove(delta_path.c_str());
+  }
+  {
+    const std::vector<std::string> seeds = { "1111100000111110000011111",
+                                             "1010101010101010101010101",
+                                             "1110111011100011101110111" };
+    const auto base_fasta = get_tmp_path(".fa");
+    {
+      std::ofstream ofs(base_fasta);
+      for (unsigned i = 0; i < 4; i++) {
+        ofs << ">seq" << i << '\n' << builder_seqs[i] << '\n';
+      }
+    }
+    btllib::MIBloomFilterBuilder<uint16_t> builder({ base_fasta }, seeds);
+    std::shared_ptr<const btllib::MIBloomFilter<uint16_t>> base =
+      builder.build(0, 0.25);
+    std::remove(base_fasta.c_str());
+    TEST_ASSERT_EQ(base->get_hash_fn(), btllib::SEED_NTHASH_FN_NAME);
+
+    btllib::MIBloomFilterSegments<uint16_t> segments(base, seeds, 0.25);
+    for (uint16_t id = 4; id < 8; id++) {
+      segments.insert(builder_seqs[id], id);
+    }
+    segments.commit();
+    segments.wait();
+    for (uint16_t id = 0; id < 8; id++) {
+      size_t found = 0, total = 0;
+      for (btllib::SeedNtHash nthash(builder_seqs[id], seeds, 1, 25);
+           nthash.roll();
+           total++) {
+        for (const auto res : segments.get_id(nthash.hashes())) {
+          if ((res & btllib::MIBloomFilter<uint16_t>::ID_MASK) == id) {
+            found++;
+            break;
+          }
+        }
+      }
+      TEST_ASSERT_GT(found, total * 9 / 10);
+    }
+  }
+
+  std::cerr << "Testing multi-indexed BloomFilter allocation-free queries"
+            << std::endl;
+  btllib::MIBloomFilter<uint8_t>::QueryBuffer buffer(mi_bf_4.get_hash_num());
+  std::vector<uint8_t> ids_out(mi_bf_4.get_hash_num());
+  for (const auto& hashes : { std::vector<uint64_t>{ 1, 10, 100 },
+                              std::vector<uint64_t>{ 500, 1000, 2000 } }) {
+    const auto expected = mi_bf_4.get_id(hashes);
+    mi_bf_4.get_id(hashes.data(), ids_out.data());
+    TEST_ASSERT_ARRAY_EQ(ids_out, expected, expected.size());
+    const auto& buffered = mi_bf_4.get_id(hashes.data(), buffer);
+    TEST_ASSERT_ARRAY_EQ(buffered, expected, expected.size());
+  }
+
+  std::cerr << "Testing multi-indexed BloomFilter batched queries" << std::endl;
+  {
+    std::vector<uint64_t> batch_hashes;
+    for (btllib::NtHash nthash(random_dna, 1, 15); nthash.roll();) {
+      batch_hashes.push_back(nthash.hashes()[0]);
+    }
+    const auto batch_ids = mi_bf_3.get_ids(batch_hashes);
+    TEST_ASSERT_EQ(batch_ids.size(), batch_hashes.size());
+    for (size_t i = 0; i < batch_hashes.size(); i++) {
+      TEST_ASSERT_EQ(batch_ids[i], mi_bf_3.get_id({ batch_hashes[i] })[0]);
+    }
+    std::vector<uint8_t> batch_ids_4(3 * 2);
+    const uint64_t hashes_4[] = { 1, 10, 100, 500, 1000, 2000 };
+    mi_bf_4.get_ids(hashes_4, 2, batch_ids_4.data());
+    const auto ids_4a = mi_bf_4.get_id({ 1, 10, 100 });
+    const auto ids_4b = mi_bf_4.get_id({ 500, 1000, 2000 });
+    for (size_t i = 0; i < 3; i++) {
+      TEST_ASSERT_EQ(batch_ids_4[i], ids_4a[i]);
+      TEST_ASSERT_EQ(batch_ids_4[3 + i], ids_4b[i]);
+    }
+  }
+
+  std::cerr << "Testing multi-indexed BloomFilter single file format"
+            << std::endl;
+  {
+    const auto single_file_path = get_tmp_path();
+    mi_bf_4.save(single_file_path, true);
+    TEST_ASSERT(
+      btllib::MIBloomFilter<uint8_t>::is_single_file(single_file_path));
+    btllib::MIBloomFilter<uint8_t> mi_bf_mapped(single_file_path);
+    TEST_ASSERT(mi_bf_mapped.is_mapped());
+    TEST_ASSERT_EQ(mi_bf_mapped.get_hash_num(), mi_bf_4.get_hash_num());
+    TEST_ASSERT_EQ(mi_bf_mapped.get_pop_cnt(), mi_bf_4.get_pop_cnt());
+    TEST_ASSERT_EQ(mi_bf_mapped.get_pop_saturated_cnt(),
+                   mi_bf_4.get_pop_saturated_cnt());
+    for (const auto& hashes : { std::vector<uint64_t>{ 1, 10, 100 },
+                                std::vector<uint64_t>{ 500, 1000, 2000 } }) {
+      const auto expected = mi_bf_4.get_id(hashes);
+      const auto mapped = mi_bf_mapped.get_id(hashes);
+      TEST_ASSERT_ARRAY_EQ(mapped, expected, expected.size());
+    }
+    std::remove(single_file_path.c_str());
+  }
+
+  std::cerr << "Testing multi-indexed BloomFilter ID array compaction"
+            << std::endl;
+  {
+    btllib::MIBloomFilterBuilder<uint16_t> builder({ builder_fasta }, 3, 25);
+    const auto mi_bf_7 = builder.build();
+    std::vector<uint64_t> hashes;
+    for (const auto& seq : builder_seqs) {
+      for (btllib::NtHash nthash(seq, 3, 25); nthash.roll();) {
+        hashes.insert(hashes.end(), nthash.hashes(), nthash.hashes() + 3);
+      }
+    }
+    const auto expected = mi_bf_7->get_ids(hashes);
+    const auto saturated = mi_bf_7->get_pop_saturated_cnt();
+    mi_bf_7->compact();
+    TEST_ASSERT(mi_bf_7->is_compacted());
+    // 8 IDs need 3 bits, plus the saturation and strand flags
+    TEST_ASSERT_EQ(mi_bf_7->get_id_width(), 5);
+    TEST_ASSERT_EQ(mi_bf_7->get_pop_saturated_cnt(), saturated);
+    const auto compacted = mi_bf_7->get_ids(hashes);
+    TEST_ASSERT_ARRAY_EQ(compacted, expected, expected.size());
+
+    const auto compacted_path = get_tmp_path();
+    mi_bf_7->save(compacted_path, true);
+    btllib::MIBloomFilter<uint16_t> mi_bf_mapped(compacted_path);
+    TEST_ASSERT(mi_bf_mapped.is_compacted());
+    TEST_ASSERT_EQ(mi_bf_mapped.get_id_width(), 5);
+    const auto mapped = mi_bf_mapped.get_ids(hashes);
+    TEST_ASSERT_ARRAY_EQ(mapped, expected, expected.size());
+    std::remove(compacted_path.c_str());
+
+    // A few sparse IDs are stored as dictionary indices
+    mi_bf_1.complete_id_insertion();
+    const auto expected_1 = mi_bf_1.get_id({ 1, 10, 100 });
+    const auto expected_2 = mi_bf_1.get_id({ 100, 200, 300 });
+    mi_bf_1.compact(true);
+    TEST_ASSERT_EQ(mi_bf_1.get_id_width(), 1);
+    const auto compacted_1 = mi_bf_1.get_id({ 1, 10, 100 });
+    const auto compacted_2 = mi_bf_1.get_id({ 100, 200, 300 });
+    TEST_ASSERT_ARRAY_EQ(compacted_1, expected_1, expected_1.size());
+    TEST_ASSERT_ARRAY_EQ(compacted_2, expected_2, expected_2.size());
+  }
+
+  std::remove(builder_fasta.c_str());
+
   return 0;
 }
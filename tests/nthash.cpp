@@ -2,8 +2,10 @@
 #include "btllib/seq.hpp"
 #include "helpers.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <queue>
+#include <set>
 #include <stack>
 #include <string>
 
@@ -145,6 +147,389 @@ main()
     }
   }
 
+  {
+    PRINT_TEST_NAME("k-mer batch rolling")
+    std::string seq = get_random_seq(1000);
+    seq[100] = 'N';
+    seq[500] = 'N';
+    seq[501] = 'N';
+    const unsigned k = 31;
+    const unsigned h = 5;
+    const size_t stride = h + 2;
+
+    std::vector<uint64_t> expected;
+    std::vector<size_t> expected_positions;
+    btllib::NtHash reference(seq, h, k);
+    while (reference.roll()) {
+      expected.insert(
+        expected.end(), reference.hashes(), reference.hashes() + h);
+      expected_positions.push_back(reference.get_pos());
+    }
+
+    // Batch sizes not aligned to the SIMD width or the internal batch size
+    for (const size_t batch : { size_t(1), size_t(7), size_t(100) }) {
+      btllib::NtHash nthash(seq, h, k);
+      std::vector<uint64_t> hashes(batch * stride);
+      std::vector<size_t> positions(batch);
+      size_t kmer = 0;
+      size_t hashed;
+      while ((hashed = nthash.roll_batch(
+                batch, hashes.data(), stride, positions.data())) > 0) {
+        for (size_t j = 0; j < hashed; j++, kmer++) {
+          TEST_ASSERT_LT(kmer, expected_positions.size());
+          TEST_ASSERT_EQ(positions[j], expected_positions[kmer]);
+          const uint64_t* batch_hashes = hashes.data() + j * stride;
+          const uint64_t* expected_hashes = expected.data() + kmer * h;
+          TEST_ASSERT_ARRAY_EQ(batch_hashes, expected_hashes, h);
+        }
+        TEST_ASSERT_EQ(nthash.get_pos(), expected_positions[kmer - 1]);
+        const uint64_t* last_hashes = expected.data() + (kmer - 1) * h;
+        TEST_ASSERT_ARRAY_EQ(nthash.hashes(), last_hashes, h);
+      }
+      TEST_ASSERT_EQ(kmer, expected_positions.size());
+      TEST_ASSERT(!nthash.roll());
+    }
+
+    btllib::NtHash nthash(seq, h, k);
+    nthash.roll();
+    TEST_ASSERT_EQ(nthash.get_max_kmers(), seq.size() - k);
+    std::vector<uint64_t> hashes(nthash.get_max_kmers() * h);
+    const size_t hashed = nthash.hash_all(hashes.data(), h);
+    TEST_ASSERT_EQ(hashed, expected_positions.size() - 1);
+    const uint64_t* expected_hashes = expected.data() + h;
+    TEST_ASSERT_ARRAY_EQ(hashes, expected_hashes, hashed * h);
+    TEST_ASSERT_EQ(nthash.get_max_kmers(), 0);
+
+    // Every kernel supported by this CPU gives the same result
+    std::vector<uint64_t> fwd(expected_positions.size());
+    std::vector<uint64_t> rev(expected_positions.size());
+    for (size_t j = 0; j < fwd.size(); j++) {
+      fwd[j] = btllib::hashing_internals::base_forward_hash(
+        seq.data() + expected_positions[j], k);
+      rev[j] = btllib::hashing_internals::base_reverse_hash(
+        seq.data() + expected_positions[j], k);
+    }
+    using btllib::hashing_internals::SimdLevel;
+    for (const unsigned hash_num : { 1U, 5U, 8U, 19U }) {
+      const size_t size = fwd.size() * (hash_num + 1);
+      std::vector<uint64_t> scalar(size);
+      btllib::hashing_internals::extend_hashes_batch_scalar(fwd.data(),
+                                                            rev.data(),
+                                                            fwd.size(),
+                                                            k,
+                                                            hash_num,
+                                                            scalar.data(),
+                                                            hash_num + 1);
+      for (const auto level : { SimdLevel::AVX2, SimdLevel::AVX512 }) {
+        if (level > btllib::hashing_internals::get_simd_level()) {
+          continue;
+        }
+        std::vector<uint64_t> extended(size);
+        btllib::hashing_internals::extend_hashes_batch(fwd.data(),
+                                                       rev.data(),
+                                                       fwd.size(),
+                                                       k,
+                                                       hash_num,
+                                                       extended.data(),
+                                                       hash_num + 1,
+                                                       level);
+        TEST_ASSERT_ARRAY_EQ(extended, scalar, size);
+      }
+    }
+  }
+
+  {
+    PRINT_TEST_NAME("multi-stream k-mer hashing")
+    const unsigned k = 21;
+    const unsigned h = 3;
+    std::vector<std::string> reads;
+    for (size_t i = 0; i < 100; i++) {
+      std::string read = get_random_seq(10 + (i * 37) % 200);
+      if (i % 3 == 0) {
+        read[read.size() / 2] = 'N';
+      }
+      if (i % 7 == 0) {
+        read[read.size() / 3] = 'n';
+        read[read.size() / 3 + 5] = '.';
+      }
+      reads.push_back(read);
+    }
+
+    std::vector<std::vector<size_t>> expected_positions(reads.size());
+    std::vector<std::vector<uint64_t>> expected(reads.size());
+    for (size_t i = 0; i < reads.size(); i++) {
+      if (reads[i].size() < k) {
+        continue;
+      }
+      btllib::NtHash nthash(reads[i], h, k);
+      while (nthash.roll()) {
+        expected_positions[i].push_back(nthash.get_pos());
+        expected[i].insert(
+          expected[i].end(), nthash.hashes(), nthash.hashes() + h);
+      }
+    }
+
+    const auto check = [&](auto& hasher) {
+      const unsigned lanes = hasher.get_lanes();
+      std::vector<size_t> lane_read(lanes);
+      std::vector<size_t> kmers(reads.size());
+      size_t next_read = 0;
+      do {
+        for (unsigned lane = 0; lane < lanes; lane++) {
+          while (((hasher.get_active() >> lane) & 1) == 0 &&
+                 next_read < reads.size()) {
+            lane_read[lane] = next_read;
+            hasher.set(lane, reads[next_read++]);
+          }
+        }
+        const uint64_t ready = hasher.roll();
+        for (unsigned lane = 0; lane < lanes; lane++) {
+          if (((ready >> lane) & 1) == 0) {
+            continue;
+          }
+          const size_t read = lane_read[lane];
+          const size_t kmer = kmers[read]++;
+          TEST_ASSERT_LT(kmer, expected_positions[read].size());
+          TEST_ASSERT_EQ(hasher.get_pos(lane), expected_positions[read][kmer]);
+          const uint64_t* expected_hashes = expected[read].data() + kmer * h;
+          TEST_ASSERT_ARRAY_EQ(hasher.hashes(lane), expected_hashes, h);
+        }
+      } while (hasher.get_active() != 0 || next_read < reads.size());
+      for (size_t read = 0; read < reads.size(); read++) {
+        TEST_ASSERT_EQ(kmers[read], expected_positions[read].size());
+      }
+    };
+    btllib::MultiNtHash<4> hasher4(h, k);
+    check(hasher4);
+    btllib::MultiNtHash<8> hasher8(h, k);
+    check(hasher8);
+    btllib::MultiNtHash<16> hasher16(h, k);
+    check(hasher16);
+
+    // Every kernel supported by this CPU gives the same result
+    btllib::hashing_internals::RollTables tables;
+    btllib::hashing_internals::fill_roll_tables(tables, k);
+    const unsigned streams = 19;
+    std::vector<uint8_t> chars_in(streams), chars_out(streams);
+    std::vector<uint64_t> fwd(streams), rev(streams);
+    for (unsigned l = 0; l < streams; l++) {
+      chars_in[l] = "ACGTNacgtn"[l % 10];
+      chars_out[l] = "ACGTNacgtn"[(l * 3) % 10];
+      fwd[l] = get_random(0, 1000000) * 0x9E3779B97F4A7C15ULL;
+      rev[l] = get_random(0, 1000000) * 0xC2B2AE3D27D4EB4FULL;
+    }
+    std::vector<uint64_t> scalar_fwd = fwd, scalar_rev = rev;
+    btllib::hashing_internals::roll_streams_scalar(scalar_fwd.data(),
+                                                   scalar_rev.data(),
+                                                   chars_in.data(),
+                                                   chars_out.data(),
+                                                   streams,
+                                                   tables.data());
+    using btllib::hashing_internals::SimdLevel;
+    for (const auto level : { SimdLevel::AVX2, SimdLevel::AVX512 }) {
+      if (level > btllib::hashing_internals::get_simd_level()) {
+        continue;
+      }
+      std::vector<uint64_t> level_fwd = fwd, level_rev = rev;
+      btllib::hashing_internals::roll_streams(level_fwd.data(),
+                                              level_rev.data(),
+                                              chars_in.data(),
+                                              chars_out.data(),
+                                              streams,
+                                              tables.data(),
+                                              level);
+      TEST_ASSERT_ARRAY_EQ(level_fwd, scalar_fwd, streams);
+      TEST_ASSERT_ARRAY_EQ(level_rev, scalar_rev, streams);
+    }
+  }
+
+  {
+    PRINT_TEST_NAME("static k-mer hashing")
+    std::string seq = get_random_seq(500);
+    seq[200] = 'N';
+    seq[230] = 'n';
+
+    const auto check = [&](auto static_k) {
+      const unsigned k = decltype(static_k)::value;
+      btllib::NtHash nthash(seq, 4, k);
+      btllib::StaticNtHash<k, 4> static_nthash(seq);
+      btllib::StaticNtHash<k, 1> single_nthash(seq);
+      while (nthash.roll()) {
+        TEST_ASSERT(static_nthash.roll());
+        TEST_ASSERT(single_nthash.roll());
+        TEST_ASSERT_EQ(static_nthash.get_pos(), nthash.get_pos());
+        TEST_ASSERT_EQ(static_nthash.get_forward_hash(),
+                       nthash.get_forward_hash());
+        TEST_ASSERT_EQ(static_nthash.get_reverse_hash(),
+                       nthash.get_reverse_hash());
+        TEST_ASSERT_ARRAY_EQ(static_nthash.hashes(), nthash.hashes(), 4);
+        TEST_ASSERT_EQ(single_nthash.hashes()[0], nthash.hashes()[0]);
+      }
+      TEST_ASSERT(!static_nthash.roll());
+    };
+    for (unsigned k = 1; k <= 70; k++) {
+      const bool dispatched = btllib::dispatch_k(k, check);
+      const bool in_range =
+        k >= btllib::DISPATCH_MIN_K && k <= btllib::DISPATCH_MAX_K;
+      TEST_ASSERT_EQ(dispatched, in_range);
+    }
+    check(std::integral_constant<unsigned, 5>());
+    check(std::integral_constant<unsigned, 96>());
+  }
+
+  {
+    PRINT_TEST_NAME("stranded k-mer hashing")
+    const std::string seq = get_random_seq(80) + "N" + get_random_seq(60);
+    const unsigned k = 15;
+    const unsigned h = 3;
+
+    btllib::NtHash canonical(seq, h, k);
+    btllib::ForwardNtHash forward(seq, h, k);
+    btllib::ReverseNtHash reverse(seq, h, k);
+    btllib::StaticNtHash<k, h, btllib::NtHashMode::FORWARD> static_forward(seq);
+    btllib::StaticNtHash<k, h, btllib::NtHashMode::REVERSE> static_reverse(seq);
+    TEST_ASSERT(forward.get_mode() == btllib::NtHashMode::FORWARD);
+    TEST_ASSERT(reverse.get_mode() == btllib::NtHashMode::REVERSE);
+
+    uint64_t expected_forward[h], expected_reverse[h];
+    size_t kmers = 0;
+    while (canonical.roll()) {
+      TEST_ASSERT(forward.roll());
+      TEST_ASSERT(reverse.roll());
+      TEST_ASSERT(static_forward.roll());
+      TEST_ASSERT(static_reverse.roll());
+      TEST_ASSERT_EQ(forward.get_pos(), canonical.get_pos());
+      TEST_ASSERT_EQ(reverse.get_pos(), canonical.get_pos());
+      TEST_ASSERT_EQ(forward.get_forward_hash(), canonical.get_forward_hash());
+      TEST_ASSERT_EQ(forward.get_reverse_hash(), 0);
+      TEST_ASSERT_EQ(reverse.get_reverse_hash(), canonical.get_reverse_hash());
+      TEST_ASSERT_EQ(reverse.get_forward_hash(), 0);
+      btllib::hashing_internals::extend_hashes(
+        canonical.get_forward_hash(), 0, k, h, expected_forward);
+      btllib::hashing_internals::extend_hashes(
+        0, canonical.get_reverse_hash(), k, h, expected_reverse);
+      const uint64_t* forward_hashes = forward.hashes();
+      const uint64_t* reverse_hashes = reverse.hashes();
+      const uint64_t* static_forward_hashes = static_forward.hashes();
+      const uint64_t* static_reverse_hashes = static_reverse.hashes();
+      TEST_ASSERT_ARRAY_EQ(forward_hashes, expected_forward, h);
+      TEST_ASSERT_ARRAY_EQ(reverse_hashes, expected_reverse, h);
+      TEST_ASSERT_ARRAY_EQ(static_forward_hashes, expected_forward, h);
+      TEST_ASSERT_ARRAY_EQ(static_reverse_hashes, expected_reverse, h);
+      kmers++;
+    }
+    TEST_ASSERT(!forward.roll());
+    TEST_ASSERT(!reverse.roll());
+    TEST_ASSERT_EQ(kmers, (80 - k + 1) + (60 - k + 1));
+
+    // Batch rolling, back rolling, peeking and substitution only use the
+    // hashed strand as well
+    const auto check_mode = [&](auto mode) {
+      using StrandNtHash = btllib::BasicNtHash<decltype(mode)::value>;
+      StrandNtHash single(seq, h, k);
+      StrandNtHash batched(seq, h, k);
+      std::vector<uint64_t> batch_hashes(batched.get_max_kmers() * h);
+      std::vector<size_t> batch_positions(batched.get_max_kmers());
+      const size_t batch_kmers = batched.hash_all(
+        batch_hashes.data(), h, batch_positions.data());
+      TEST_ASSERT_EQ(batch_kmers, kmers);
+      for (size_t j = 0; j < batch_kmers; j++) {
+        TEST_ASSERT(single.roll());
+        TEST_ASSERT_EQ(single.get_pos(), batch_positions[j]);
+        const uint64_t* single_hashes = single.hashes();
+        const uint64_t* batch_kmer_hashes = batch_hashes.data() + j * h;
+        TEST_ASSERT_ARRAY_EQ(single_hashes, batch_kmer_hashes, h);
+      }
+
+      StrandNtHash rolled(seq, h, k);
+      rolled.roll();
+      rolled.roll();
+      const std::vector<uint64_t> second(rolled.hashes(), rolled.hashes() + h);
+      rolled.roll();
+      const std::vector<uint64_t> third(rolled.hashes(), rolled.hashes() + h);
+      rolled.roll_back();
+      const uint64_t* back_hashes = rolled.hashes();
+      const uint64_t* second_hashes = second.data();
+      TEST_ASSERT_ARRAY_EQ(back_hashes, second_hashes, h);
+      rolled.peek();
+      const uint64_t* peek_hashes = rolled.hashes();
+      const uint64_t* third_hashes = third.data();
+      TEST_ASSERT_ARRAY_EQ(peek_hashes, third_hashes, h);
+      rolled.roll();
+      rolled.peek_back();
+      peek_hashes = rolled.hashes();
+      TEST_ASSERT_ARRAY_EQ(peek_hashes, second_hashes, h);
+
+      std::string subbed = seq.substr(2, k);
+      subbed[3] = subbed[3] == 'A' ? 'C' : 'A';
+      StrandNtHash subbed_nthash(subbed, h, k);
+      subbed_nthash.roll();
+      rolled.sub({ 3 }, { (unsigned char)subbed[3] });
+      const uint64_t* sub_hashes = rolled.hashes();
+      const uint64_t* subbed_hashes = subbed_nthash.hashes();
+      TEST_ASSERT_ARRAY_EQ(sub_hashes, subbed_hashes, h);
+    };
+    check_mode(std::integral_constant<btllib::NtHashMode,
+                                      btllib::NtHashMode::FORWARD>());
+    check_mode(std::integral_constant<btllib::NtHashMode,
+                                      btllib::NtHashMode::REVERSE>());
+  }
+
+  {
+    PRINT_TEST_NAME("parallel hashing of long sequences")
+    const unsigned k = 25;
+    const unsigned h = 3;
+    const size_t chunk_size = 1000;
+    std::string seq = get_random_seq(100000);
+    // Invalid characters around and across chunk boundaries
+    for (const size_t pos : { size_t(990), size_t(2000), size_t(3010) }) {
+      seq[pos] = 'N';
+    }
+    for (size_t pos = 5990; pos < 7010; pos++) {
+      seq[pos] = 'N';
+    }
+
+    btllib::NtHash nthash(seq, h, k);
+    const size_t max_kmers = nthash.get_max_kmers();
+    std::vector<uint64_t> expected(max_kmers * h);
+    std::vector<size_t> expected_positions(max_kmers);
+    const size_t expected_kmers =
+      nthash.hash_all(expected.data(), h, expected_positions.data());
+
+    std::vector<uint64_t> hashes(max_kmers * h);
+    std::vector<size_t> positions(max_kmers);
+    const size_t kmers = btllib::hash_all_parallel(seq.data(),
+                                                   seq.size(),
+                                                   h,
+                                                   k,
+                                                   hashes.data(),
+                                                   h,
+                                                   positions.data(),
+                                                   chunk_size);
+    TEST_ASSERT_EQ(kmers, expected_kmers);
+    hashes.resize(kmers * h);
+    expected.resize(expected_kmers * h);
+    positions.resize(kmers);
+    expected_positions.resize(expected_kmers);
+    TEST_ASSERT(hashes == expected);
+    TEST_ASSERT(positions == expected_positions);
+
+    std::vector<uint64_t> first_hashes(max_kmers, 0);
+    btllib::hash_parallel(
+      seq,
+      h,
+      k,
+      [&](size_t pos, const uint64_t* kmer_hashes) {
+        first_hashes[pos] = kmer_hashes[0];
+      },
+      chunk_size);
+    std::vector<uint64_t> expected_first_hashes(max_kmers, 0);
+    for (size_t i = 0; i < expected_kmers; i++) {
+      expected_first_hashes[expected_positions[i]] = expected[i * h];
+    }
+    TEST_ASSERT(first_hashes == expected_first_hashes);
+  }
+
   {
     PRINT_TEST_NAME("skipping Ns")
 
@@ -363,6 +748,117 @@ main()
     }
   }
 
+  {
+    PRINT_TEST_NAME("SIMD spaced seed rolling")
+    const unsigned k = 31;
+    const unsigned h = 2;
+    std::vector<std::string> seeds;
+    for (unsigned i = 0; i < 13; i++) {
+      std::string half(k / 2, '1');
+      for (unsigned j = 0; j < half.size(); j++) {
+        half[j] = (j * 7 + i * 5) % 3 == 0 ? '0' : '1';
+      }
+      const std::string reversed(half.rbegin(), half.rend());
+      seeds.push_back(half + "1" + reversed);
+    }
+    seeds.push_back(std::string(k, '1'));
+    seeds.push_back("1010101010101010101010101010101");
+    std::string seq = get_random_seq(300);
+    seq[40] = 'N';
+    seq[150] = 'a';
+    seq[151] = 'c';
+    seq[200] = 'R';
+    seq[230] = 'U';
+
+    // Rolling all seeds at once matches rolling each seed on its own, which
+    // is below the SIMD threshold
+    btllib::SeedNtHash all(seq, seeds, h, k);
+    std::vector<btllib::SeedNtHash> single;
+    for (const auto& seed : seeds) {
+      single.emplace_back(seq, std::vector<std::string>{ seed }, h, k);
+    }
+    size_t steps = 0;
+    while (all.roll()) {
+      for (size_t j = 0; j < seeds.size(); j++) {
+        TEST_ASSERT(single[j].roll());
+        TEST_ASSERT_EQ(all.get_pos(), single[j].get_pos());
+        const uint64_t* all_hashes = all.hashes() + j * h;
+        const uint64_t* single_hashes = single[j].hashes();
+        TEST_ASSERT_ARRAY_EQ(all_hashes, single_hashes, h);
+        TEST_ASSERT_EQ(all.get_forward_hash()[j],
+                       single[j].get_forward_hash()[0]);
+        TEST_ASSERT_EQ(all.get_reverse_hash()[j],
+                       single[j].get_reverse_hash()[0]);
+      }
+      if (++steps % 7 == 0 && all.get_pos() > 0) {
+        TEST_ASSERT(all.roll_back());
+        TEST_ASSERT(all.roll());
+        const btllib::SeedNtHash copy(all);
+        TEST_ASSERT_ARRAY_EQ(copy.hashes(), all.hashes(), seeds.size() * h);
+      }
+    }
+
+    // Every instruction set supported by the CPU matches the scalar kernel
+    const auto parsed = std::make_shared<const btllib::ParsedSeeds>(seeds, k);
+    const auto& masks = parsed->get_roll_masks();
+    const unsigned m = seeds.size();
+    std::vector<btllib::hashing_internals::SimdLevel> levels;
+    if (btllib::hashing_internals::get_simd_level() !=
+        btllib::hashing_internals::SimdLevel::SCALAR) {
+      levels.push_back(btllib::hashing_internals::SimdLevel::AVX2);
+    }
+    if (btllib::hashing_internals::get_simd_level() ==
+        btllib::hashing_internals::SimdLevel::AVX512) {
+      levels.push_back(btllib::hashing_internals::SimdLevel::AVX512);
+    }
+    for (const auto level : levels) {
+      std::vector<uint64_t> fh_nomonos(m), rh_nomonos(m), fh(m), rh(m);
+      std::vector<uint64_t> hashes(m * h);
+      unsigned loc_n = 0;
+      TEST_ASSERT(btllib::ntmsm64(seq.data(),
+                                  parsed->get_seed_blocks(),
+                                  parsed->get_seed_monomers(),
+                                  k,
+                                  m,
+                                  h,
+                                  fh_nomonos.data(),
+                                  rh_nomonos.data(),
+                                  fh.data(),
+                                  rh.data(),
+                                  loc_n,
+                                  hashes.data()));
+      auto fh_nomonos_simd = fh_nomonos, rh_nomonos_simd = rh_nomonos;
+      auto fh_simd = fh, rh_simd = rh, hashes_simd = hashes;
+      for (size_t pos = 0; pos < 39 - k; pos++) {
+        btllib::ntmsm64(seq.data() + pos,
+                        parsed->get_seed_blocks(),
+                        parsed->get_seed_monomers(),
+                        k,
+                        m,
+                        h,
+                        fh_nomonos.data(),
+                        rh_nomonos.data(),
+                        fh.data(),
+                        rh.data(),
+                        hashes.data());
+        btllib::hashing_internals::ntmsm64_simd(seq.data() + pos,
+                                                masks,
+                                                k,
+                                                m,
+                                                h,
+                                                fh_nomonos_simd.data(),
+                                                rh_nomonos_simd.data(),
+                                                fh_simd.data(),
+                                                rh_simd.data(),
+                                                hashes_simd.data(),
+                                                level);
+        TEST_ASSERT(fh_nomonos == fh_nomonos_simd);
+        TEST_ASSERT(rh_nomonos == rh_nomonos_simd);
+        TEST_ASSERT(hashes == hashes_simd);
+      }
+    }
+  }
+
   {
     PRINT_TEST_NAME("copying SeedNtHash objects")
 
@@ -431,6 +927,212 @@ main()
     TEST_ASSERT_ARRAY_EQ(h1.hashes(), h2.hashes(), 2)
   }
 
+  {
+    PRINT_TEST_NAME("resetting NtHash and SeedNtHash")
+    const std::vector<std::string> seqs = { get_random_seq(100),
+                                            "ACGTNACGTACGTTGCANACGATCGA",
+                                            get_random_seq(35) };
+    const std::vector<std::string> seeds = { "1101011", "1110111" };
+    const unsigned k = 7;
+    const unsigned h = 3;
+
+    btllib::NtHash nthash(seqs[0], h, k);
+    const auto parsed = std::make_shared<const btllib::ParsedSeeds>(seeds, k);
+    TEST_ASSERT_EQ(parsed->size(), seeds.size());
+    btllib::SeedNtHash seed_nthash(seqs[0], parsed, h);
+    for (const auto& seq : seqs) {
+      nthash.reset(seq);
+      seed_nthash.reset(seq);
+      btllib::NtHash fresh(seq, h, k);
+      btllib::SeedNtHash fresh_seed(seq, seeds, h, k);
+      while (fresh.roll()) {
+        TEST_ASSERT(nthash.roll());
+        TEST_ASSERT_EQ(nthash.get_pos(), fresh.get_pos());
+        TEST_ASSERT_ARRAY_EQ(nthash.hashes(), fresh.hashes(), h);
+      }
+      TEST_ASSERT(!nthash.roll());
+      while (fresh_seed.roll()) {
+        TEST_ASSERT(seed_nthash.roll());
+        TEST_ASSERT_EQ(seed_nthash.get_pos(), fresh_seed.get_pos());
+        TEST_ASSERT_ARRAY_EQ(
+          seed_nthash.hashes(), fresh_seed.hashes(), seeds.size() * h);
+      }
+      TEST_ASSERT(!seed_nthash.roll());
+    }
+
+    // Copies share the parsed seeds
+    seed_nthash.reset(seqs[0], 10);
+    seed_nthash.roll();
+    btllib::SeedNtHash copy(seed_nthash);
+    TEST_ASSERT(copy.roll());
+    TEST_ASSERT(seed_nthash.roll());
+    TEST_ASSERT_ARRAY_EQ(copy.hashes(), seed_nthash.hashes(), seeds.size() * h);
+  }
+
+  {
+    PRINT_TEST_NAME("hashing packed sequences")
+    std::string seq = get_random_seq(500);
+    seq[40] = 'N';
+    seq[41] = 'a';
+    seq[99] = 'u';
+    seq[300] = 'R';
+    seq[301] = 'g';
+    const unsigned k = 31;
+    const unsigned h = 3;
+    const btllib::PackedSeq packed(seq);
+
+    const auto check_mode = [&](auto mode) {
+      constexpr btllib::NtHashMode MODE = decltype(mode)::value;
+      btllib::BasicNtHash<MODE> nthash(seq, h, k);
+      btllib::BasicPackedNtHash<MODE> packed_nthash(packed, h, k);
+      while (nthash.roll()) {
+        TEST_ASSERT(packed_nthash.roll());
+        TEST_ASSERT_EQ(packed_nthash.get_pos(), nthash.get_pos());
+        TEST_ASSERT_ARRAY_EQ(packed_nthash.hashes(), nthash.hashes(), h);
+      }
+      TEST_ASSERT(!packed_nthash.roll());
+      // Roll back over the k-mers after the last N
+      while (nthash.get_pos() > 302) {
+        TEST_ASSERT(nthash.roll_back());
+        TEST_ASSERT(packed_nthash.roll_back());
+        TEST_ASSERT_EQ(packed_nthash.get_pos(), nthash.get_pos());
+        TEST_ASSERT_ARRAY_EQ(packed_nthash.hashes(), nthash.hashes(), h);
+      }
+
+      nthash.reset(seq, 100);
+      packed_nthash.reset(packed, 100);
+      nthash.roll();
+      packed_nthash.roll();
+      nthash.peek();
+      packed_nthash.peek();
+      TEST_ASSERT_ARRAY_EQ(packed_nthash.hashes(), nthash.hashes(), h);
+      nthash.peek_back();
+      packed_nthash.peek_back();
+      TEST_ASSERT_ARRAY_EQ(packed_nthash.hashes(), nthash.hashes(), h);
+      nthash.sub({ 0, 5 }, { 'T', 'G' });
+      packed_nthash.sub({ 0, 5 }, { 'T', 'G' });
+      TEST_ASSERT_ARRAY_EQ(packed_nthash.hashes(), nthash.hashes(), h);
+
+      nthash.reset(seq);
+      packed_nthash.reset(packed);
+      std::vector<uint64_t> hashes(nthash.get_max_kmers() * h);
+      std::vector<uint64_t> packed_hashes(packed_nthash.get_max_kmers() * h);
+      TEST_ASSERT_EQ(packed_hashes.size(), hashes.size());
+      const size_t kmers = nthash.hash_all(hashes.data(), h);
+      TEST_ASSERT_EQ(packed_nthash.hash_all(packed_hashes.data(), h), kmers);
+      TEST_ASSERT_ARRAY_EQ(packed_hashes, hashes, kmers * h);
+    };
+    check_mode(std::integral_constant<btllib::NtHashMode,
+                                      btllib::NtHashMode::CANONICAL>());
+    check_mode(std::integral_constant<btllib::NtHashMode,
+                                      btllib::NtHashMode::FORWARD>());
+    check_mode(std::integral_constant<btllib::NtHashMode,
+                                      btllib::NtHashMode::REVERSE>());
+
+    // Hashing the reverse complement produces the same canonical hashes in
+    // reverse order
+    const btllib::PackedSeq rc = packed.reverse_complement();
+    btllib::PackedNtHash packed_nthash(packed, h, k);
+    btllib::PackedNtHash rc_nthash(rc, h, k);
+    std::vector<uint64_t> fwd_hashes, rc_hashes;
+    while (packed_nthash.roll()) {
+      fwd_hashes.push_back(packed_nthash.hashes()[0]);
+    }
+    while (rc_nthash.roll()) {
+      rc_hashes.push_back(rc_nthash.hashes()[0]);
+    }
+    TEST_ASSERT_EQ(fwd_hashes.size(), rc_hashes.size());
+    TEST_ASSERT(std::equal(
+      fwd_hashes.begin(), fwd_hashes.end(), rc_hashes.rbegin()));
+  }
+
+  {
+    PRINT_TEST_NAME("BlindNtHash peeking all extensions")
+    const std::string seq = get_random_seq(40);
+    const unsigned k = 21;
+    const unsigned h = 5;
+    btllib::BlindNtHash blind(seq.substr(10), h, k);
+    std::vector<uint64_t> successors(4 * h), predecessors(4 * h);
+    blind.peek_all_successors(successors.data());
+    blind.peek_all_predecessors(predecessors.data());
+    for (unsigned b = 0; b < 4; b++) {
+      const char base = btllib::BlindNtHash::EXTENSION_BASES[b];
+      const uint64_t* const successor = successors.data() + b * h;
+      const uint64_t* const predecessor = predecessors.data() + b * h;
+      const std::string next_kmer = seq.substr(11, k - 1) + base;
+      const std::string prev_kmer = base + seq.substr(10, k - 1);
+      btllib::NtHash next(next_kmer, h, k);
+      btllib::NtHash prev(prev_kmer, h, k);
+      next.roll();
+      prev.roll();
+      TEST_ASSERT_ARRAY_EQ(successor, next.hashes(), h);
+      TEST_ASSERT_ARRAY_EQ(predecessor, prev.hashes(), h);
+      btllib::BlindNtHash peeked(blind);
+      peeked.peek(base);
+      TEST_ASSERT_ARRAY_EQ(successor, peeked.hashes(), h);
+      peeked.peek_back(base);
+      TEST_ASSERT_ARRAY_EQ(predecessor, peeked.hashes(), h);
+    }
+  }
+
+  {
+    PRINT_TEST_NAME("enumerating substitution variants")
+    std::string seq = get_random_seq(30);
+    seq[3] = 'c';
+    const unsigned k = 12;
+    const unsigned h = 3;
+    const auto check_mode = [&](auto mode) {
+      using StrandNtHash = btllib::BasicNtHash<decltype(mode)::value>;
+      StrandNtHash nthash(seq, h, k);
+      TEST_ASSERT_EQ(nthash.hash_variants(nullptr, h), 0);
+      nthash.roll();
+      nthash.roll();
+      const size_t max_variants = nthash.get_max_variants(2);
+      TEST_ASSERT_EQ(max_variants, 3 * k + 9 * k * (k - 1) / 2);
+      std::vector<uint64_t> hashes(max_variants * h);
+      std::vector<btllib::KmerVariant> variants(max_variants);
+      TEST_ASSERT_EQ(
+        nthash.hash_variants(hashes.data(), h, 2, variants.data()),
+        max_variants);
+      TEST_ASSERT_EQ(nthash.hash_variants(hashes.data(), h), 3 * k);
+
+      const std::string kmer = seq.substr(1, k);
+      const std::vector<uint64_t> kmer_hashes(nthash.hashes(),
+                                              nthash.hashes() + h);
+      std::set<std::string> variant_kmers;
+      for (size_t v = 0; v < max_variants; v++) {
+        std::string variant_kmer = kmer;
+        std::vector<unsigned> positions;
+        std::vector<unsigned char> new_bases;
+        for (unsigned j = 0; j < variants[v].num; j++) {
+          variant_kmer[variants[v].positions[j]] = variants[v].bases[j];
+          positions.push_back(variants[v].positions[j]);
+          new_bases.push_back(variants[v].bases[j]);
+        }
+        const unsigned distance = v < 3 * k ? 1 : 2;
+        TEST_ASSERT_EQ(variants[v].num, distance);
+        variant_kmers.insert(variant_kmer);
+        const uint64_t* const variant_hashes = hashes.data() + v * h;
+        StrandNtHash fresh(variant_kmer, h, k);
+        fresh.roll();
+        TEST_ASSERT_ARRAY_EQ(variant_hashes, fresh.hashes(), h);
+        nthash.sub(positions, new_bases);
+        TEST_ASSERT_ARRAY_EQ(variant_hashes, nthash.hashes(), h);
+      }
+      // All variants are distinct and differ from the k-mer
+      TEST_ASSERT_EQ(variant_kmers.size(), max_variants);
+      TEST_ASSERT(variant_kmers.find(kmer) == variant_kmers.end());
+      TEST_ASSERT_EQ(nthash.get_pos(), 1);
+      nthash.roll_back();
+      nthash.roll();
+      TEST_ASSERT_ARRAY_EQ(nthash.hashes(), kmer_hashes, h);
+    };
+    check_mode(std::integral_constant<btllib::NtHashMode,
+                                      btllib::NtHashMode::CANONICAL>());
+    check_mode(std::integral_constant<btllib::NtHashMode,
+                                      btllib::NtHashMode::FORWARD>());
+  }
+
   {
     PRINT_TEST_NAME("k-mer vs. full-care spaced seed hashing")
     const std::string seq = "ATGCTAGTAGCTGAC";
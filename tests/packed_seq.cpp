@@ -0,0 +1,134 @@
+#include "btllib/packed_seq.hpp"
+
+#include "helpers.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string
+random_seq(std::mt19937_64& rng, const size_t size)
+{
+  static const std::string chars = "ACGTACGTACGTacgtUuNnRX-";
+  std::string seq(size, 'A');
+  for (auto& c : seq) {
+    c = chars[rng() % chars.size()];
+  }
+  return seq;
+}
+
+char
+expected_base(const char c)
+{
+  switch (c) {
+    case 'A':
+    case 'a':
+      return 'A';
+    case 'C':
+    case 'c':
+      return 'C';
+    case 'G':
+    case 'g':
+      return 'G';
+    case 'T':
+    case 't':
+    case 'U':
+    case 'u':
+      return 'T';
+    default:
+      return 'N';
+  }
+}
+
+char
+complement(const char c)
+{
+  switch (c) {
+    case 'A':
+      return 'T';
+    case 'C':
+      return 'G';
+    case 'G':
+      return 'C';
+    case 'T':
+      return 'A';
+    default:
+      return 'N';
+  }
+}
+
+} // namespace
+
+int
+main()
+{
+  std::mt19937_64 rng(42);
+
+  PRINT_TEST_NAME("packed sequence packing and unpacking")
+  for (const size_t size : { size_t(0),
+                             size_t(1),
+                             size_t(31),
+                             size_t(32),
+                             size_t(33),
+                             size_t(64),
+                             size_t(100),
+                             size_t(1000),
+                             size_t(4099) }) {
+    const std::string seq = random_seq(rng, size);
+    std::string expected = seq;
+    for (auto& c : expected) {
+      c = expected_base(c);
+    }
+    const btllib::PackedSeq packed(seq);
+    TEST_ASSERT_EQ(packed.size(), size);
+    TEST_ASSERT_EQ(packed.unpack(), expected);
+    TEST_ASSERT(packed.is_n(size));
+    for (size_t i = 0; i < size; i++) {
+      TEST_ASSERT_EQ(packed[i], expected[i]);
+      const bool is_n = expected[i] == 'N';
+      TEST_ASSERT_EQ(packed.is_n(i), is_n);
+    }
+    // Unaligned ranges
+    for (size_t pos = 0; pos < size; pos += 1 + rng() % 37) {
+      const size_t len = rng() % (size - pos + 1);
+      std::string part(len, ' ');
+      packed.unpack(pos, len, &part[0]);
+      TEST_ASSERT_EQ(part, expected.substr(pos, len));
+    }
+  }
+
+  PRINT_TEST_NAME("packed sequence reverse complement")
+  for (const size_t size : { size_t(1),
+                             size_t(32),
+                             size_t(63),
+                             size_t(64),
+                             size_t(65),
+                             size_t(777) }) {
+    const std::string seq = random_seq(rng, size);
+    std::string expected(seq.rbegin(), seq.rend());
+    for (auto& c : expected) {
+      c = complement(expected_base(c));
+    }
+    const btllib::PackedSeq packed(seq);
+    const btllib::PackedSeq rc = packed.reverse_complement();
+    TEST_ASSERT_EQ(rc.size(), size);
+    TEST_ASSERT_EQ(rc.unpack(), expected);
+    TEST_ASSERT_EQ(rc.reverse_complement().unpack(), packed.unpack());
+    // N is stored with the same code whichever strand it comes from
+    for (size_t i = 0; i < size; i++) {
+      TEST_ASSERT(!rc.is_n(i) || rc.code(i) == 0);
+    }
+  }
+
+  PRINT_TEST_NAME("packed sequence size")
+  {
+    const btllib::PackedSeq packed(random_seq(rng, 1000000));
+    TEST_ASSERT_LE(packed.bytes(), size_t(1000000 * 3 / 8 + 16));
+  }
+
+  return 0;
+}
@@ -0,0 +1,57 @@
+#include "btllib/rank_bit_vector.hpp"
+
+#include "helpers.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+int
+main()
+{
+  std::mt19937_64 rng(42);
+
+  PRINT_TEST_NAME("rank bit vector rank and access")
+  for (const size_t size : { size_t(1),
+                             size_t(63),
+                             size_t(64),
+                             size_t(447),
+                             size_t(448),
+                             size_t(449),
+                             size_t(896),
+                             size_t(10000) }) {
+    std::vector<uint64_t> words((size + 63) / 64);
+    for (auto& word : words) {
+      word = rng();
+    }
+    // Bits past size must be ignored
+    words.back() |= ~uint64_t(0) << (size % 64 == 0 ? 63 : size % 64);
+    const btllib::RankBitVector bv(words.data(), size);
+    TEST_ASSERT_EQ(bv.size(), size);
+    uint64_t rank = 0;
+    for (size_t i = 0; i < size; i++) {
+      TEST_ASSERT_EQ(bv.rank(i), rank);
+      const bool bit = ((words[i / 64] >> (i % 64)) & 1) != 0;
+      TEST_ASSERT_EQ(bv[i], bit);
+      rank += bit ? 1 : 0;
+    }
+    TEST_ASSERT_EQ(bv.rank(size), rank);
+    TEST_ASSERT_EQ(bv.count(), rank);
+    for (size_t w = 0; w < words.size(); w++) {
+      const uint64_t word =
+        w + 1 < words.size() || size % 64 == 0
+          ? words[w]
+          : words[w] & ((uint64_t(1) << (size % 64)) - 1);
+      TEST_ASSERT_EQ(bv.get_word(w), word);
+    }
+
+    const auto view = btllib::RankBitVector::view(bv.data(), size);
+    TEST_ASSERT_EQ(view.bytes(), btllib::RankBitVector::bytes(size));
+    for (size_t i = 0; i <= size; i++) {
+      TEST_ASSERT_EQ(view.rank(i), bv.rank(i));
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,297 @@
+#include "btllib/nthash.hpp"
+#include "btllib/sketch.hpp"
+
+#include "helpers.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+struct HashedPos
+{
+  uint64_t hash;
+  size_t pos;
+};
+
+// Hash values of the valid k-mers of a sequence
+static std::vector<HashedPos>
+get_kmers(const std::string& seq, unsigned k)
+{
+  std::vector<HashedPos> kmers;
+  for (btllib::NtHash nthash(seq, 1, k); nthash.roll();) {
+    kmers.push_back({ nthash.hashes()[0], nthash.get_pos() });
+  }
+  return kmers;
+}
+
+// Hash values of the k-mers of a sequence by position, with the maximum value
+// for invalid k-mers
+static std::vector<uint64_t>
+get_kmers_by_pos(const std::string& seq, unsigned k)
+{
+  std::vector<uint64_t> hashes(seq.size(),
+                               std::numeric_limits<uint64_t>::max());
+  for (const auto& kmer : get_kmers(seq, k)) {
+    hashes[kmer.pos] = kmer.hash;
+  }
+  return hashes;
+}
+
+// Offset of the rightmost minimum of values[start, start + n)
+static size_t
+rightmost_min(const std::vector<uint64_t>& values, size_t start, size_t n)
+{
+  size_t min_offset = 0;
+  for (size_t i = 1; i < n; i++) {
+    if (values[start + i] <= values[start + min_offset]) {
+      min_offset = i;
+    }
+  }
+  return min_offset;
+}
+
+static bool
+all_valid(const std::vector<uint64_t>& values, size_t start, size_t n)
+{
+  for (size_t i = start; i < start + n; i++) {
+    if (values[i] == std::numeric_limits<uint64_t>::max()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Check that hashes are those of the k-mer at pos
+static void
+check_kmer_hashes(const std::string& seq,
+                  unsigned k,
+                  size_t pos,
+                  const uint64_t* hashes)
+{
+  btllib::NtHash nthash(seq, 2, k, pos);
+  TEST_ASSERT(nthash.roll());
+  TEST_ASSERT_EQ(nthash.get_pos(), pos);
+  TEST_ASSERT_EQ(hashes[0], nthash.hashes()[0]);
+  TEST_ASSERT_EQ(hashes[1], nthash.hashes()[1]);
+}
+
+int
+main()
+{
+  std::string seq = get_random_seq(5000);
+  seq[1000] = 'N';
+  seq[1003] = 'N';
+  seq[3000] = 'N';
+
+  {
+    PRINT_TEST_NAME("sliding window minimum")
+    for (const size_t w : { 1, 2, 5, 16 }) {
+      btllib::SlidingWindowMin window(w);
+      std::vector<uint64_t> values;
+      for (size_t i = 0; i < 1000; i++) {
+        values.push_back(get_random(0, 7));
+        window.push(values.back(), i + 100);
+        const bool full = i + 1 >= w;
+        TEST_ASSERT_EQ(window.is_full(), full);
+        const size_t start = i + 1 >= w ? i + 1 - w : 0;
+        const size_t min_idx =
+          start + rightmost_min(values, start, i + 1 - start);
+        TEST_ASSERT_EQ(window.get_min_value(), values[min_idx]);
+        TEST_ASSERT_EQ(window.get_min_index(), min_idx);
+        TEST_ASSERT_EQ(window.get_min_pos(), min_idx + 100);
+      }
+      window.clear();
+      TEST_ASSERT(!window.is_full());
+      TEST_ASSERT_EQ(window.get_count(), 0);
+    }
+  }
+
+  {
+    PRINT_TEST_NAME("minimizers")
+    const unsigned k = 15;
+    for (const size_t w : { 1, 4, 11, 50 }) {
+      const auto kmers = get_kmers(seq, k);
+      std::vector<uint64_t> kmer_hashes;
+      for (const auto& kmer : kmers) {
+        kmer_hashes.push_back(kmer.hash);
+      }
+      std::vector<size_t> expected;
+      for (size_t i = 0; i + w <= kmers.size(); i++) {
+        const size_t min_idx = i + rightmost_min(kmer_hashes, i, w);
+        if (expected.empty() || kmers[min_idx].pos != expected.back()) {
+          expected.push_back(kmers[min_idx].pos);
+        }
+      }
+      std::vector<size_t> minimizers;
+      btllib::for_each_minimizer(
+        seq.data(),
+        seq.size(),
+        2,
+        k,
+        w,
+        [&](size_t pos, const uint64_t* hashes) {
+          minimizers.push_back(pos);
+          check_kmer_hashes(seq, k, pos, hashes);
+        });
+      TEST_ASSERT_EQ(minimizers.size(), expected.size());
+      TEST_ASSERT_ARRAY_EQ(minimizers, expected, expected.size());
+    }
+  }
+
+  {
+    PRINT_TEST_NAME("syncmers")
+    const unsigned k = 15, s = 5;
+    const auto smer_hashes = get_kmers_by_pos(seq, s);
+    for (const auto type :
+         { btllib::SyncmerType::CLOSED, btllib::SyncmerType::OPEN }) {
+      const size_t offset = type == btllib::SyncmerType::OPEN ? 3 : 0;
+      std::vector<size_t> expected;
+      for (size_t pos = 0; pos + k <= seq.size(); pos++) {
+        if (!all_valid(smer_hashes, pos, k - s + 1)) {
+          continue;
+        }
+        const size_t min_offset = rightmost_min(smer_hashes, pos, k - s + 1);
+        const bool closed = min_offset == 0 || min_offset == k - s;
+        const bool open = min_offset == offset;
+        if (type == btllib::SyncmerType::CLOSED ? closed : open) {
+          expected.push_back(pos);
+        }
+      }
+      std::vector<size_t> syncmers;
+      btllib::for_each_syncmer(
+        seq.data(),
+        seq.size(),
+        2,
+        k,
+        s,
+        [&](size_t pos, const uint64_t* hashes) {
+          syncmers.push_back(pos);
+          check_kmer_hashes(seq, k, pos, hashes);
+        },
+        type,
+        offset);
+      TEST_ASSERT_GT(expected.size(), 0);
+      TEST_ASSERT_EQ(syncmers.size(), expected.size());
+      TEST_ASSERT_ARRAY_EQ(syncmers, expected, expected.size());
+    }
+  }
+
+  {
+    PRINT_TEST_NAME("mod-minimizers")
+    for (const unsigned k : { 3, 15, 31 }) {
+      const size_t w = 10;
+      btllib::ModMinimizerSelector selector(k, w);
+      const size_t t = selector.get_t();
+      const size_t expected_t = k < 4 ? k : 4 + (k - 4) % w;
+      TEST_ASSERT_EQ(t, expected_t);
+      const auto tmer_hashes = get_kmers_by_pos(seq, t);
+      std::vector<size_t> expected;
+      for (size_t pos = 0; pos + w + k - 1 <= seq.size(); pos++) {
+        if (!all_valid(tmer_hashes, pos, w + k - t)) {
+          continue;
+        }
+        const size_t min_offset = rightmost_min(tmer_hashes, pos, w + k - t);
+        const size_t kmer_pos = pos + min_offset % w;
+        if (expected.empty() || kmer_pos != expected.back()) {
+          expected.push_back(kmer_pos);
+        }
+      }
+      std::vector<size_t> mod_minimizers;
+      btllib::for_each_mod_minimizer(
+        seq.data(),
+        seq.size(),
+        2,
+        k,
+        w,
+        [&](size_t pos, const uint64_t* hashes) {
+          mod_minimizers.push_back(pos);
+          check_kmer_hashes(seq, k, pos, hashes);
+        });
+      TEST_ASSERT_EQ(mod_minimizers.size(), expected.size());
+      TEST_ASSERT_ARRAY_EQ(mod_minimizers, expected, expected.size());
+    }
+
+    // Mod-minimizers sample fewer k-mers than minimizers when k > w
+    const std::string long_seq = get_random_seq(100000);
+    size_t num_minimizers = 0, num_mod_minimizers = 0;
+    btllib::for_each_minimizer(
+      long_seq.data(),
+      long_seq.size(),
+      1,
+      31,
+      10,
+      [&](size_t, const uint64_t*) { num_minimizers++; });
+    btllib::for_each_mod_minimizer(
+      long_seq.data(),
+      long_seq.size(),
+      1,
+      31,
+      10,
+      [&](size_t, const uint64_t*) { num_mod_minimizers++; });
+    TEST_ASSERT_LT(num_mod_minimizers, num_minimizers);
+  }
+
+  {
+    PRINT_TEST_NAME("randstrobes")
+    const unsigned k = 10;
+    const size_t w_min = 3, w_max = 12;
+    const auto kmers = get_kmers(seq, k);
+    std::vector<uint64_t> expected_hashes;
+    std::vector<size_t> expected_first, expected_second;
+    for (size_t i = 0; i + w_min < kmers.size(); i++) {
+      size_t second = i + w_min;
+      for (size_t j = second + 1; j <= i + w_max && j < kmers.size(); j++) {
+        if ((kmers[i].hash ^ kmers[j].hash) <
+            (kmers[i].hash ^ kmers[second].hash)) {
+          second = j;
+        }
+      }
+      expected_hashes.push_back(kmers[i].hash / 2 + kmers[second].hash / 3);
+      expected_first.push_back(kmers[i].pos);
+      expected_second.push_back(kmers[second].pos);
+    }
+    std::vector<uint64_t> strobe_hashes;
+    std::vector<size_t> first, second;
+    btllib::for_each_randstrobe(
+      seq.data(),
+      seq.size(),
+      k,
+      w_min,
+      w_max,
+      [&](uint64_t hash, size_t first_pos, size_t second_pos) {
+        strobe_hashes.push_back(hash);
+        first.push_back(first_pos);
+        second.push_back(second_pos);
+      });
+    TEST_ASSERT_EQ(strobe_hashes.size(), expected_hashes.size());
+    TEST_ASSERT_ARRAY_EQ(
+      strobe_hashes, expected_hashes, expected_hashes.size());
+    TEST_ASSERT_ARRAY_EQ(first, expected_first, expected_first.size());
+    TEST_ASSERT_ARRAY_EQ(second, expected_second, expected_second.size());
+
+    // Strobes may be built from a subsampled stream, e.g. syncmers
+    btllib::RandstrobeSelector selector(w_min, w_max);
+    std::vector<size_t> syncmers;
+    btllib::for_each_syncmer(seq.data(),
+                             seq.size(),
+                             1,
+                             20,
+                             k,
+                             [&](size_t pos, const uint64_t* hashes) {
+                               syncmers.push_back(pos);
+                               selector.push(hashes[0], pos);
+                             });
+    size_t num_strobes = 0;
+    while (selector.finish()) {
+      num_strobes++;
+      TEST_ASSERT_LT(selector.get_first_pos(), selector.get_second_pos());
+    }
+    TEST_ASSERT_EQ(num_strobes, std::min(w_max, syncmers.size()) - w_min);
+    TEST_ASSERT(!selector.finish());
+  }
+
+  return 0;
+}
@@ -86,18 +86,18 @@ using SpacedSeed = std::vector<unsigned>;
   static std::map<void*, long> nthash_ids;
 %}
 
-%ignore btllib::NtHash::NtHash(const char*, size_t, hashing_internals::NUM_HASHES_TYPE, hashing_internals::K_TYPE, size_t pos = 0);
+%ignore btllib::BasicNtHash::BasicNtHash(const char*, size_t, hashing_internals::NUM_HASHES_TYPE, hashing_internals::K_TYPE, size_t pos = 0);
 %ignore btllib::BlindNtHash::BlindNtHash(const char*, size_t, hashing_internals::NUM_HASHES_TYPE, hashing_internals::K_TYPE, size_t pos = 0);
 %ignore btllib::SeedNtHash::SeedNtHash(const char*, size_t, const std::vector<std::vector<unsigned>>&, hashing_internals::NUM_HASHES_TYPE, hashing_internals::K_TYPE, size_t pos = 0);
 %ignore btllib::SeedNtHash::SeedNtHash(const char*, size_t, const std::vector<std::string>&, hashing_internals::NUM_HASHES_TYPE, hashing_internals::K_TYPE, size_t pos = 0);
-%ignore btllib::NtHash::NtHash(const std::string&, hashing_internals::NUM_HASHES_TYPE, hashing_internals::K_TYPE, size_t pos = 0);
+%ignore btllib::BasicNtHash::BasicNtHash(const std::string&, hashing_internals::NUM_HASHES_TYPE, hashing_internals::K_TYPE, size_t pos = 0);
 %ignore btllib::BlindNtHash::BlindNtHash(const std::string&, hashing_internals::NUM_HASHES_TYPE, hashing_internals::K_TYPE, size_t pos = 0);
 %ignore btllib::SeedNtHash::SeedNtHash(const std::string&, const std::vector<std::vector<unsigned>>&, hashing_internals::NUM_HASHES_TYPE, hashing_internals::K_TYPE, size_t pos = 0);
 %ignore btllib::SeedNtHash::SeedNtHash(const std::string&, const std::vector<std::string>&, hashing_internals::NUM_HASHES_TYPE, hashing_internals::K_TYPE, size_t pos = 0);
 %ignore btllib::AAHash::AAHash(const std::string&, unsigned, unsigned, unsigned, size_t pos = 0);
 
-%ignore btllib::NtHash::NtHash(NtHash&&);
-%ignore btllib::NtHash::NtHash(const NtHash&);
+%ignore btllib::BasicNtHash::BasicNtHash(BasicNtHash&&);
+%ignore btllib::BasicNtHash::BasicNtHash(const BasicNtHash&);
 %ignore btllib::BlindNtHash::BlindNtHash(BlindNtHash&&);
 %ignore btllib::BlindNtHash::BlindNtHash(const BlindNtHash&);
 %ignore btllib::SeedNtHash::SeedNtHash(SeedNtHash&&);
@@ -105,8 +105,8 @@ using SpacedSeed = std::vector<unsigned>;
 %ignore btllib::AAHash::AAHash(AAHash&&);
 %ignore btllib::AAHash::AAHash(const AAHash&);
 
-%extend btllib::NtHash {
-  NtHash(std::string seq, unsigned hash_num, unsigned k, size_t pos = 0)
+%extend btllib::BasicNtHash<btllib::NtHashMode::CANONICAL> {
+  BasicNtHash(std::string seq, unsigned hash_num, unsigned k, size_t pos = 0)
   {
     std::unique_lock<std::mutex> lock(nthash_mutex);
     nthash_strings[++nthash_last_id] = std::move(seq);
@@ -115,7 +115,7 @@ using SpacedSeed = std::vector<unsigned>;
     return nthash;
   }
 
-  ~NtHash() {
+  ~BasicNtHash() {
     std::unique_lock<std::mutex> lock(nthash_mutex);
     nthash_strings.erase(nthash_ids[(void*)self]);
     nthash_ids.erase((void*)self);
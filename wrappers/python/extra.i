@@ -71,7 +71,7 @@
   static_assert(sizeof(long unsigned int) >= sizeof(uint64_t), "Python wrappers are using wrong size integers.");
 %}
 
-%typemap(out) uint64_t* btllib::NtHash::hashes %{
+%typemap(out) uint64_t* btllib::BasicNtHash<btllib::NtHashMode::CANONICAL>::hashes %{
   $result = PyTuple_New(arg1->get_hash_num());
   for (unsigned i = 0; i < arg1->get_hash_num(); ++i) {
     PyTuple_SetItem($result, i, PyLong_FromUnsignedLong($1[i]));